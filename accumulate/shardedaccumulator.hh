@@ -0,0 +1,334 @@
+#ifndef shardedaccumulator_hh_defd
+#define shardedaccumulator_hh_defd
+
+#include "../indexproxifier.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace ip
+{
+    /**
+       Writes many (key, value) pairs to an owner deriving from
+       IndexProxifier. Uses the owner's (private, like the other proxy_
+       actions)
+
+           void proxy_accept_batch(Updates const &updates);
+
+       if it has one, and otherwise assigns the elements one by one. Updates
+       is a range of std::pair<Key, Value>.
+    */
+    template <typename Owner, typename Updates>
+        requires ProxyIndexed<Owner &, decltype(std::ranges::begin(std::declval<Updates const &>())->first)>
+    void accept_batch(Owner &owner, Updates const &updates)
+    {
+        if (std::ranges::empty(updates))
+            return;
+        auto const &first = *std::ranges::begin(updates);
+        typedef decltype(owner[first.first]) Proxy;
+        if constexpr (LRProxyAccess::has_accept_batch_action<Proxy, Updates>)
+            LRProxyAccess::run_accept_batch_action(owner[first.first], updates);
+        else
+            for (auto const &[key, value]: updates)
+                owner[key] = value;
+    }
+}
+
+/**
+   Accumulates into an owner deriving from IndexProxifier from many threads
+   at once, without them contending for its elements:
+
+       Histogram hist(256);
+       ShardedAccumulator<Histogram> counts(hist);
+       // In each worker thread:
+       counts[bucket] += 1;
+       // When the workers are done:
+       counts.merge();             // hist[bucket] += sum of the counts.
+
+   Every thread accumulates in a shard of its own, so the updates are plain
+   local adds. merge() combines the shards into the owner, in one
+   accept_batch. Merging must not overlap with accumulating.
+
+   Other associative (and commutative) operations than + are accumulated
+   with accumulate(key, value):
+
+       // Max: a function object returning std::max of its arguments.
+       ShardedAccumulator<Peaks, Max> peaks(owner, lowest);
+       peaks.accumulate(key, sample); // merge(): owner[key] = max(owner[key], ...)
+
+   The identity of the operation (0 for +, the lowest value for max) is what
+   shards start from. counts[key] is the calling thread's partial result for
+   key, and assigning to it replaces that. counts[key] += value is
+   accumulate(key, value), and only compiles if Op is std::plus.
+
+   Threads remember their shards by accumulator. A destroyed accumulator's
+   entries are pruned by a thread's next lookup of a shard it has none of.
+
+   Owners keyed by integers and having a size() get dense shards of that
+   size. Others get hash maps.
+*/
+template <typename Owner, typename Op = std::plus<>, typename Key = std::size_t>
+class ShardedAccumulator: protected IndexProxifier<ShardedAccumulator<Owner, Op, Key>>
+{
+public:
+    typedef typename std::remove_cvref<
+        typename decltype(std::declval<Owner &>()[std::declval<Key const &>()])::indexproxifier_conversion_type
+        >::type value_type;
+
+private:
+    static constexpr bool Dense = std::is_integral<Key>::value && requires(Owner &owner) { owner.size(); };
+
+    class Shard;
+
+    static constexpr bool Adds = std::is_same<Op, std::plus<>>::value
+        || std::is_same<Op, std::plus<value_type>>::value;
+
+    static inline std::atomic<uint64_t> s_nextid{1};
+    static inline std::mutex s_livemutex;               // Guards s_live.
+    static inline std::unordered_set<uint64_t> s_live;  // Ids of existing accumulators.
+
+    Owner &d_owner;
+    value_type d_identity;
+    Op d_op;
+    uint64_t const d_id; // Identifies this accumulator to the threads.
+
+    std::mutex d_mutex; // Guards d_shards.
+    std::vector<std::unique_ptr<Shard>> d_shards;
+
+public:
+    explicit ShardedAccumulator(Owner &owner, value_type identity = value_type{}, Op op = Op{});
+    ShardedAccumulator(ShardedAccumulator const &other) = delete;
+    ~ShardedAccumulator();
+
+    // Combines value into the calling thread's partial result for key.
+    void accumulate(Key const &key, value_type const &value);
+
+    // Combines all partial results into the owner, and resets them.
+    void merge();
+
+    std::size_t shards();
+
+    using IndexProxifier<ShardedAccumulator>::operator[];
+
+private:
+    friend IndexProxifier<ShardedAccumulator>;
+
+    value_type &proxy_return_action(Key const &key);
+    value_type proxy_accept_action(Key const &key, value_type const &value);
+    value_type proxy_add_action(Key const &key, value_type const &value);
+
+    Shard &local();
+    std::size_t shard_size() const;
+};
+
+// Partial results of one thread.
+template <typename Owner, typename Op, typename Key>
+class ShardedAccumulator<Owner, Op, Key>::Shard
+{
+    value_type d_identity;
+    std::conditional_t<Dense, std::vector<value_type>, std::unordered_map<Key, value_type>> d_partials;
+    std::vector<char> d_touchedflags;   // Dense only.
+    std::vector<Key> d_touched;         // Dense only, in order of touching.
+
+public:
+    Shard(value_type const &identity, std::size_t size);
+
+    value_type &partial(Key const &key);
+
+    // Calls function(key, partial) for every key touched since reset().
+    template <typename Function>
+    void for_each(Function &&function) const;
+
+    void reset();
+};
+
+template <typename Owner, typename Op, typename Key>
+ShardedAccumulator<Owner, Op, Key>::Shard::Shard(value_type const &identity, std::size_t size)
+    : d_identity(identity)
+{
+    if constexpr (Dense)
+    {
+        d_partials.assign(size, identity);
+        d_touchedflags.assign(size, false);
+    }
+}
+
+template <typename Owner, typename Op, typename Key>
+typename ShardedAccumulator<Owner, Op, Key>::value_type &
+ShardedAccumulator<Owner, Op, Key>::Shard::partial(Key const &key)
+{
+    if constexpr (Dense)
+    {
+        if (not d_touchedflags[key])
+        {
+            d_touchedflags[key] = true;
+            d_touched.push_back(key);
+        }
+        return d_partials[key];
+    }
+    else
+        return d_partials.try_emplace(key, d_identity).first->second;
+}
+
+template <typename Owner, typename Op, typename Key>
+template <typename Function>
+void ShardedAccumulator<Owner, Op, Key>::Shard::for_each(Function &&function) const
+{
+    if constexpr (Dense)
+        for (Key key: d_touched)
+            function(key, d_partials[key]);
+    else
+        for (auto const &[key, partial]: d_partials)
+            function(key, partial);
+}
+
+template <typename Owner, typename Op, typename Key>
+void ShardedAccumulator<Owner, Op, Key>::Shard::reset()
+{
+    if constexpr (Dense)
+    {
+        for (Key key: d_touched)
+        {
+            d_partials[key] = d_identity;
+            d_touchedflags[key] = false;
+        }
+        d_touched.clear();
+    }
+    else
+        d_partials.clear();
+}
+
+template <typename Owner, typename Op, typename Key>
+ShardedAccumulator<Owner, Op, Key>::ShardedAccumulator(Owner &owner, value_type identity, Op op)
+    : d_owner(owner),
+      d_identity(std::move(identity)),
+      d_op(std::move(op)),
+      d_id(s_nextid++)
+{
+    std::lock_guard<std::mutex> lock(s_livemutex);
+    s_live.insert(d_id);
+}
+
+template <typename Owner, typename Op, typename Key>
+ShardedAccumulator<Owner, Op, Key>::~ShardedAccumulator()
+{
+    std::lock_guard<std::mutex> lock(s_livemutex);
+    s_live.erase(d_id);
+}
+
+template <typename Owner, typename Op, typename Key>
+void ShardedAccumulator<Owner, Op, Key>::accumulate(Key const &key, value_type const &value)
+{
+    value_type &partial = local().partial(key);
+    partial = d_op(partial, value);
+}
+
+template <typename Owner, typename Op, typename Key>
+void ShardedAccumulator<Owner, Op, Key>::merge()
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+
+    Shard total(d_identity, shard_size());
+    for (std::unique_ptr<Shard> const &shard: d_shards)
+    {
+        shard->for_each(
+            [&](Key const &key, value_type const &partial)
+            {
+                value_type &sum = total.partial(key);
+                sum = d_op(sum, partial);
+            });
+        shard->reset();
+    }
+
+    std::vector<std::pair<Key, value_type>> updates;
+    total.for_each(
+        [&](Key const &key, value_type const &partial)
+        {
+            value_type current = d_owner[key];
+            updates.emplace_back(key, d_op(current, partial));
+        });
+    ip::accept_batch(d_owner, updates);
+}
+
+template <typename Owner, typename Op, typename Key>
+std::size_t ShardedAccumulator<Owner, Op, Key>::shards()
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+    return d_shards.size();
+}
+
+template <typename Owner, typename Op, typename Key>
+typename ShardedAccumulator<Owner, Op, Key>::value_type &
+ShardedAccumulator<Owner, Op, Key>::proxy_return_action(Key const &key)
+{
+    return local().partial(key);
+}
+
+template <typename Owner, typename Op, typename Key>
+typename ShardedAccumulator<Owner, Op, Key>::value_type
+ShardedAccumulator<Owner, Op, Key>::proxy_accept_action(Key const &key, value_type const &value)
+{
+    return local().partial(key) = value;
+}
+
+template <typename Owner, typename Op, typename Key>
+typename ShardedAccumulator<Owner, Op, Key>::value_type
+ShardedAccumulator<Owner, Op, Key>::proxy_add_action(Key const &key, value_type const &value)
+{
+    static_assert(Adds, "counts[key] += value would add, whatever Op is. Use accumulate(key, value).");
+    value_type &partial = local().partial(key);
+    return partial = d_op(partial, value);
+}
+
+// Looks up the calling thread's shard, creating it on first use. The last
+// one looked up is remembered, so the usual case costs a compare. Ids are
+// never reused, so entries of destroyed accumulators are never looked up
+// again; they are pruned when a shard is created.
+template <typename Owner, typename Op, typename Key>
+typename ShardedAccumulator<Owner, Op, Key>::Shard &ShardedAccumulator<Owner, Op, Key>::local()
+{
+    thread_local std::pair<uint64_t, Shard *> t_last{0, nullptr};
+    thread_local std::unordered_map<uint64_t, Shard *> t_shards;
+
+    if (t_last.first == d_id)
+        return *t_last.second;
+
+    auto found = t_shards.find(d_id);
+    if (found == t_shards.end())
+    {
+        {
+            std::lock_guard<std::mutex> lock(s_livemutex);
+            std::erase_if(t_shards,
+                          [](auto const &entry)
+                          {
+                              return not s_live.contains(entry.first);
+                          });
+        }
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_shards.push_back(std::make_unique<Shard>(d_identity, shard_size()));
+        found = t_shards.emplace(d_id, d_shards.back().get()).first;
+    }
+    t_last = {d_id, found->second};
+    return *found->second;
+}
+
+template <typename Owner, typename Op, typename Key>
+std::size_t ShardedAccumulator<Owner, Op, Key>::shard_size() const
+{
+    if constexpr (Dense)
+        return d_owner.size();
+    else
+        return 0;
+}
+
+#endif //shardedaccumulator_hh_defd
@@ -0,0 +1,192 @@
+#include "shardedaccumulator.hh"
+#include "../../unittest/unittest.hh"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Counts per bucket. Takes merged updates in batches.
+    class Histogram: protected IndexProxifier<Histogram>
+    {
+        vector<long> d_counts;
+        size_t d_batches = 0;
+
+    public:
+        explicit Histogram(size_t size);
+
+        size_t size() const;
+        size_t batches() const;
+
+        using IndexProxifier<Histogram>::operator[];
+
+    private:
+        friend IndexProxifier<Histogram>;
+
+        long proxy_return_action(size_t key) const;
+        long proxy_accept_action(size_t key, long value);
+        void proxy_accept_batch(vector<pair<size_t, long>> const &updates);
+    };
+
+    Histogram::Histogram(size_t size)
+        : d_counts(size)
+    {}
+
+    size_t Histogram::size() const
+    {
+        return d_counts.size();
+    }
+
+    size_t Histogram::batches() const
+    {
+        return d_batches;
+    }
+
+    long Histogram::proxy_return_action(size_t key) const
+    {
+        return d_counts[key];
+    }
+
+    long Histogram::proxy_accept_action(size_t key, long value)
+    {
+        return d_counts[key] = value;
+    }
+
+    void Histogram::proxy_accept_batch(vector<pair<size_t, long>> const &updates)
+    {
+        for (auto const &[key, value]: updates)
+            d_counts[key] = value;
+        ++d_batches;
+    }
+
+    // Keyed by name, so accumulated in hash map shards.
+    class Scores: protected IndexProxifier<Scores>
+    {
+        map<string, int> d_scores;
+
+    public:
+        using IndexProxifier<Scores>::operator[];
+
+    private:
+        friend IndexProxifier<Scores>;
+
+        int proxy_return_action(string const &key) const;
+        void proxy_accept_action(string const &key, int value);
+    };
+
+    int Scores::proxy_return_action(string const &key) const
+    {
+        auto found = d_scores.find(key);
+        return found == d_scores.end() ? 0 : found->second;
+    }
+
+    void Scores::proxy_accept_action(string const &key, int value)
+    {
+        d_scores[key] = value;
+    }
+
+    struct Max
+    {
+        int operator()(int lhs, int rhs) const
+        {
+            return max(lhs, rhs);
+        }
+    };
+}
+
+int main()
+{
+    test("Accumulated values reach the owner on merge, once.",
+         []()
+         {
+             Histogram hist(8);
+             hist[size_t{2}] = 10;
+             ShardedAccumulator<Histogram> counts(hist);
+             counts[2] += 3;
+             counts[5] += 1;
+             counts[2] += 1;
+             long before = hist[2];
+             counts.merge();
+             counts.merge();
+             return before == 10
+                 && hist[2] == 14
+                 && hist[5] == 1
+                 && hist[0] == 0
+                 && hist.batches() == 1;
+         });
+
+    test("Each thread gets a shard, and merge adds them all up.",
+         []()
+         {
+             enum { Threads = 4, Increments = 100000, Buckets = 16 };
+             Histogram hist(Buckets);
+             ShardedAccumulator<Histogram> counts(hist);
+
+             vector<thread> workers;
+             for (int id = 0; id != Threads; ++id)
+                 workers.emplace_back(
+                     [&, id]()
+                     {
+                         for (int ix = 0; ix != Increments; ++ix)
+                             counts[(ix + id) % Buckets] += 1;
+                     });
+             for (thread &worker: workers)
+                 worker.join();
+             counts.merge();
+
+             for (size_t bucket = 0; bucket != Buckets; ++bucket)
+                 if (hist[bucket] != long(Threads) * Increments / Buckets)
+                     return false;
+             return counts.shards() == Threads;
+         });
+
+    test("Any associative operation, with keys that aren't indices.",
+         []()
+         {
+             Scores scores;
+             scores[string("ann")] = 50;
+             ShardedAccumulator<Scores, Max, string> best(scores, numeric_limits<int>::lowest());
+             thread other(
+                 [&]()
+                 {
+                     best.accumulate("bob", 70);
+                     best.accumulate("ann", 40);
+                 });
+             other.join();
+             best.accumulate("bob", 60);
+             best.accumulate("ann", 80);
+             best.merge();
+             return scores[string("ann")] == 80
+                 && scores[string("bob")] == 70;
+         });
+
+    test("A thread's shards of destroyed accumulators aren't reused.",
+         []()
+         {
+             Histogram hist(4);
+             for (int round = 0; round != 100; ++round)
+             {
+                 ShardedAccumulator<Histogram, plus<long>> counts(hist);
+                 counts[1] += 1;
+                 if (round % 2 == 0)
+                     counts.merge(); // Odd rounds' counts are dropped.
+             }
+             return hist[1] == 50;
+         });
+
+    test("accept_batch assigns one by one without a batch hook.",
+         []()
+         {
+             Scores scores;
+             ip::accept_batch(scores, vector<pair<string, int>>{{"x", 1}, {"y", 2}});
+             return scores[string("x")] == 1 && scores[string("y")] == 2;
+         });
+
+    return TestCount::result();
+}
@@ -0,0 +1,86 @@
+#ifndef mpscqueue_hh_defd
+#define mpscqueue_hh_defd
+
+#include <atomic>
+
+/**
+   Lock-free intrusive multi-producer single-consumer queue (D. Vyukov's).
+   Node must be default constructible and have a member
+
+       std::atomic<Node *> next;
+
+   push() is wait-free and may be called from any thread. pop() and empty()
+   may only be called by the one consumer. pop() may return null while a
+   push is halfway; the pushed node then shows up once that push completes.
+   The queue doesn't own the nodes.
+*/
+template <typename Node>
+class MpscQueue
+{
+    std::atomic<Node *> d_head; // Last pushed, producers' end.
+    Node *d_tail;               // Next to pop, consumer's end.
+    Node d_stub;
+
+public:
+    MpscQueue();
+    MpscQueue(MpscQueue const &other) = delete;
+
+    void push(Node *node);
+    Node *pop();
+    bool empty() const;
+};
+
+template <typename Node>
+MpscQueue<Node>::MpscQueue()
+    : d_head(&d_stub),
+      d_tail(&d_stub)
+{
+    d_stub.next.store(nullptr, std::memory_order_relaxed);
+}
+
+template <typename Node>
+void MpscQueue<Node>::push(Node *node)
+{
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node *previous = d_head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+}
+
+template <typename Node>
+Node *MpscQueue<Node>::pop()
+{
+    Node *tail = d_tail;
+    Node *next = tail->next.load(std::memory_order_acquire);
+    if (tail == &d_stub)
+    {
+        if (next == nullptr)
+            return nullptr;
+        d_tail = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr)
+    {
+        d_tail = next;
+        return tail;
+    }
+    if (tail != d_head.load(std::memory_order_acquire))
+        return nullptr; // A push is in progress.
+
+    // tail is the only node: put the stub behind it, so it can be taken.
+    push(&d_stub);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next == nullptr)
+        return nullptr;
+    d_tail = next;
+    return tail;
+}
+
+template <typename Node>
+bool MpscQueue<Node>::empty() const
+{
+    return d_tail->next.load(std::memory_order_acquire) == nullptr
+        && d_head.load(std::memory_order_acquire) == d_tail;
+}
+
+#endif //mpscqueue_hh_defd
@@ -0,0 +1,133 @@
+#include "shardedactor.hh"
+#include "../benchmark/benchmark.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Write throughput of a ShardedActor over hash maps, with as many shards as
+// producer threads, against one hash map behind a mutex, from 1 producer up
+// to all cores. Each producer writes its own keys; the time includes sync().
+
+using namespace std;
+
+namespace
+{
+    constexpr size_t WritesPerProducer = size_t(1) << 20;
+
+    class Table: protected IndexProxifier<Table>
+    {
+        unordered_map<uint64_t, uint64_t> d_values;
+
+    public:
+        using IndexProxifier<Table>::operator[];
+
+    private:
+        friend IndexProxifier<Table>;
+
+        uint64_t proxy_return_action(uint64_t key) const;
+        void proxy_accept_action(uint64_t key, uint64_t value);
+    };
+
+    uint64_t Table::proxy_return_action(uint64_t key) const
+    {
+        return d_values.at(key);
+    }
+
+    void Table::proxy_accept_action(uint64_t key, uint64_t value)
+    {
+        d_values[key] = value;
+    }
+
+    // The same map, shared by all producers.
+    class LockedTable: protected IndexProxifier<LockedTable>
+    {
+        mutex d_mutex;
+        unordered_map<uint64_t, uint64_t> d_values;
+
+    public:
+        using IndexProxifier<LockedTable>::operator[];
+
+    private:
+        friend IndexProxifier<LockedTable>;
+
+        uint64_t proxy_return_action(uint64_t key);
+        void proxy_accept_action(uint64_t key, uint64_t value);
+    };
+
+    uint64_t LockedTable::proxy_return_action(uint64_t key)
+    {
+        lock_guard<mutex> lock(d_mutex);
+        return d_values.at(key);
+    }
+
+    void LockedTable::proxy_accept_action(uint64_t key, uint64_t value)
+    {
+        lock_guard<mutex> lock(d_mutex);
+        d_values[key] = value;
+    }
+
+    // Runs producers threads, each calling produce(id), and then finish().
+    template <typename Produce, typename Finish>
+    double run(size_t producers, Produce &&produce, Finish &&finish)
+    {
+        auto const start = chrono::steady_clock::now();
+        vector<thread> threads;
+        for (size_t id = 0; id != producers; ++id)
+            threads.emplace_back(produce, id);
+        for (thread &thread: threads)
+            thread.join();
+        finish();
+        chrono::duration<double> const took = chrono::steady_clock::now() - start;
+        return took.count();
+    }
+}
+
+int main()
+{
+    size_t const cores = max(1u, thread::hardware_concurrency());
+    printf("%zu writes per producer, up to %zu producers\n", WritesPerProducer, cores);
+
+    vector<size_t> counts;  // 1, 2, 4, ... and all cores.
+    for (size_t producers = 1; producers < cores; producers *= 2)
+        counts.push_back(producers);
+    counts.push_back(cores);
+
+    for (size_t producers: counts)
+    {
+        double const writes = double(producers) * WritesPerProducer;
+
+        ShardedActor<Table, uint64_t> actor(producers, [](size_t) { return Table(); });
+        double const actorseconds = run(
+            producers,
+            [&](size_t id)
+            {
+                for (uint64_t ix = 0; ix != WritesPerProducer; ++ix)
+                    actor[ix * producers + id] = ix;
+                actor.flush();
+            },
+            [&]()
+            {
+                actor.sync();
+            });
+        report(("ShardedActor, producers " + to_string(producers)).c_str(), actorseconds, writes);
+
+        LockedTable locked;
+        double const lockedseconds = run(
+            producers,
+            [&](size_t id)
+            {
+                for (uint64_t ix = 0; ix != WritesPerProducer; ++ix)
+                    locked[ix * producers + id] = ix;
+            },
+            []()
+            {});
+        report(("mutex, producers " + to_string(producers)).c_str(), lockedseconds, writes);
+    }
+}
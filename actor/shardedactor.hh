@@ -0,0 +1,414 @@
+#ifndef shardedactor_hh_defd
+#define shardedactor_hh_defd
+
+#include "../indexproxifier.hh"
+#include "mpscqueue.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/**
+   Shared-nothing owner: the key space is partitioned over N worker threads,
+   each of which alone owns one shard, itself an IndexProxifier owner (e.g.
+   a hash map). Proxy operations become messages to the shard's worker:
+
+       ShardedActor<Table> table(8, [](std::size_t) { return Table(); });
+       table[key] = value;                       // Enqueued.
+       std::future<Value> pending = table[key];  // Enqueued too.
+       Value value = pending.get();              // Waits for the worker.
+       table.sync();                             // Waits for all of them.
+
+   Writes are batched per producer thread and shard: a batch is sent when it
+   is full, when the producer reads from that shard (so a thread reads its
+   own writes), or when it calls flush() or sync(). A producer thread that
+   exits sends its pending writes to the actors that still exist; writes
+   pending for an actor destroyed meanwhile are dropped. After that, as when
+   an actor of static storage duration is used or destroyed at exit, the
+   thread's messages are sent one by one.
+
+   Each worker has a lock-free MPSC queue of batches. It sleeps on an atomic
+   (C++20 wait/notify) when there is nothing to do.
+
+   A write the shard throws on is skipped, and the worker goes on with the
+   rest of the batch. Each shard keeps the first such error, which the next
+   sync() (of any thread) rethrows, once; errors no sync() collects are
+   dropped. Failing reads report through their futures.
+
+   Keys go to shard std::hash<Key>(key) % N (after scrambling the hash), and
+   are passed to the shard as they are. The workers stop, after working off
+   their queues, when the ShardedActor is destroyed.
+*/
+template <typename Owner, typename Key = std::size_t, typename Hash = std::hash<Key>>
+class ShardedActor: protected IndexProxifier<ShardedActor<Owner, Key, Hash>>
+{
+public:
+    typedef typename std::remove_cvref<
+        typename decltype(std::declval<Owner &>()[std::declval<Key const &>()])::indexproxifier_conversion_type
+        >::type value_type;
+
+private:
+    struct Write
+    {
+        Key key;
+        value_type value;
+    };
+
+    struct Read
+    {
+        Key key;
+        std::promise<value_type> reply;
+    };
+
+    struct Barrier
+    {
+        std::promise<void> reply;
+    };
+
+    typedef std::variant<Write, Read, Barrier> Message;
+
+    struct Batch
+    {
+        std::vector<Message> messages;
+        std::atomic<Batch *> next;
+    };
+
+    // One per shard, on cache lines of its own.
+    struct alignas(64) Worker
+    {
+        Owner owner;
+        MpscQueue<Batch> queue;
+        std::atomic<uint32_t> signal{0}; // Bumped after each push.
+        std::atomic<bool> stopping{false};
+        std::exception_ptr error; // First failed write since the last Barrier.
+        std::thread thread;
+
+        explicit Worker(Owner &&owner);
+    };
+
+    // What a producer thread has not sent yet.
+    struct Pending
+    {
+        std::vector<std::unique_ptr<Batch>> batches; // Per shard.
+    };
+
+    // A producer thread's Pendings, per actor. Sent when the thread exits.
+    struct ThreadPending
+    {
+        std::pair<uint64_t, Pending *> last{0, nullptr}; // The usual case.
+        std::unordered_map<uint64_t, Pending> byactor;
+
+        ~ThreadPending();
+    };
+
+    static inline std::atomic<uint64_t> s_nextid{1};
+    static inline std::mutex s_livemutex; // Guards live().
+    static inline thread_local bool t_exited = false; // ThreadPending is gone.
+
+    std::vector<std::unique_ptr<Worker>> d_workers;
+    std::size_t d_batchsize;
+    uint64_t const d_id; // Identifies this actor to producer threads.
+
+public:
+    // make(index) returns the Owner for shard index.
+    template <typename Make>
+    ShardedActor(std::size_t shards, Make &&make, std::size_t batchsize = 64);
+    ShardedActor(ShardedActor const &other) = delete;
+    ~ShardedActor();
+
+    std::size_t shards() const;
+    std::size_t shard_of(Key const &key) const;
+
+    // Sends the calling thread's pending writes.
+    void flush();
+
+    // Flushes, and waits until all shards have applied what they received.
+    // Rethrows the first error of a write since the last sync().
+    void sync();
+
+    using IndexProxifier<ShardedActor>::operator[];
+
+private:
+    friend IndexProxifier<ShardedActor>;
+
+    std::future<value_type> proxy_return_action(Key const &key);
+    void proxy_accept_action(Key const &key, value_type const &value);
+
+    static std::unordered_map<uint64_t, ShardedActor *> &live();
+    static ThreadPending &thread_pending();
+    Pending *pending();
+    void enqueue(std::size_t shard, Message &&message);
+    void send(std::size_t shard);
+    void send(std::size_t shard, Pending &pending);
+    void push(std::size_t shard, Batch *batch);
+
+    static void work(Worker &worker);
+    static void process(Worker &worker, Batch &batch);
+};
+
+template <typename Owner, typename Key, typename Hash>
+ShardedActor<Owner, Key, Hash>::Worker::Worker(Owner &&owner)
+    : owner(std::move(owner))
+{}
+
+template <typename Owner, typename Key, typename Hash>
+template <typename Make>
+ShardedActor<Owner, Key, Hash>::ShardedActor(std::size_t shards, Make &&make, std::size_t batchsize)
+    : d_batchsize(batchsize == 0 ? 1 : batchsize),
+      d_id(s_nextid++)
+{
+    for (std::size_t index = 0; index != shards; ++index)
+        d_workers.push_back(std::make_unique<Worker>(make(index)));
+    for (std::unique_ptr<Worker> &worker: d_workers)
+        worker->thread = std::thread(work, std::ref(*worker));
+
+    std::lock_guard<std::mutex> lock(s_livemutex);
+    live().emplace(d_id, this);
+}
+
+template <typename Owner, typename Key, typename Hash>
+ShardedActor<Owner, Key, Hash>::~ShardedActor()
+{
+    {
+        // Waits for exiting producer threads sending to us.
+        std::lock_guard<std::mutex> lock(s_livemutex);
+        live().erase(d_id);
+    }
+    flush();
+    if (not t_exited)
+        thread_pending().byactor.erase(d_id);
+    for (std::unique_ptr<Worker> &worker: d_workers)
+    {
+        worker->stopping.store(true, std::memory_order_release);
+        worker->signal.fetch_add(1, std::memory_order_release);
+        worker->signal.notify_one();
+    }
+    for (std::unique_ptr<Worker> &worker: d_workers)
+        worker->thread.join();
+}
+
+template <typename Owner, typename Key, typename Hash>
+std::size_t ShardedActor<Owner, Key, Hash>::shards() const
+{
+    return d_workers.size();
+}
+
+// Scrambles the hash first: std::hash of an integer is often the integer.
+template <typename Owner, typename Key, typename Hash>
+std::size_t ShardedActor<Owner, Key, Hash>::shard_of(Key const &key) const
+{
+    uint64_t mixed = static_cast<uint64_t>(Hash{}(key)) * 0x9e3779b97f4a7c15;
+    return (mixed >> 32) % d_workers.size();
+}
+
+template <typename Owner, typename Key, typename Hash>
+void ShardedActor<Owner, Key, Hash>::flush()
+{
+    for (std::size_t shard = 0; shard != d_workers.size(); ++shard)
+        send(shard);
+}
+
+template <typename Owner, typename Key, typename Hash>
+void ShardedActor<Owner, Key, Hash>::sync()
+{
+    std::vector<std::future<void>> done;
+    for (std::size_t shard = 0; shard != d_workers.size(); ++shard)
+    {
+        Barrier barrier;
+        done.push_back(barrier.reply.get_future());
+        enqueue(shard, Message(std::move(barrier)));
+        send(shard);
+    }
+    for (std::future<void> &future: done)
+        future.wait();
+    for (std::future<void> &future: done)
+        future.get();
+}
+
+// The read is sent at once, after the writes this thread batched for the
+// shard, so it sees them.
+template <typename Owner, typename Key, typename Hash>
+std::future<typename ShardedActor<Owner, Key, Hash>::value_type>
+ShardedActor<Owner, Key, Hash>::proxy_return_action(Key const &key)
+{
+    std::size_t const shard = shard_of(key);
+    Read read{key, {}};
+    std::future<value_type> result = read.reply.get_future();
+    enqueue(shard, Message(std::move(read)));
+    send(shard);
+    return result;
+}
+
+template <typename Owner, typename Key, typename Hash>
+void ShardedActor<Owner, Key, Hash>::proxy_accept_action(Key const &key, value_type const &value)
+{
+    enqueue(shard_of(key), Message(Write{key, value}));
+}
+
+// Runs at thread exit. Holding s_livemutex keeps the actors alive. Actors
+// used later in the thread's exit (t_exited) no longer come here.
+template <typename Owner, typename Key, typename Hash>
+ShardedActor<Owner, Key, Hash>::ThreadPending::~ThreadPending()
+{
+    t_exited = true;
+    std::lock_guard<std::mutex> lock(s_livemutex);
+    for (auto &[id, pending]: byactor)
+        if (auto actor = live().find(id); actor != live().end())
+            for (std::size_t shard = 0; shard != pending.batches.size(); ++shard)
+                actor->second->send(shard, pending);
+}
+
+// Function-local, so that it outlives actors of static storage duration.
+template <typename Owner, typename Key, typename Hash>
+std::unordered_map<uint64_t, ShardedActor<Owner, Key, Hash> *> &ShardedActor<Owner, Key, Hash>::live()
+{
+    static std::unordered_map<uint64_t, ShardedActor *> s_live;
+    return s_live;
+}
+
+template <typename Owner, typename Key, typename Hash>
+typename ShardedActor<Owner, Key, Hash>::ThreadPending &ShardedActor<Owner, Key, Hash>::thread_pending()
+{
+    thread_local ThreadPending t_pending;
+    return t_pending;
+}
+
+// The calling thread's pending batches for this actor, or nullptr once its
+// ThreadPending is destroyed. Ids are never reused, so entries of destroyed
+// actors are never looked up again; they are pruned when an entry is added.
+template <typename Owner, typename Key, typename Hash>
+typename ShardedActor<Owner, Key, Hash>::Pending *ShardedActor<Owner, Key, Hash>::pending()
+{
+    if (t_exited)
+        return nullptr;
+    ThreadPending &mine = thread_pending();
+    if (mine.last.first != d_id)
+    {
+        auto found = mine.byactor.find(d_id);
+        if (found == mine.byactor.end())
+        {
+            {
+                std::lock_guard<std::mutex> lock(s_livemutex);
+                std::erase_if(mine.byactor,
+                              [](auto const &entry)
+                              {
+                                  return not live().contains(entry.first);
+                              });
+            }
+            found = mine.byactor.emplace(d_id, Pending{}).first;
+            found->second.batches.resize(d_workers.size());
+        }
+        mine.last = {d_id, &found->second};
+    }
+    return mine.last.second;
+}
+
+template <typename Owner, typename Key, typename Hash>
+void ShardedActor<Owner, Key, Hash>::enqueue(std::size_t shard, Message &&message)
+{
+    Pending *mine = pending();
+    if (not mine)
+    {
+        Batch *single = new Batch{};
+        single->messages.push_back(std::move(message));
+        push(shard, single);
+        return;
+    }
+    std::unique_ptr<Batch> &batch = mine->batches[shard];
+    if (not batch)
+    {
+        batch = std::make_unique<Batch>();
+        batch->messages.reserve(d_batchsize);
+    }
+    batch->messages.push_back(std::move(message));
+    if (batch->messages.size() >= d_batchsize)
+        send(shard, *mine);
+}
+
+template <typename Owner, typename Key, typename Hash>
+void ShardedActor<Owner, Key, Hash>::send(std::size_t shard)
+{
+    if (Pending *mine = pending())
+        send(shard, *mine);
+}
+
+template <typename Owner, typename Key, typename Hash>
+void ShardedActor<Owner, Key, Hash>::send(std::size_t shard, Pending &pending)
+{
+    if (pending.batches[shard])
+        push(shard, pending.batches[shard].release());
+}
+
+template <typename Owner, typename Key, typename Hash>
+void ShardedActor<Owner, Key, Hash>::push(std::size_t shard, Batch *batch)
+{
+    Worker &worker = *d_workers[shard];
+    worker.queue.push(batch);
+    worker.signal.fetch_add(1, std::memory_order_release);
+    worker.signal.notify_one(); // Cheap if the worker isn't waiting.
+}
+
+// Reads the signal before looking at the queue: a batch pushed after the
+// queue was found empty has bumped it, so the wait returns at once.
+template <typename Owner, typename Key, typename Hash>
+void ShardedActor<Owner, Key, Hash>::work(Worker &worker)
+{
+    while (true)
+    {
+        uint32_t const seen = worker.signal.load(std::memory_order_acquire);
+        while (Batch *batch = worker.queue.pop())
+            process(worker, *std::unique_ptr<Batch>(batch));
+        if (worker.stopping.load(std::memory_order_acquire) && worker.queue.empty())
+            return;
+        worker.signal.wait(seen, std::memory_order_acquire);
+    }
+}
+
+template <typename Owner, typename Key, typename Hash>
+void ShardedActor<Owner, Key, Hash>::process(Worker &worker, Batch &batch)
+{
+    for (Message &message: batch.messages)
+    {
+        if (Write *write = std::get_if<Write>(&message))
+        {
+            try
+            {
+                worker.owner[write->key] = write->value;
+            }
+            catch (...)
+            {
+                if (not worker.error)
+                    worker.error = std::current_exception();
+            }
+        }
+        else if (Read *read = std::get_if<Read>(&message))
+        {
+            try
+            {
+                value_type value = worker.owner[read->key];
+                read->reply.set_value(std::move(value));
+            }
+            catch (...)
+            {
+                read->reply.set_exception(std::current_exception()); // Rethrown by get().
+            }
+        }
+        else if (worker.error)
+            std::get<Barrier>(message).reply.set_exception(std::exchange(worker.error, nullptr));
+        else
+            std::get<Barrier>(message).reply.set_value();
+    }
+}
+
+#endif //shardedactor_hh_defd
@@ -0,0 +1,200 @@
+#include "shardedactor.hh"
+#include "../../unittest/unittest.hh"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    atomic<size_t> g_accepted{0};
+
+    // One shard: a plain hash map, touched only by its worker. Refuses
+    // negative values.
+    class Table: protected IndexProxifier<Table>
+    {
+        unordered_map<size_t, long> d_values;
+
+    public:
+        using IndexProxifier<Table>::operator[];
+
+    private:
+        friend IndexProxifier<Table>;
+
+        long proxy_return_action(size_t key) const;
+        void proxy_accept_action(size_t key, long value);
+    };
+
+    long Table::proxy_return_action(size_t key) const
+    {
+        auto found = d_values.find(key);
+        if (found == d_values.end())
+            throw out_of_range("no such key");
+        return found->second;
+    }
+
+    void Table::proxy_accept_action(size_t key, long value)
+    {
+        if (value < 0)
+            throw invalid_argument("negative value");
+        d_values[key] = value;
+        ++g_accepted;
+    }
+
+    auto make_table = [](size_t)
+    {
+        return Table();
+    };
+}
+
+int main()
+{
+    test("A thread reads its own writes.",
+         []()
+         {
+             ShardedActor<Table> table(4, make_table);
+             table[size_t{7}] = 70;
+             table[size_t{8}] = 80;
+             future<long> seven = table[size_t{7}];
+             future<long> eight = table[size_t{8}];
+             return seven.get() == 70 && eight.get() == 80;
+         });
+
+    test("Writes are batched until flushed.",
+         []()
+         {
+             ShardedActor<Table> table(2, make_table, 64);
+             g_accepted = 0;
+             for (size_t key = 0; key != 10; ++key)
+                 table[key] = long(key);
+             size_t before = g_accepted;
+             table.sync();
+             return before == 0 && g_accepted == 10;
+         });
+
+    test("Exiting producers send their pending writes.",
+         []()
+         {
+             ShardedActor<Table> table(2, make_table, 64);
+             thread producer(
+                 [&]()
+                 {
+                     for (size_t key = 0; key != 10; ++key)
+                         table[key] = long(key) + 1;
+                 });
+             producer.join();
+             table.sync();
+             future<long> nine = table[size_t{9}];
+             return nine.get() == 10;
+         });
+
+    test("Threads drop their pending batches of destroyed actors.",
+         []()
+         {
+             g_accepted = 0;
+             for (int round = 0; round != 100; ++round)
+             {
+                 auto table = make_unique<ShardedActor<Table>>(1, make_table);
+                 (*table)[size_t(round)] = round;  // Pending in this thread,
+                 thread([&]() { table.reset(); }).join(); // not the destroying one.
+             }
+             return g_accepted == 0;
+         });
+
+    test("Actors outliving their thread's pending batches still work.",
+         []()
+         {
+             g_accepted = 0;
+             thread(
+                 []()
+                 {
+                     // Both destroyed after the thread's pending batches,
+                     // which are created by the first write; like an actor
+                     // of static storage duration at exit.
+                     thread_local ShardedActor<Table> table(2, make_table, 64);
+                     thread_local struct Late
+                     {
+                         ~Late()
+                         {
+                             table[size_t{2}] = 2;
+                         }
+                     } late;
+                     table[size_t{1}] = 1;
+                 }).join();
+             return g_accepted == 2;
+         });
+
+    test("Failing reads report through the future.",
+         []()
+         {
+             ShardedActor<Table> table(2, make_table);
+             future<long> missing = table[size_t{3}];
+             try
+             {
+                 missing.get();
+             }
+             catch (out_of_range const &)
+             {
+                 return true;
+             }
+             return false;
+         });
+
+    test("A failing write is reported by sync(), once; the batch goes on.",
+         []()
+         {
+             ShardedActor<Table> table(1, make_table, 64);
+             table[size_t{1}] = 10;
+             table[size_t{2}] = -20;
+             table[size_t{3}] = -30;
+             table[size_t{4}] = 40;
+             bool reported = false;
+             try
+             {
+                 table.sync();
+             }
+             catch (invalid_argument const &)
+             {
+                 reported = true;
+             }
+             table.sync();                       // Does not throw again.
+             future<long> one = table[size_t{1}];
+             future<long> four = table[size_t{4}];
+             return reported && one.get() == 10 && four.get() == 40;
+         });
+
+    test("Many producers, many shards.",
+         []()
+         {
+             enum { Producers = 4, Keys = 20000 };
+             ShardedActor<Table> table(4, make_table, 32);
+
+             vector<thread> producers;
+             for (int id = 0; id != Producers; ++id)
+                 producers.emplace_back(
+                     [&, id]()
+                     {
+                         for (size_t key = id; key < Keys; key += Producers)
+                             table[key] = 3 * long(key);
+                         table.flush();
+                     });
+             for (thread &producer: producers)
+                 producer.join();
+             table.sync();
+
+             vector<future<long>> reads;
+             for (size_t key = 0; key != Keys; ++key)
+                 reads.push_back(table[key]);
+             for (size_t key = 0; key != Keys; ++key)
+                 if (reads[key].get() != 3 * long(key))
+                     return false;
+             return true;
+         });
+
+    return TestCount::result();
+}
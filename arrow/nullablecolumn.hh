@@ -0,0 +1,354 @@
+#ifndef nullablecolumn_hh_defd
+#define nullablecolumn_hh_defd
+
+#include "../indexproxifier.hh"
+#include "../bitset/bitsetkernels.hh"
+#include "../soa/alignedallocator.hh"
+#include "nullablekernels.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+   Column of numbers that may be null, laid out as an Arrow fixed-width
+   primitive array (with offset 0): a buffer of values and a validity
+   bitmap, bit ix % 8 of byte ix / 8 set if element ix is valid. Elements
+   are std::optional<T>:
+
+       NullableColumn<double> prices(3);   // All null.
+       prices[0] = 9.5;
+       prices[1] = std::nullopt;
+       std::optional<double> price = prices[0];
+       double total = prices.sum();        // Of the valid elements.
+
+   Buffers allocated here are 64-byte aligned, and padded to multiples of
+   64 bytes, as Arrow recommends. values() and validity() expose them;
+   release() hands them over, along with a function to free them, and
+   adopt() takes over buffers from elsewhere, so data can move to and from
+   Arrow libraries (as buffers[1] and buffers[0]) without being copied.
+   Adopted buffers are written in place; growing past their size moves
+   the elements to buffers of our own.
+
+   Values of null elements are left as they are, as Arrow allows.
+   null_count() is kept up to date by writes; count() and sum() use the
+   vectorised kernels of BitsetKernels and NullableKernels.
+*/
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+class NullableColumn: protected IndexProxifier<NullableColumn<T>>
+{
+    enum : std::size_t
+    {
+        Alignment = 64,
+        Granule = 512,      // Elements whose bits and values fill 64 bytes.
+    };
+
+    T *d_values = nullptr;
+    uint8_t *d_validity = nullptr;
+    std::size_t d_size = 0;
+    std::size_t d_capacity = 0;
+    std::size_t d_nulls = 0;
+    std::function<void()> d_release; // Frees d_values and d_validity.
+
+public:
+    typedef typename NullableKernels<T>::Sum sum_type;
+
+    // An Arrow array's buffers, and how to free them.
+    struct Buffers
+    {
+        T *values;
+        uint8_t *validity;          // Null if all elements are valid.
+        std::size_t size;
+        std::function<void()> release;
+    };
+
+    explicit NullableColumn(std::size_t size = 0);
+    NullableColumn(NullableColumn &&tmp) noexcept;
+    NullableColumn(NullableColumn const &other) = delete;
+    ~NullableColumn();
+
+    // validity must be 8-byte aligned.
+    static NullableColumn adopt(Buffers buffers);
+    Buffers release() &&;
+
+    std::size_t size() const;
+    void push_back(std::optional<T> value);
+    void reserve(std::size_t capacity);
+
+    bool is_valid(std::size_t ix) const;
+    std::size_t null_count() const;
+
+    std::span<T> values();
+    std::span<T const> values() const;
+    std::span<uint8_t> validity();          // (size() + 7) / 8 bytes.
+    std::span<uint8_t const> validity() const;
+
+    // Of the valid elements.
+    std::size_t count() const;
+    sum_type sum() const;
+
+    using IndexProxifier<NullableColumn>::operator[];
+
+private:
+    friend IndexProxifier<NullableColumn>;
+
+    std::optional<T> proxy_return_action(std::size_t ix) const;
+    std::optional<T> proxy_accept_action(std::size_t ix, std::optional<T> value);
+
+    NullableColumn(Buffers buffers, std::size_t capacity);
+    static Buffers allocate(std::size_t capacity);
+    void set_valid(std::size_t ix, bool valid);
+};
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+NullableColumn<T>::NullableColumn(std::size_t size)
+{
+    reserve(size);
+    d_size = size;
+    d_nulls = size;
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+NullableColumn<T>::NullableColumn(NullableColumn &&tmp) noexcept
+    : d_values(std::exchange(tmp.d_values, nullptr)),
+      d_validity(std::exchange(tmp.d_validity, nullptr)),
+      d_size(std::exchange(tmp.d_size, 0)),
+      d_capacity(std::exchange(tmp.d_capacity, 0)),
+      d_nulls(std::exchange(tmp.d_nulls, 0)),
+      d_release(std::exchange(tmp.d_release, nullptr))
+{}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+NullableColumn<T>::~NullableColumn()
+{
+    if (d_release)
+        d_release();
+}
+
+// Without a validity bitmap all are valid, but writes need one.
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+NullableColumn<T> NullableColumn<T>::adopt(Buffers buffers)
+{
+    if (reinterpret_cast<uintptr_t>(buffers.validity) % alignof(uint64_t) != 0)
+        throw std::invalid_argument("NullableColumn::adopt: validity bitmap not 8-byte aligned");
+
+    if (buffers.validity == nullptr)
+    {
+        Buffers own = allocate(buffers.size);
+        std::memset(own.validity, 0xff, buffers.size / 8);
+        if (buffers.size % 8 != 0)
+            own.validity[buffers.size / 8] = (1u << buffers.size % 8) - 1;
+        std::function<void()> release = std::move(buffers.release);
+        buffers.validity = own.validity;
+        buffers.release = [release = std::move(release), own = std::move(own)]()
+                          {
+                              own.release();
+                              if (release)
+                                  release();
+                          };
+    }
+    std::size_t const size = buffers.size;
+    return NullableColumn(std::move(buffers), size);
+}
+
+// Leaves this column empty.
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+auto NullableColumn<T>::release() && -> Buffers
+{
+    Buffers buffers{d_values, d_validity, d_size, std::move(d_release)};
+    d_values = nullptr;
+    d_validity = nullptr;
+    d_size = d_capacity = d_nulls = 0;
+    d_release = nullptr;
+    return buffers;
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+std::size_t NullableColumn<T>::size() const
+{
+    return d_size;
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+void NullableColumn<T>::push_back(std::optional<T> value)
+{
+    if (d_size == d_capacity)
+        reserve(std::max<std::size_t>(2 * d_capacity, Granule));
+    ++d_size;
+    ++d_nulls;
+    proxy_accept_action(d_size - 1, value);
+}
+
+// Moves the elements to new buffers of our own.
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+void NullableColumn<T>::reserve(std::size_t capacity)
+{
+    if (capacity <= d_capacity)
+        return;
+    capacity = (capacity + Granule - 1) / Granule * Granule;
+    Buffers buffers = allocate(capacity);
+    if (d_size != 0)
+    {
+        std::memcpy(buffers.values, d_values, d_size * sizeof(T));
+        std::memcpy(buffers.validity, d_validity, (d_size + 7) / 8);
+        if (d_size % 8 != 0) // Arrow doesn't promise the bits beyond size are 0.
+            buffers.validity[d_size / 8] &= (1u << d_size % 8) - 1;
+    }
+    if (d_release)
+        d_release();
+    d_values = buffers.values;
+    d_validity = buffers.validity;
+    d_release = std::move(buffers.release);
+    d_capacity = capacity;
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+bool NullableColumn<T>::is_valid(std::size_t ix) const
+{
+    return d_validity[ix / 8] >> ix % 8 & 1;
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+std::size_t NullableColumn<T>::null_count() const
+{
+    return d_nulls;
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+std::span<T> NullableColumn<T>::values()
+{
+    return {d_values, d_size};
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+std::span<T const> NullableColumn<T>::values() const
+{
+    return {d_values, d_size};
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+std::span<uint8_t> NullableColumn<T>::validity()
+{
+    return {d_validity, (d_size + 7) / 8};
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+std::span<uint8_t const> NullableColumn<T>::validity() const
+{
+    return {d_validity, (d_size + 7) / 8};
+}
+
+// Whole words with the popcount kernel, then the bits of the last one.
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+std::size_t NullableColumn<T>::count() const
+{
+    std::size_t const words = d_size / 64;
+    std::size_t total = words == 0
+        ? 0
+        : BitsetKernels::best().popcount(reinterpret_cast<uint64_t const *>(d_validity), words);
+    for (std::size_t ix = words * 64; ix != d_size; ++ix)
+        total += is_valid(ix);
+    return total;
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+auto NullableColumn<T>::sum() const -> sum_type
+{
+    return NullableKernels<T>::best().sum(d_values, d_validity, d_size);
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+std::optional<T> NullableColumn<T>::proxy_return_action(std::size_t ix) const
+{
+    if (not is_valid(ix))
+        return std::nullopt;
+    return d_values[ix];
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+std::optional<T> NullableColumn<T>::proxy_accept_action(std::size_t ix, std::optional<T> value)
+{
+    if (value)
+        d_values[ix] = *value;
+    set_valid(ix, value.has_value());
+    return value;
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+NullableColumn<T>::NullableColumn(Buffers buffers, std::size_t capacity)
+    : d_values(buffers.values),
+      d_validity(buffers.validity),
+      d_size(buffers.size),
+      d_capacity(capacity),
+      d_release(std::move(buffers.release))
+{
+    d_nulls = d_size - count();
+}
+
+// Values and validity in one allocation each, both zeroed: all null.
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+auto NullableColumn<T>::allocate(std::size_t capacity) -> Buffers
+{
+    typedef AlignedAllocator<T, Alignment> ValueAllocator;
+    typedef AlignedAllocator<uint64_t, Alignment> WordAllocator;
+
+    std::size_t const values = (capacity * sizeof(T) + Alignment - 1) / Alignment * Alignment / sizeof(T);
+    std::size_t const words = (capacity + 511) / 512 * 8;
+    T *valuebuffer = ValueAllocator().allocate(std::max<std::size_t>(values, 1));
+    uint64_t *wordbuffer = WordAllocator().allocate(std::max<std::size_t>(words, 1));
+    std::fill_n(valuebuffer, values, T());
+    std::fill_n(wordbuffer, words, 0);
+    return Buffers{valuebuffer, reinterpret_cast<uint8_t *>(wordbuffer), 0,
+                   [=]()
+                   {
+                       ValueAllocator().deallocate(valuebuffer, std::max<std::size_t>(values, 1));
+                       WordAllocator().deallocate(wordbuffer, std::max<std::size_t>(words, 1));
+                   }};
+}
+
+template <typename T>
+    requires std::is_arithmetic_v<T> && (not std::is_same_v<T, bool>)
+void NullableColumn<T>::set_valid(std::size_t ix, bool valid)
+{
+    uint8_t &byte = d_validity[ix / 8];
+    uint8_t const bit = uint8_t(1) << ix % 8;
+    if (bool(byte & bit) != valid)
+    {
+        if (valid)
+            --d_nulls;
+        else
+            ++d_nulls;
+        byte ^= bit;
+    }
+}
+
+#endif //nullablecolumn_hh_defd
@@ -0,0 +1,136 @@
+#include "nullablecolumn.hh"
+#include "../../unittest/unittest.hh"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+    test("Elements are optionals; nullopt clears the validity bit.",
+         []()
+         {
+             NullableColumn<int32_t> column(10);
+             size_t const initially = column.null_count();
+             column[2] = 7;
+             column[9] = -1;
+             column[9] = nullopt;
+             optional<int32_t> two = column[2];
+             optional<int32_t> nine = column[9];
+             return initially == 10
+                 && two == 7
+                 && not nine
+                 && column.null_count() == 9
+                 && column.validity()[0] == 0b0000'0100
+                 && column.validity()[1] == 0;
+         });
+
+    test("Buffers are 64-byte aligned and laid out as Arrow's.",
+         []()
+         {
+             NullableColumn<double> column;
+             for (int ix = 0; ix != 1000; ++ix)
+                 column.push_back(ix % 3 == 0 ? optional<double>() : optional<double>(ix));
+             auto values = column.values();
+             auto validity = column.validity();
+             bool layout = true;
+             for (size_t ix = 0; ix != column.size(); ++ix)
+                 layout = layout
+                     && bool(validity[ix / 8] >> ix % 8 & 1) == (ix % 3 != 0)
+                     && (ix % 3 == 0 || values[ix] == double(ix));
+             return layout
+                 && reinterpret_cast<uintptr_t>(values.data()) % 64 == 0
+                 && reinterpret_cast<uintptr_t>(validity.data()) % 64 == 0
+                 && validity.size() == 125
+                 && column.null_count() == 334
+                 && column.count() == 666;
+         });
+
+    test("Sums skip nulls, whatever their values, in every kernel.",
+         []()
+         {
+             mt19937 random(5);
+             size_t const size = 10007;
+             vector<double> values(size);
+             vector<uint8_t> validity((size + 7) / 8 + 8);
+             double expected = 0;
+             for (size_t ix = 0; ix != size; ++ix)
+             {
+                 bool const valid = ix / 64 % 4 == 1                    // All-valid words,
+                     || (ix / 64 % 4 == 2 && random() % 2 == 0);       // mixed ones, and null ones.
+                 values[ix] = valid ? double(random() % 1000) : numeric_limits<double>::quiet_NaN();
+                 if (valid)
+                 {
+                     validity[ix / 8] |= 1 << ix % 8;
+                     expected += values[ix];
+                 }
+             }
+             for (auto const &kernels: NullableKernels<double>::available())
+                 if (kernels.sum(values.data(), validity.data(), size) != expected)
+                     return false;
+             return NullableKernels<double>::best().sum(values.data(), validity.data(), size) == expected;
+         });
+
+    test("Integer sums widen, and agree with a loop over the optionals.",
+         []()
+         {
+             NullableColumn<int16_t> column;
+             int64_t expected = 0;
+             for (int ix = 0; ix != 5000; ++ix)
+             {
+                 int16_t const value = static_cast<int16_t>(ix % 2 ? 30000 : -7);
+                 column.push_back(ix % 5 == 0 ? nullopt : optional<int16_t>(value));
+             }
+             for (size_t ix = 0; ix != column.size(); ++ix)
+                 if (optional<int16_t> value = column[ix])
+                     expected += *value;
+             return column.sum() == expected
+                 && expected > numeric_limits<int32_t>::max() / 100;
+         });
+
+    test("Adopted buffers are used in place, and freed once.",
+         []()
+         {
+             alignas(64) int64_t values[100] = {};
+             alignas(64) uint8_t validity[16] = {};
+             values[3] = 30;
+             validity[0] = 0b1000;
+             int released = 0;
+             {
+                 auto column = NullableColumn<int64_t>::adopt({values, validity, 100, [&]() { ++released; }});
+                 column[4] = 40;
+                 column[3] = nullopt;
+                 bool const inplace = values[4] == 40 && validity[0] == 0b1'0000;
+                 NullableColumn<int64_t> moved(std::move(column));
+                 if (not inplace || moved.null_count() != 99 || moved.sum() != 40 || released != 0)
+                     return false;
+                 moved.push_back(5);     // Outgrows the adopted buffers.
+                 if (released != 1 || moved.values().data() == values || moved.sum() != 45)
+                     return false;
+             }
+             return released == 1;
+         });
+
+    test("Without a validity bitmap all are valid; release hands the buffers over.",
+         []()
+         {
+             vector<float> values{1.5f, 2.5f, 4.0f};
+             auto column = NullableColumn<float>::adopt({values.data(), nullptr, 3, nullptr});
+             bool const allvalid = column.null_count() == 0 && column.sum() == 8.0;
+             column[1] = nullopt;
+             auto buffers = std::move(column).release();
+             bool const handed = buffers.values == values.data()
+                 && buffers.size == 3
+                 && buffers.validity[0] == 0b101
+                 && column.size() == 0;
+             buffers.release();
+             return allvalid && handed;
+         });
+
+    return TestCount::result();
+}
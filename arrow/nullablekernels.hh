@@ -0,0 +1,132 @@
+#ifndef nullablekernels_hh_defd
+#define nullablekernels_hh_defd
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__)
+    #define NULLABLEKERNELS_X86 1
+#else
+    #define NULLABLEKERNELS_X86 0
+#endif
+
+/**
+   Null-aware sum of size values, skipping those whose bit in the Arrow
+   validity bitmap (LSB first) is clear, for NullableColumn. Values of
+   null elements may be anything, NaN included: they are never added.
+
+   Each 64 elements share a validity word. All-null words are skipped,
+   all-valid ones summed straight, and others summed with the invalid
+   values selected away. Eight partial sums let the compiler vectorise
+   the loops without reordering floating point additions; as all versions
+   add in the same order, they give the same result. The scalar version
+   works anywhere; on x86, the same loops are compiled for AVX2 and for
+   AVX-512. best() picks the widest the CPU supports, once; available()
+   lists all usable ones, for testing.
+*/
+template <typename T>
+struct NullableKernels
+{
+    typedef std::conditional_t<std::is_floating_point_v<T>, double,
+                               std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>> Sum;
+
+    char const *name;
+    Sum (*sum)(T const *values, uint8_t const *validity, std::size_t size);
+
+    static NullableKernels const &best();
+    static std::vector<NullableKernels> available();
+};
+
+namespace nullable_detail
+{
+    enum : std::size_t
+    {
+        Lanes = 8,
+    };
+
+    template <typename Sum, typename T>
+    [[gnu::always_inline]] inline Sum masked_sum(T const *values, uint8_t const *validity, std::size_t size)
+    {
+        Sum lanes[Lanes] = {};
+        std::size_t ix = 0;
+        for (; ix + 64 <= size; ix += 64)
+        {
+            uint64_t bits;
+            std::memcpy(&bits, validity + ix / 8, sizeof bits); // Little endian: LSB first.
+            if (bits == ~uint64_t(0))
+            {
+                for (std::size_t group = 0; group != 64; group += Lanes)
+                    for (std::size_t lane = 0; lane != Lanes; ++lane)
+                        lanes[lane] += static_cast<Sum>(values[ix + group + lane]);
+            }
+            else if (bits != 0)
+            {
+                for (std::size_t group = 0; group != 64; group += Lanes)
+                    for (std::size_t lane = 0; lane != Lanes; ++lane)
+                        lanes[lane] += (bits >> (group + lane) & 1) != 0
+                            ? static_cast<Sum>(values[ix + group + lane])
+                            : Sum(0);
+            }
+        }
+        for (; ix != size; ++ix)
+            if (validity[ix / 8] >> ix % 8 & 1)
+                lanes[ix % Lanes] += static_cast<Sum>(values[ix]);
+
+        Sum total = 0;
+        for (Sum lane: lanes)
+            total += lane;
+        return total;
+    }
+
+    template <typename Sum, typename T>
+    Sum scalar_sum(T const *values, uint8_t const *validity, std::size_t size)
+    {
+        return masked_sum<Sum>(values, validity, size);
+    }
+
+#if NULLABLEKERNELS_X86
+    template <typename Sum, typename T>
+    __attribute__((target("avx2")))
+    Sum avx2_sum(T const *values, uint8_t const *validity, std::size_t size)
+    {
+        return masked_sum<Sum>(values, validity, size);
+    }
+
+    template <typename Sum, typename T>
+    __attribute__((target("avx512f,avx512bw,avx512vl")))
+    Sum avx512_sum(T const *values, uint8_t const *validity, std::size_t size)
+    {
+        return masked_sum<Sum>(values, validity, size);
+    }
+#endif
+}
+
+template <typename T>
+NullableKernels<T> const &NullableKernels<T>::best()
+{
+    static NullableKernels const chosen = available().back();
+    return chosen;
+}
+
+// From narrow to wide.
+template <typename T>
+std::vector<NullableKernels<T>> NullableKernels<T>::available()
+{
+    using namespace nullable_detail;
+
+    std::vector<NullableKernels> kernels{{"scalar", scalar_sum<Sum, T>}};
+#if NULLABLEKERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        kernels.push_back({"avx2", avx2_sum<Sum, T>});
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+        && __builtin_cpu_supports("avx512vl"))
+        kernels.push_back({"avx512", avx512_sum<Sum, T>});
+#endif
+    return kernels;
+}
+
+#endif //nullablekernels_hh_defd
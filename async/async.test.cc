@@ -0,0 +1,361 @@
+#include "eventloop.hh"
+#include "../indexproxifier.hh"
+#include "../../unittest/unittest.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+    // Wire format between RemoteTable and the stand-in daemon.
+    struct Message
+    {
+        enum : uint32_t { Read, Write };
+
+        uint32_t tag;
+        uint32_t op;
+        int32_t key;
+        int32_t value;
+    };
+
+    // Connected pair of non-blocking datagram-ish sockets.
+    struct SocketPair
+    {
+        int fd[2];
+
+        SocketPair()
+        {
+            if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fd) < 0)
+                throw runtime_error("socketpair failed");
+        }
+
+        ~SocketPair()
+        {
+            close(fd[0]);
+            close(fd[1]);
+        }
+    };
+
+    Task<void> send_message(EventLoop &loop, int fd, Message message)
+    {
+        while (send(fd, &message, sizeof message, 0) < 0)
+        {
+            if (errno != EAGAIN && errno != EINTR)
+                throw runtime_error("send failed");
+            co_await loop.writable(fd);
+        }
+    }
+
+    // Stand-in for a remote daemon holding the data. Answers each request
+    // with the (new) value of the element.
+    Task<void> serve(EventLoop &loop, int fd, vector<int> &data)
+    {
+        while (true)
+        {
+            co_await loop.readable(fd);
+            Message message;
+            while (recv(fd, &message, sizeof message, 0) == sizeof message)
+            {
+                if (message.op == Message::Write)
+                    data.at(message.key) = message.value;
+                message.value = data.at(message.key);
+                co_await send_message(loop, fd, message);
+            }
+        }
+    }
+
+    // Table living in the daemon. Requests are tagged, so many can be in
+    // flight, and replies may come in any order.
+    class RemoteTable: protected IndexProxifier<RemoteTable>
+    {
+        class Reply;
+
+        EventLoop &d_loop;
+        int d_fd;
+        uint32_t d_nexttag = 0;
+        unordered_map<uint32_t, Reply *> d_pending;
+        size_t d_maxinflight = 0;
+
+    public:
+        RemoteTable(EventLoop &loop, int fd);
+
+        size_t max_in_flight() const;
+
+        using IndexProxifier<RemoteTable>::operator[];
+
+    private:
+        friend IndexProxifier<RemoteTable>;
+
+        Task<int> proxy_return_async(int key);
+        Task<int> proxy_accept_async(int key, int value);
+
+        Task<int> request(uint32_t op, int key, int value);
+        Task<void> receive();
+    };
+
+    // Awaits the reply to one tagged request.
+    class RemoteTable::Reply
+    {
+        RemoteTable &d_table;
+        uint32_t d_tag;
+        coroutine_handle<> d_handle;
+        int d_value = 0;
+
+        friend RemoteTable;
+
+    public:
+        Reply(RemoteTable &table, uint32_t tag)
+            : d_table(table),
+              d_tag(tag)
+        {}
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(coroutine_handle<> handle)
+        {
+            d_handle = handle;
+            d_table.d_pending[d_tag] = this;
+            d_table.d_maxinflight = max(d_table.d_maxinflight, d_table.d_pending.size());
+        }
+
+        int await_resume() const noexcept
+        {
+            return d_value;
+        }
+    };
+
+    RemoteTable::RemoteTable(EventLoop &loop, int fd)
+        : d_loop(loop),
+          d_fd(fd)
+    {
+        d_loop.spawn(receive());
+    }
+
+    size_t RemoteTable::max_in_flight() const
+    {
+        return d_maxinflight;
+    }
+
+    Task<int> RemoteTable::proxy_return_async(int key)
+    {
+        return request(Message::Read, key, 0);
+    }
+
+    Task<int> RemoteTable::proxy_accept_async(int key, int value)
+    {
+        return request(Message::Write, key, value);
+    }
+
+    Task<int> RemoteTable::request(uint32_t op, int key, int value)
+    {
+        uint32_t tag = d_nexttag++;
+        co_await send_message(d_loop, d_fd, Message{tag, op, key, value});
+        co_return co_await Reply(*this, tag);
+    }
+
+    Task<void> RemoteTable::receive()
+    {
+        while (true)
+        {
+            co_await d_loop.readable(d_fd);
+            Message message;
+            while (recv(d_fd, &message, sizeof message, 0) == sizeof message)
+            {
+                auto found = d_pending.find(message.tag);
+                if (found == d_pending.end())
+                    continue;
+                found->second->d_value = message.value;
+                d_loop.schedule(found->second->d_handle);
+                d_pending.erase(found);
+            }
+        }
+    }
+
+    Task<void> read_into(RemoteTable &table, int key, int &value, size_t &done)
+    {
+        value = co_await table[key];
+        ++done;
+    }
+
+    Task<void> write_twice(RemoteTable &table, int key, size_t &done)
+    {
+        co_await (table[key] = 2 * key);
+        ++done;
+    }
+
+    Task<size_t> wait_for(EventLoop &loop, size_t &done, size_t count)
+    {
+        while (done != count)
+            co_await loop.yield();
+        co_return done;
+    }
+}
+
+int main()
+{
+    test("co_await reads an element through proxy_return_async.",
+         []()
+         {
+             SocketPair sockets;
+             vector<int> data{5, 7, 11};
+             EventLoop loop;
+             loop.spawn(serve(loop, sockets.fd[1], data));
+             RemoteTable table(loop, sockets.fd[0]);
+             int value = loop.run(
+                 [](RemoteTable &table) -> Task<int>
+                 {
+                     co_return co_await table[1] + co_await table[2];
+                 }(table));
+             return value == 18;
+         });
+
+    test("Assignment returns the awaitable of proxy_accept_async.",
+         []()
+         {
+             SocketPair sockets;
+             vector<int> data{0, 0};
+             EventLoop loop;
+             loop.spawn(serve(loop, sockets.fd[1], data));
+             RemoteTable table(loop, sockets.fd[0]);
+             int value = loop.run(
+                 [](RemoteTable &table) -> Task<int>
+                 {
+                     co_return co_await (table[1] = 42);
+                 }(table));
+             return value == 42 && data[1] == 42;
+         });
+
+    test("Many lookups are in flight concurrently on one thread.",
+         []()
+         {
+             enum { Count = 1000 };
+             SocketPair sockets;
+             vector<int> data(Count);
+             for (int ix = 0; ix != Count; ++ix)
+                 data[ix] = ix * ix;
+             EventLoop loop;
+             loop.spawn(serve(loop, sockets.fd[1], data));
+             RemoteTable table(loop, sockets.fd[0]);
+
+             vector<int> values(Count, -1);
+             size_t done = 0;
+             for (int ix = 0; ix != Count; ++ix)
+                 loop.spawn(read_into(table, ix, values[ix], done));
+             loop.run(wait_for(loop, done, Count));
+
+             for (int ix = 0; ix != Count; ++ix)
+                 if (values[ix] != ix * ix)
+                     return false;
+             return table.max_in_flight() > 1;
+         });
+
+    test("Concurrent writes all land.",
+         []()
+         {
+             enum { Count = 500 };
+             SocketPair sockets;
+             vector<int> data(Count);
+             EventLoop loop;
+             loop.spawn(serve(loop, sockets.fd[1], data));
+             RemoteTable table(loop, sockets.fd[0]);
+
+             size_t done = 0;
+             for (int ix = 0; ix != Count; ++ix)
+                 loop.spawn(write_twice(table, ix, done));
+             loop.run(wait_for(loop, done, Count));
+
+             for (int ix = 0; ix != Count; ++ix)
+                 if (data[ix] != 2 * ix)
+                     return false;
+             return true;
+         });
+
+    test("An exception from a spawned task comes out of run().",
+         []()
+         {
+             EventLoop loop;
+             size_t done = 0;
+             loop.spawn(
+                 [](EventLoop &loop) -> Task<void>
+                 {
+                     co_await loop.yield();
+                     throw runtime_error("spawned");
+                 }(loop));
+             try
+             {
+                 loop.run(wait_for(loop, done, 1)); // Never done by itself.
+             }
+             catch (runtime_error const &error)
+             {
+                 return string(error.what()) == "spawned";
+             }
+             return false;
+         });
+
+    test("Finished spawned tasks are released; the others keep running.",
+         []()
+         {
+             EventLoop loop;
+             auto token = make_shared<int>(0);
+             size_t done = 0;
+             for (int ix = 0; ix != 100; ++ix)
+                 loop.spawn(
+                     [](EventLoop &loop, shared_ptr<int>, size_t &done, int turns) -> Task<void>
+                     {
+                         for (int turn = 0; turn < turns; ++turn)
+                             co_await loop.yield();
+                         ++done;
+                     }(loop, token, done, ix % 2 == 0 ? 1 : 1000));
+             loop.run(wait_for(loop, done, 50));
+             long const half = token.use_count();
+             loop.run(wait_for(loop, done, 100));
+             return half == 51 && token.use_count() == 1;
+         });
+
+    test("A hung up fd nobody waits for doesn't make the loop spin.",
+         []()
+         {
+             SocketPair idle;
+             SocketPair slow;
+             EventLoop loop;
+             loop.run(
+                 [](EventLoop &loop, int fd) -> Task<void>
+                 {
+                     co_await loop.writable(fd);  // Registers fd, then leaves it.
+                 }(loop, idle.fd[0]));
+             shutdown(idle.fd[1], SHUT_RDWR);    // Now idle.fd[0] reports EPOLLHUP.
+
+             thread later(
+                 [&]()
+                 {
+                     this_thread::sleep_for(chrono::milliseconds(200));
+                     Message message{};
+                     send(slow.fd[1], &message, sizeof message, 0);
+                 });
+             clock_t const before = clock();
+             loop.run(
+                 [](EventLoop &loop, int fd) -> Task<void>
+                 {
+                     co_await loop.readable(fd);
+                 }(loop, slow.fd[0]));
+             clock_t const spent = clock() - before;
+             later.join();
+             return spent < CLOCKS_PER_SEC / 20;
+         });
+
+    return TestCount::result();
+}
@@ -0,0 +1,323 @@
+#ifndef eventloop_hh_defd
+#define eventloop_hh_defd
+
+#include "task.hh"
+
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/**
+   Single-threaded epoll-based executor for Tasks.
+
+       EventLoop loop;
+       loop.spawn(server(loop, fd));     // Runs until the loop is destroyed.
+       int value = loop.run(client(loop, table));
+
+   Coroutines wait for file descriptors with co_await loop.readable(fd) or
+   co_await loop.writable(fd). Any number of coroutines may wait for the
+   same file descriptor; all of them are resumed when it becomes ready, and
+   should retry their operation. File descriptors should be non-blocking,
+   and must support epoll (not regular files).
+
+   An exception escaping a spawned Task is rethrown from run(), once the
+   Task has finished; if several finish with one in the same round, the
+   first is rethrown and the others are lost. When run() throws, its task
+   is kept by the loop (and may still run) until the loop is destroyed.
+
+   Owners with I/O-bound elements implement proxy_return_async and
+   proxy_accept_async as Tasks on a loop, so thousands of lookups can be in
+   flight on one thread.
+*/
+class EventLoop
+{
+    struct Waiters
+    {
+        std::vector<std::coroutine_handle<>> readers;
+        std::vector<std::coroutine_handle<>> writers;
+        bool registered = false;
+    };
+
+    int d_epoll;
+    std::deque<std::coroutine_handle<>> d_ready;
+    std::unordered_map<int, Waiters> d_waiters;
+    std::size_t d_waiting = 0;
+    std::unordered_map<void *, Task<void>> d_spawned; // By handle address.
+    std::vector<std::coroutine_handle<>> d_finished;  // Spawned, to reap.
+    std::vector<std::shared_ptr<void>> d_abandoned; // Tasks of failed run()s.
+
+    class FdAwaiter;
+    class YieldAwaiter;
+
+public:
+    EventLoop();
+    EventLoop(EventLoop const &other) = delete;
+    ~EventLoop();
+
+    FdAwaiter readable(int fd);
+    FdAwaiter writable(int fd);
+
+    // co_await loop.yield() lets the others run first.
+    YieldAwaiter yield();
+
+    // Resumes handle from the loop, later.
+    void schedule(std::coroutine_handle<> handle);
+
+    // Starts task, which the loop owns from now on.
+    void spawn(Task<void> task);
+
+    // Runs the loop until task is done, and returns its result.
+    template <typename T>
+    T run(Task<T> task);
+
+    // The file descriptor will be closed: forget about it.
+    void forget(int fd);
+
+private:
+    void wait(int fd, bool forwriting, std::coroutine_handle<> handle);
+    void update(int fd, Waiters &waiters);
+    void wake(std::vector<std::coroutine_handle<>> &handles);
+    void run_once();
+};
+
+class EventLoop::FdAwaiter
+{
+    EventLoop &d_loop;
+    int d_fd;
+    bool d_forwriting;
+
+public:
+    FdAwaiter(EventLoop &loop, int fd, bool forwriting);
+
+    bool await_ready() const noexcept;
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const noexcept;
+};
+
+inline EventLoop::FdAwaiter::FdAwaiter(EventLoop &loop, int fd, bool forwriting)
+    : d_loop(loop),
+      d_fd(fd),
+      d_forwriting(forwriting)
+{}
+
+inline bool EventLoop::FdAwaiter::await_ready() const noexcept
+{
+    return false;
+}
+
+inline void EventLoop::FdAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    d_loop.wait(d_fd, d_forwriting, handle);
+}
+
+inline void EventLoop::FdAwaiter::await_resume() const noexcept
+{}
+
+class EventLoop::YieldAwaiter
+{
+    EventLoop &d_loop;
+
+public:
+    explicit YieldAwaiter(EventLoop &loop);
+
+    bool await_ready() const noexcept;
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const noexcept;
+};
+
+inline EventLoop::YieldAwaiter::YieldAwaiter(EventLoop &loop)
+    : d_loop(loop)
+{}
+
+inline bool EventLoop::YieldAwaiter::await_ready() const noexcept
+{
+    return false;
+}
+
+inline void EventLoop::YieldAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    d_loop.schedule(handle);
+}
+
+inline void EventLoop::YieldAwaiter::await_resume() const noexcept
+{}
+
+inline EventLoop::EventLoop()
+    : d_epoll(epoll_create1(EPOLL_CLOEXEC))
+{
+    if (d_epoll < 0)
+        throw std::system_error(errno, std::system_category(), "epoll_create1");
+}
+
+inline EventLoop::~EventLoop()
+{
+    d_spawned.clear(); // Destroys suspended coroutines before the loop goes.
+    d_abandoned.clear();
+    close(d_epoll);
+}
+
+inline EventLoop::FdAwaiter EventLoop::readable(int fd)
+{
+    return FdAwaiter(*this, fd, false);
+}
+
+inline EventLoop::FdAwaiter EventLoop::writable(int fd)
+{
+    return FdAwaiter(*this, fd, true);
+}
+
+inline EventLoop::YieldAwaiter EventLoop::yield()
+{
+    return YieldAwaiter(*this);
+}
+
+inline void EventLoop::schedule(std::coroutine_handle<> handle)
+{
+    d_ready.push_back(handle);
+}
+
+// Room in d_finished for all spawned tasks, so that they can report
+// finishing without allocating.
+inline void EventLoop::spawn(Task<void> task)
+{
+    d_finished.reserve(d_spawned.size() + 1);
+    std::coroutine_handle<> handle = task.handle();
+    task.report_to(d_finished);
+    d_spawned.emplace(handle.address(), std::move(task));
+    schedule(handle);
+}
+
+template <typename T>
+T EventLoop::run(Task<T> task)
+{
+    schedule(task.handle());
+    try
+    {
+        while (not task.done())
+            run_once();
+    }
+    catch (...)
+    {
+        // The loop may still refer to it.
+        if (not task.done())
+            d_abandoned.push_back(std::make_shared<Task<T>>(std::move(task)));
+        throw;
+    }
+    return task.result();
+}
+
+inline void EventLoop::forget(int fd)
+{
+    auto found = d_waiters.find(fd);
+    if (found == d_waiters.end())
+        return;
+    if (found->second.registered)
+        epoll_ctl(d_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    d_waiting -= found->second.readers.size() + found->second.writers.size();
+    d_waiters.erase(found);
+}
+
+inline void EventLoop::wait(int fd, bool forwriting, std::coroutine_handle<> handle)
+{
+    Waiters &waiters = d_waiters[fd];
+    (forwriting ? waiters.writers : waiters.readers).push_back(handle);
+    ++d_waiting;
+    update(fd, waiters);
+}
+
+// Registers interest in exactly the events somebody waits for. Without
+// waiters the fd is removed: epoll always reports EPOLLHUP and EPOLLERR,
+// so a closed peer would otherwise keep epoll_wait from blocking.
+inline void EventLoop::update(int fd, Waiters &waiters)
+{
+    if (waiters.readers.empty() && waiters.writers.empty())
+    {
+        if (waiters.registered && epoll_ctl(d_epoll, EPOLL_CTL_DEL, fd, nullptr) < 0)
+            throw std::system_error(errno, std::system_category(), "epoll_ctl");
+        waiters.registered = false;
+        return;
+    }
+
+    epoll_event event{};
+    event.events = (waiters.readers.empty() ? 0 : uint32_t{EPOLLIN})
+                 | (waiters.writers.empty() ? 0 : uint32_t{EPOLLOUT});
+    event.data.fd = fd;
+    int op = waiters.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(d_epoll, op, fd, &event) < 0)
+        throw std::system_error(errno, std::system_category(), "epoll_ctl");
+    waiters.registered = true;
+}
+
+inline void EventLoop::wake(std::vector<std::coroutine_handle<>> &handles)
+{
+    d_ready.insert(d_ready.end(), handles.begin(), handles.end());
+    d_waiting -= handles.size();
+    handles.clear();
+}
+
+inline void EventLoop::run_once()
+{
+    if (d_ready.empty() && d_waiting == 0)
+        throw std::logic_error("EventLoop: nothing to run, nothing to wait for.");
+
+    // Polls without blocking if there is work, so I/O isn't starved by
+    // coroutines that keep yielding.
+    if (d_waiting != 0)
+    {
+        epoll_event events[64];
+        int count = epoll_wait(d_epoll, events, 64, d_ready.empty() ? -1 : 0);
+        if (count < 0 && errno != EINTR)
+            throw std::system_error(errno, std::system_category(), "epoll_wait");
+        for (int ix = 0; ix < count; ++ix)
+        {
+            Waiters &waiters = d_waiters[events[ix].data.fd];
+            bool const error = events[ix].events & (EPOLLERR | EPOLLHUP);
+            // On error, wake both: their next read or write reports it.
+            if (error || events[ix].events & EPOLLIN)
+                wake(waiters.readers);
+            if (error || events[ix].events & EPOLLOUT)
+                wake(waiters.writers);
+            update(events[ix].data.fd, waiters);
+        }
+    }
+
+    // Only what is ready now: resumed coroutines may schedule more.
+    for (std::size_t count = d_ready.size(); count != 0; --count)
+    {
+        std::coroutine_handle<> handle = d_ready.front();
+        d_ready.pop_front();
+        handle.resume();
+    }
+
+    // Reaps only the spawned tasks that finished.
+    std::exception_ptr failure;
+    for (std::coroutine_handle<> handle: d_finished)
+    {
+        auto found = d_spawned.find(handle.address());
+        try
+        {
+            found->second.result();
+        }
+        catch (...)
+        {
+            if (not failure)
+                failure = std::current_exception();
+        }
+        d_spawned.erase(found);
+    }
+    d_finished.clear();
+    if (failure)
+        std::rethrow_exception(failure);
+}
+
+#endif //eventloop_hh_defd
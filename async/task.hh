@@ -0,0 +1,270 @@
+#ifndef task_hh_defd
+#define task_hh_defd
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/**
+   Lazily started coroutine returning a T. A Task is its own awaiter:
+
+       Task<int> lookup(Table &table, int key)
+       {
+           co_return co_await table[key];
+       }
+
+   Awaiting a Task starts it, and resumes the awaiting coroutine when the
+   Task finishes (by symmetric transfer, so long chains don't grow the
+   stack). Exceptions propagate to the awaiting coroutine.
+
+   A Task that is never awaited can be started by an EventLoop (see
+   eventloop.hh), which is what proxy_return_async/proxy_accept_async
+   implementations typically end up being driven by.
+*/
+template <typename T = void>
+class Task;
+
+namespace task_detail
+{
+    // Resumes whoever awaits the finished coroutine, if anybody, after
+    // reporting it to whoever wants to know.
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept;
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> self) noexcept;
+
+        void await_resume() const noexcept;
+    };
+
+    // Parts of the promise that don't depend on T.
+    class PromiseBase
+    {
+        std::coroutine_handle<> d_continuation;
+        std::vector<std::coroutine_handle<>> *d_finished = nullptr;
+        std::exception_ptr d_exception;
+
+        friend FinalAwaiter;
+
+    public:
+        std::suspend_always initial_suspend() noexcept;
+        FinalAwaiter final_suspend() noexcept;
+        void unhandled_exception() noexcept;
+
+        void set_continuation(std::coroutine_handle<> continuation);
+        void set_finished(std::vector<std::coroutine_handle<>> *finished);
+        void rethrow_if_failed() const;
+    };
+
+    inline bool FinalAwaiter::await_ready() const noexcept
+    {
+        return false;
+    }
+
+    template <typename Promise>
+    std::coroutine_handle<> FinalAwaiter::await_suspend(std::coroutine_handle<Promise> self) noexcept
+    {
+        if (self.promise().d_finished)
+            self.promise().d_finished->push_back(self);
+        std::coroutine_handle<> continuation = self.promise().d_continuation;
+        return continuation ? continuation : std::noop_coroutine();
+    }
+
+    inline void FinalAwaiter::await_resume() const noexcept
+    {}
+
+    inline std::suspend_always PromiseBase::initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    inline FinalAwaiter PromiseBase::final_suspend() noexcept
+    {
+        return {};
+    }
+
+    inline void PromiseBase::unhandled_exception() noexcept
+    {
+        d_exception = std::current_exception();
+    }
+
+    inline void PromiseBase::set_continuation(std::coroutine_handle<> continuation)
+    {
+        d_continuation = continuation;
+    }
+
+    inline void PromiseBase::set_finished(std::vector<std::coroutine_handle<>> *finished)
+    {
+        d_finished = finished;
+    }
+
+    inline void PromiseBase::rethrow_if_failed() const
+    {
+        if (d_exception)
+            std::rethrow_exception(d_exception);
+    }
+
+    template <typename T>
+    class Promise: public PromiseBase
+    {
+        std::optional<T> d_value;
+
+    public:
+        Task<T> get_return_object();
+
+        template <typename U>
+        void return_value(U &&value);
+
+        T result();
+    };
+
+    template <>
+    class Promise<void>: public PromiseBase
+    {
+    public:
+        Task<void> get_return_object();
+
+        void return_void()
+        {}
+
+        void result()
+        {
+            rethrow_if_failed();
+        }
+    };
+}
+
+template <typename T>
+class Task
+{
+public:
+    typedef task_detail::Promise<T> promise_type;
+
+private:
+    std::coroutine_handle<promise_type> d_handle;
+
+    explicit Task(std::coroutine_handle<promise_type> handle);
+
+    friend promise_type;
+
+public:
+    Task(Task &&tmp) noexcept;
+    Task(Task const &other) = delete;
+    ~Task();
+
+    Task &operator=(Task &&tmp) noexcept;
+
+    bool done() const;
+
+    // Starts or continues the Task, without awaiting it. For EventLoop.
+    std::coroutine_handle<> handle() const;
+
+    // Appends handle() to finished when the Task finishes, which must not
+    // need to allocate. For EventLoop.
+    void report_to(std::vector<std::coroutine_handle<>> &finished);
+
+    // Result of a finished Task. Rethrows its exception, if any.
+    T result();
+
+    // Awaiter interface.
+    bool await_ready() const noexcept;
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    T await_resume();
+};
+
+template <typename T>
+Task<T> task_detail::Promise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<Promise>::from_promise(*this));
+}
+
+template <typename T>
+template <typename U>
+void task_detail::Promise<T>::return_value(U &&value)
+{
+    d_value.emplace(std::forward<U>(value));
+}
+
+template <typename T>
+T task_detail::Promise<T>::result()
+{
+    rethrow_if_failed();
+    return std::move(*d_value);
+}
+
+inline Task<void> task_detail::Promise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<Promise>::from_promise(*this));
+}
+
+template <typename T>
+Task<T>::Task(std::coroutine_handle<promise_type> handle)
+    : d_handle(handle)
+{}
+
+template <typename T>
+Task<T>::Task(Task &&tmp) noexcept
+    : d_handle(std::exchange(tmp.d_handle, nullptr))
+{}
+
+template <typename T>
+Task<T>::~Task()
+{
+    if (d_handle)
+        d_handle.destroy();
+}
+
+template <typename T>
+Task<T> &Task<T>::operator=(Task &&tmp) noexcept
+{
+    std::swap(d_handle, tmp.d_handle);
+    return *this;
+}
+
+template <typename T>
+bool Task<T>::done() const
+{
+    return d_handle.done();
+}
+
+template <typename T>
+std::coroutine_handle<> Task<T>::handle() const
+{
+    return d_handle;
+}
+
+template <typename T>
+void Task<T>::report_to(std::vector<std::coroutine_handle<>> &finished)
+{
+    d_handle.promise().set_finished(&finished);
+}
+
+template <typename T>
+T Task<T>::result()
+{
+    return d_handle.promise().result();
+}
+
+template <typename T>
+bool Task<T>::await_ready() const noexcept
+{
+    return false;
+}
+
+template <typename T>
+std::coroutine_handle<> Task<T>::await_suspend(std::coroutine_handle<> awaiting) noexcept
+{
+    d_handle.promise().set_continuation(awaiting);
+    return d_handle;
+}
+
+template <typename T>
+T Task<T>::await_resume()
+{
+    return result();
+}
+
+#endif //task_hh_defd
@@ -0,0 +1,45 @@
+#ifndef benchmark_hh_defd
+#define benchmark_hh_defd
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+/**
+   Timing for the *.bench.cc programs, which sit next to the headers they
+   measure and, having a main, are built like the tests:
+
+       double seconds = best_seconds([&]() { keep(bits.count()); });
+       report("count", seconds, bits.size());   // Prints ns per element.
+
+   best_seconds runs the function a few times and returns the fastest run,
+   the one least disturbed by the rest of the machine. keep(value) makes the
+   compiler compute value, so it can't optimise away what is timed.
+*/
+template <typename Function>
+double best_seconds(Function &&function, int runs = 5)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int run = 0; run != runs; ++run)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double> const took = std::chrono::steady_clock::now() - start;
+        best = std::min(best, took.count());
+    }
+    return best;
+}
+
+template <typename T>
+inline void keep(T const &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void report(char const *what, double seconds, double operations)
+{
+    std::printf("%-44s %10.3f ms %10.3f ns/op\n", what, seconds * 1e3, seconds * 1e9 / operations);
+}
+
+#endif //benchmark_hh_defd
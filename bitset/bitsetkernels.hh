@@ -0,0 +1,285 @@
+#ifndef bitsetkernels_hh_defd
+#define bitsetkernels_hh_defd
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) // The kernels use 64-bit popcnt and extracts.
+    #define BITSETKERNELS_X86 1
+    #include <immintrin.h>
+#else
+    #define BITSETKERNELS_X86 0
+#endif
+
+/**
+   Loops over arrays of 64-bit words for DynamicBitset, in a scalar version
+   and, on x86, AVX2 and AVX-512 versions. best() picks the widest the CPU
+   supports, once; available() lists all usable ones, for testing.
+
+   The binary kernels do lhs[ix] = lhs[ix] op rhs[ix] for ix < count.
+*/
+struct BitsetKernels
+{
+    typedef void (*Binary)(uint64_t *lhs, uint64_t const *rhs, std::size_t count);
+
+    char const *name;
+    Binary and_words;
+    Binary or_words;
+    Binary xor_words;
+    Binary andnot_words; // lhs & ~rhs.
+    void (*not_words)(uint64_t *words, std::size_t count);
+    std::size_t (*popcount)(uint64_t const *words, std::size_t count);
+
+    static BitsetKernels const &best();
+    static std::vector<BitsetKernels> available();
+};
+
+namespace bitset_detail
+{
+    struct And
+    {
+        static uint64_t scalar(uint64_t lhs, uint64_t rhs)
+        {
+            return lhs & rhs;
+        }
+
+#if BITSETKERNELS_X86
+        __attribute__((target("avx2")))
+        static __m256i avx2(__m256i lhs, __m256i rhs)
+        {
+            return _mm256_and_si256(lhs, rhs);
+        }
+
+        __attribute__((target("avx512f")))
+        static __m512i avx512(__m512i lhs, __m512i rhs)
+        {
+            return _mm512_and_si512(lhs, rhs);
+        }
+#endif
+    };
+
+    struct Or
+    {
+        static uint64_t scalar(uint64_t lhs, uint64_t rhs)
+        {
+            return lhs | rhs;
+        }
+
+#if BITSETKERNELS_X86
+        __attribute__((target("avx2")))
+        static __m256i avx2(__m256i lhs, __m256i rhs)
+        {
+            return _mm256_or_si256(lhs, rhs);
+        }
+
+        __attribute__((target("avx512f")))
+        static __m512i avx512(__m512i lhs, __m512i rhs)
+        {
+            return _mm512_or_si512(lhs, rhs);
+        }
+#endif
+    };
+
+    struct Xor
+    {
+        static uint64_t scalar(uint64_t lhs, uint64_t rhs)
+        {
+            return lhs ^ rhs;
+        }
+
+#if BITSETKERNELS_X86
+        __attribute__((target("avx2")))
+        static __m256i avx2(__m256i lhs, __m256i rhs)
+        {
+            return _mm256_xor_si256(lhs, rhs);
+        }
+
+        __attribute__((target("avx512f")))
+        static __m512i avx512(__m512i lhs, __m512i rhs)
+        {
+            return _mm512_xor_si512(lhs, rhs);
+        }
+#endif
+    };
+
+    struct AndNot
+    {
+        static uint64_t scalar(uint64_t lhs, uint64_t rhs)
+        {
+            return lhs & ~rhs;
+        }
+
+#if BITSETKERNELS_X86
+        // The intrinsic negates its first operand.
+        __attribute__((target("avx2")))
+        static __m256i avx2(__m256i lhs, __m256i rhs)
+        {
+            return _mm256_andnot_si256(rhs, lhs);
+        }
+
+        // Not _mm512_andnot_si512: with GCC 12 it warns of uninitialized use.
+        __attribute__((target("avx512f")))
+        static __m512i avx512(__m512i lhs, __m512i rhs)
+        {
+            return _mm512_and_si512(lhs, _mm512_xor_si512(rhs, _mm512_set1_epi64(-1)));
+        }
+#endif
+    };
+
+    template <typename Op>
+    void scalar_binary(uint64_t *lhs, uint64_t const *rhs, std::size_t count)
+    {
+        for (std::size_t ix = 0; ix != count; ++ix)
+            lhs[ix] = Op::scalar(lhs[ix], rhs[ix]);
+    }
+
+    inline void scalar_not(uint64_t *words, std::size_t count)
+    {
+        for (std::size_t ix = 0; ix != count; ++ix)
+            words[ix] = ~words[ix];
+    }
+
+    inline std::size_t scalar_popcount(uint64_t const *words, std::size_t count)
+    {
+        std::size_t total = 0;
+        for (std::size_t ix = 0; ix != count; ++ix)
+            total += std::popcount(words[ix]);
+        return total;
+    }
+
+#if BITSETKERNELS_X86
+    template <typename Op>
+    __attribute__((target("avx2")))
+    void avx2_binary(uint64_t *lhs, uint64_t const *rhs, std::size_t count)
+    {
+        std::size_t ix = 0;
+        for (; ix + 4 <= count; ix += 4)
+        {
+            __m256i result = Op::avx2(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(lhs + ix)),
+                                      _mm256_loadu_si256(reinterpret_cast<__m256i const *>(rhs + ix)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(lhs + ix), result);
+        }
+        for (; ix != count; ++ix)
+            lhs[ix] = Op::scalar(lhs[ix], rhs[ix]);
+    }
+
+    __attribute__((target("avx2")))
+    inline void avx2_not(uint64_t *words, std::size_t count)
+    {
+        __m256i const ones = _mm256_set1_epi64x(-1);
+        std::size_t ix = 0;
+        for (; ix + 4 <= count; ix += 4)
+        {
+            __m256i *at = reinterpret_cast<__m256i *>(words + ix);
+            _mm256_storeu_si256(at, _mm256_xor_si256(_mm256_loadu_si256(at), ones));
+        }
+        for (; ix != count; ++ix)
+            words[ix] = ~words[ix];
+    }
+
+    // Looks up the popcounts of nibbles, and sums the bytes per 64-bit lane.
+    __attribute__((target("avx2,popcnt")))
+    inline std::size_t avx2_popcount(uint64_t const *words, std::size_t count)
+    {
+        __m256i const lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        __m256i const nibble = _mm256_set1_epi8(0x0f);
+        __m256i totals = _mm256_setzero_si256();
+        std::size_t ix = 0;
+        for (; ix + 4 <= count; ix += 4)
+        {
+            __m256i words4 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(words + ix));
+            __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(words4, nibble));
+            __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(words4, 4), nibble));
+            totals = _mm256_add_epi64(totals, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+        }
+        std::size_t total = _mm256_extract_epi64(totals, 0) + _mm256_extract_epi64(totals, 1)
+                          + _mm256_extract_epi64(totals, 2) + _mm256_extract_epi64(totals, 3);
+        for (; ix != count; ++ix)
+            total += _mm_popcnt_u64(words[ix]);
+        return total;
+    }
+
+    template <typename Op>
+    __attribute__((target("avx512f")))
+    void avx512_binary(uint64_t *lhs, uint64_t const *rhs, std::size_t count)
+    {
+        std::size_t ix = 0;
+        for (; ix + 8 <= count; ix += 8)
+            _mm512_storeu_si512(lhs + ix, Op::avx512(_mm512_loadu_si512(lhs + ix), _mm512_loadu_si512(rhs + ix)));
+        if (ix != count)
+        {
+            __mmask8 const tail = static_cast<__mmask8>((1u << (count - ix)) - 1);
+            __m512i result = Op::avx512(_mm512_maskz_loadu_epi64(tail, lhs + ix), _mm512_maskz_loadu_epi64(tail, rhs + ix));
+            _mm512_mask_storeu_epi64(lhs + ix, tail, result);
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    inline void avx512_not(uint64_t *words, std::size_t count)
+    {
+        __m512i const ones = _mm512_set1_epi64(-1);
+        std::size_t ix = 0;
+        for (; ix + 8 <= count; ix += 8)
+            _mm512_storeu_si512(words + ix, _mm512_xor_si512(_mm512_loadu_si512(words + ix), ones));
+        if (ix != count)
+        {
+            __mmask8 const tail = static_cast<__mmask8>((1u << (count - ix)) - 1);
+            _mm512_mask_storeu_epi64(words + ix, tail, _mm512_xor_si512(_mm512_maskz_loadu_epi64(tail, words + ix), ones));
+        }
+    }
+
+    __attribute__((target("avx512f,avx512vpopcntdq")))
+    inline std::size_t avx512_popcount(uint64_t const *words, std::size_t count)
+    {
+        __m512i totals = _mm512_setzero_si512();
+        std::size_t ix = 0;
+        for (; ix + 8 <= count; ix += 8)
+            totals = _mm512_add_epi64(totals, _mm512_popcnt_epi64(_mm512_loadu_si512(words + ix)));
+        if (ix != count)
+        {
+            __mmask8 const tail = static_cast<__mmask8>((1u << (count - ix)) - 1);
+            totals = _mm512_add_epi64(totals, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(tail, words + ix)));
+        }
+        alignas(64) uint64_t lanes[8];
+        _mm512_store_si512(lanes, totals);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+    }
+#endif
+}
+
+inline BitsetKernels const &BitsetKernels::best()
+{
+    static BitsetKernels const chosen = available().back();
+    return chosen;
+}
+
+// From narrow to wide.
+inline std::vector<BitsetKernels> BitsetKernels::available()
+{
+    using namespace bitset_detail;
+
+    std::vector<BitsetKernels> kernels{
+        {"scalar",
+         scalar_binary<And>, scalar_binary<Or>, scalar_binary<Xor>, scalar_binary<AndNot>,
+         scalar_not, scalar_popcount}};
+#if BITSETKERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+        kernels.push_back(
+            {"avx2",
+             avx2_binary<And>, avx2_binary<Or>, avx2_binary<Xor>, avx2_binary<AndNot>,
+             avx2_not, avx2_popcount});
+    if (__builtin_cpu_supports("avx512f"))
+        kernels.push_back(
+            {"avx512",
+             avx512_binary<And>, avx512_binary<Or>, avx512_binary<Xor>, avx512_binary<AndNot>,
+             avx512_not,
+             __builtin_cpu_supports("avx512vpopcntdq") ? avx512_popcount : kernels.back().popcount});
+#endif
+    return kernels;
+}
+
+#endif //bitsetkernels_hh_defd
@@ -0,0 +1,124 @@
+#include "dynamicbitset.hh"
+#include "../benchmark/benchmark.hh"
+
+#include <bitset>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+// DynamicBitset against std::vector<bool> and std::bitset: single bits, set
+// intersection (&=), counting and visiting the set bits.
+
+using namespace std;
+
+namespace
+{
+    constexpr size_t Bits = 1 << 20;    // 128 KiB a set: in L2.
+    constexpr size_t Rounds = 100;
+
+    typedef bitset<Bits> FixedBits;
+}
+
+int main()
+{
+    printf("%zu bits, kernels: %s\n", Bits, BitsetKernels::best().name);
+
+    mt19937_64 random(42);
+    vector<size_t> keys(Bits / 4);
+    for (size_t &key: keys)
+        key = random() % Bits;
+
+    DynamicBitset dynamic(Bits), dynamicother(Bits);
+    vector<bool> boolvector(Bits), boolvectorother(Bits);
+    auto fixed = make_unique<FixedBits>();
+    auto fixedother = make_unique<FixedBits>();
+
+    report("set bits, DynamicBitset",
+           best_seconds([&]() { for (size_t key: keys) dynamic[key] = true; }), keys.size());
+    report("set bits, vector<bool>",
+           best_seconds([&]() { for (size_t key: keys) boolvector[key] = true; }), keys.size());
+    report("set bits, bitset",
+           best_seconds([&]() { for (size_t key: keys) (*fixed)[key] = true; }), keys.size());
+
+    for (size_t ix = 0; ix < Bits; ix += 3)
+    {
+        dynamicother[ix] = true;
+        boolvectorother[ix] = true;
+        (*fixedother)[ix] = true;
+    }
+
+    // Intersecting with itself afterwards keeps the sets the same each round.
+    report("&= per bit, DynamicBitset",
+           best_seconds([&]()
+                        {
+                            for (size_t round = 0; round != Rounds; ++round)
+                            {
+                                DynamicBitset copy(dynamicother);
+                                copy &= dynamic;
+                                keep(copy.words().front());
+                            }
+                        }), double(Bits) * Rounds);
+    report("&= per bit, vector<bool> (loop)",
+           best_seconds([&]()
+                        {
+                            for (size_t round = 0; round != Rounds; ++round)
+                            {
+                                vector<bool> copy(boolvectorother);
+                                for (size_t ix = 0; ix != Bits; ++ix)
+                                    copy[ix] = copy[ix] && boolvector[ix];
+                                keep(copy.front());
+                            }
+                        }), double(Bits) * Rounds);
+    report("&= per bit, bitset",
+           best_seconds([&]()
+                        {
+                            for (size_t round = 0; round != Rounds; ++round)
+                            {
+                                FixedBits copy(*fixedother);
+                                copy &= *fixed;
+                                keep(copy[0]);
+                            }
+                        }), double(Bits) * Rounds);
+
+    report("count per bit, DynamicBitset",
+           best_seconds([&]() { for (size_t round = 0; round != Rounds; ++round) keep(dynamic.count()); }),
+           double(Bits) * Rounds);
+    report("count per bit, vector<bool> (std::count)",
+           best_seconds([&]()
+                        {
+                            for (size_t round = 0; round != Rounds; ++round)
+                                keep(count(boolvector.begin(), boolvector.end(), true));
+                        }), double(Bits) * Rounds);
+    report("count per bit, bitset",
+           best_seconds([&]() { for (size_t round = 0; round != Rounds; ++round) keep(fixed->count()); }),
+           double(Bits) * Rounds);
+
+    size_t const ones = dynamic.count();
+    report("visit set bits, DynamicBitset ones()",
+           best_seconds([&]()
+                        {
+                            size_t sum = 0;
+                            for (size_t ix: dynamic.ones())
+                                sum += ix;
+                            keep(sum);
+                        }), ones);
+    report("visit set bits, vector<bool> (loop)",
+           best_seconds([&]()
+                        {
+                            size_t sum = 0;
+                            for (size_t ix = 0; ix != Bits; ++ix)
+                                if (boolvector[ix])
+                                    sum += ix;
+                            keep(sum);
+                        }), ones);
+    report("visit set bits, bitset (loop)",
+           best_seconds([&]()
+                        {
+                            size_t sum = 0;
+                            for (size_t ix = 0; ix != Bits; ++ix)
+                                if ((*fixed)[ix])
+                                    sum += ix;
+                            keep(sum);
+                        }), ones);
+}
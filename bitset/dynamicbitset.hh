@@ -0,0 +1,372 @@
+#ifndef dynamicbitset_hh_defd
+#define dynamicbitset_hh_defd
+
+#include "../indexproxifier.hh"
+#include "../soa/alignedallocator.hh"
+#include "bitsetkernels.hh"
+#include "ones.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+/**
+   Growable set of bits, as bits[i] = true and bool b = bits[i], stored in
+   64-bit words:
+
+       DynamicBitset lhs(1000), rhs(1000);
+       lhs[3] = true;
+       rhs[3] = true;
+       lhs &= rhs;                 // Word-wide, with AVX2 or AVX-512 if there.
+       for (std::size_t ix = lhs.find_first(); ix != DynamicBitset::npos; ix = lhs.find_next(ix))
+           use(ix);
+
+   The bulk operations run the kernels BitsetKernels::best() picked for the
+   CPU. Both operands of &=, |=, ^= and -= must have the same size().
+
+   Bits beyond size() in the last word are kept 0, so counting and
+   comparing can work on whole words.
+*/
+class DynamicBitset: protected IndexProxifier<DynamicBitset>
+{
+    typedef std::vector<uint64_t, AlignedAllocator<uint64_t, 64>> Words;
+
+    enum : std::size_t
+    {
+        WordBits = 64,
+    };
+
+    Words d_words;
+    std::size_t d_size = 0;
+
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    DynamicBitset() = default;
+    explicit DynamicBitset(std::size_t size, bool value = false);
+
+    std::size_t size() const;
+    bool empty() const;
+    void resize(std::size_t size, bool value = false);
+    void push_back(bool value);
+    void clear();
+
+    std::size_t count() const;
+    bool any() const;
+    bool none() const;
+    bool all() const;
+
+    // Index of the first set bit (after ix), or npos.
+    std::size_t find_first() const;
+    std::size_t find_next(std::size_t ix) const;
+
+    // The indices of the set bits, in order: for (std::size_t ix: bits.ones()).
+    OnesRange ones() const;
+
+    DynamicBitset &set();
+    DynamicBitset &reset();
+    DynamicBitset &flip();
+
+    DynamicBitset &operator&=(DynamicBitset const &other);
+    DynamicBitset &operator|=(DynamicBitset const &other);
+    DynamicBitset &operator^=(DynamicBitset const &other);
+    DynamicBitset &operator-=(DynamicBitset const &other); // Set difference.
+    DynamicBitset operator~() const;
+
+    // As for std::bitset: << moves bits to higher indices. Bits shifted
+    // beyond size() are lost; zeros come in.
+    DynamicBitset &operator<<=(std::size_t shift);
+    DynamicBitset &operator>>=(std::size_t shift);
+
+    bool operator==(DynamicBitset const &other) const;
+
+    // Bit ix is bit ix % 64 of word ix / 64.
+    std::span<uint64_t const> words() const;
+
+    using IndexProxifier<DynamicBitset>::operator[];
+
+private:
+    friend IndexProxifier<DynamicBitset>;
+
+    bool proxy_return_action(std::size_t ix) const;
+    bool proxy_accept_action(std::size_t ix, bool value);
+    void proxy_prefetch_action(std::size_t ix) const;
+
+    static std::size_t word_count(std::size_t size);
+    static uint64_t mask(std::size_t ix);
+    void clear_tail();
+    void require_same_size(DynamicBitset const &other) const;
+};
+
+inline DynamicBitset operator&(DynamicBitset lhs, DynamicBitset const &rhs)
+{
+    return lhs &= rhs;
+}
+
+inline DynamicBitset operator|(DynamicBitset lhs, DynamicBitset const &rhs)
+{
+    return lhs |= rhs;
+}
+
+inline DynamicBitset operator^(DynamicBitset lhs, DynamicBitset const &rhs)
+{
+    return lhs ^= rhs;
+}
+
+inline DynamicBitset operator-(DynamicBitset lhs, DynamicBitset const &rhs)
+{
+    return lhs -= rhs;
+}
+
+inline DynamicBitset operator<<(DynamicBitset bits, std::size_t shift)
+{
+    return bits <<= shift;
+}
+
+inline DynamicBitset operator>>(DynamicBitset bits, std::size_t shift)
+{
+    return bits >>= shift;
+}
+
+inline DynamicBitset::DynamicBitset(std::size_t size, bool value)
+{
+    resize(size, value);
+}
+
+inline std::size_t DynamicBitset::size() const
+{
+    return d_size;
+}
+
+inline bool DynamicBitset::empty() const
+{
+    return d_size == 0;
+}
+
+inline void DynamicBitset::resize(std::size_t size, bool value)
+{
+    std::size_t const old = d_size;
+    d_words.resize(word_count(size), value ? ~uint64_t(0) : 0);
+    d_size = size;
+    if (value && size > old && old % WordBits != 0)
+        d_words[old / WordBits] |= ~uint64_t(0) << old % WordBits; // Old tail was 0.
+    clear_tail();
+}
+
+inline void DynamicBitset::push_back(bool value)
+{
+    if (d_size % WordBits == 0)
+        d_words.push_back(0);
+    ++d_size;
+    proxy_accept_action(d_size - 1, value);
+}
+
+inline void DynamicBitset::clear()
+{
+    d_words.clear();
+    d_size = 0;
+}
+
+inline std::size_t DynamicBitset::count() const
+{
+    return BitsetKernels::best().popcount(d_words.data(), d_words.size());
+}
+
+inline bool DynamicBitset::any() const
+{
+    return std::any_of(d_words.begin(), d_words.end(), [](uint64_t word) { return word != 0; });
+}
+
+inline bool DynamicBitset::none() const
+{
+    return not any();
+}
+
+inline bool DynamicBitset::all() const
+{
+    std::size_t const full = d_size / WordBits;
+    if (not std::all_of(d_words.begin(), d_words.begin() + full, [](uint64_t word) { return word == ~uint64_t(0); }))
+        return false;
+    return d_size % WordBits == 0 || d_words[full] == mask(d_size) - 1;
+}
+
+inline std::size_t DynamicBitset::find_first() const
+{
+    for (std::size_t word = 0; word != d_words.size(); ++word)
+        if (d_words[word] != 0)
+            return word * WordBits + std::countr_zero(d_words[word]);
+    return npos;
+}
+
+inline std::size_t DynamicBitset::find_next(std::size_t ix) const
+{
+    if (ix >= d_size || ++ix == d_size)
+        return npos;
+    std::size_t word = ix / WordBits;
+    uint64_t bits = d_words[word] & ~(mask(ix) - 1); // Drop the bits before ix.
+    while (bits == 0)
+    {
+        if (++word == d_words.size())
+            return npos;
+        bits = d_words[word];
+    }
+    return word * WordBits + std::countr_zero(bits);
+}
+
+inline OnesRange DynamicBitset::ones() const
+{
+    return OnesRange(d_words);
+}
+
+inline DynamicBitset &DynamicBitset::set()
+{
+    std::fill(d_words.begin(), d_words.end(), ~uint64_t(0));
+    clear_tail();
+    return *this;
+}
+
+inline DynamicBitset &DynamicBitset::reset()
+{
+    std::fill(d_words.begin(), d_words.end(), 0);
+    return *this;
+}
+
+inline DynamicBitset &DynamicBitset::flip()
+{
+    BitsetKernels::best().not_words(d_words.data(), d_words.size());
+    clear_tail();
+    return *this;
+}
+
+inline DynamicBitset &DynamicBitset::operator&=(DynamicBitset const &other)
+{
+    require_same_size(other);
+    BitsetKernels::best().and_words(d_words.data(), other.d_words.data(), d_words.size());
+    return *this;
+}
+
+inline DynamicBitset &DynamicBitset::operator|=(DynamicBitset const &other)
+{
+    require_same_size(other);
+    BitsetKernels::best().or_words(d_words.data(), other.d_words.data(), d_words.size());
+    return *this;
+}
+
+inline DynamicBitset &DynamicBitset::operator^=(DynamicBitset const &other)
+{
+    require_same_size(other);
+    BitsetKernels::best().xor_words(d_words.data(), other.d_words.data(), d_words.size());
+    return *this;
+}
+
+inline DynamicBitset &DynamicBitset::operator-=(DynamicBitset const &other)
+{
+    require_same_size(other);
+    BitsetKernels::best().andnot_words(d_words.data(), other.d_words.data(), d_words.size());
+    return *this;
+}
+
+inline DynamicBitset DynamicBitset::operator~() const
+{
+    DynamicBitset flipped(*this);
+    return flipped.flip();
+}
+
+inline DynamicBitset &DynamicBitset::operator<<=(std::size_t shift)
+{
+    std::size_t const words = d_words.size();
+    std::size_t const wordshift = shift / WordBits;
+    unsigned const bitshift = shift % WordBits;
+    if (shift >= d_size)
+        return reset();
+
+    for (std::size_t ix = words; ix-- != wordshift; )
+    {
+        std::size_t const from = ix - wordshift;
+        uint64_t word = d_words[from] << bitshift;
+        if (bitshift != 0 && from != 0)
+            word |= d_words[from - 1] >> (WordBits - bitshift);
+        d_words[ix] = word;
+    }
+    std::fill(d_words.begin(), d_words.begin() + wordshift, 0);
+    clear_tail();
+    return *this;
+}
+
+inline DynamicBitset &DynamicBitset::operator>>=(std::size_t shift)
+{
+    std::size_t const words = d_words.size();
+    std::size_t const wordshift = shift / WordBits;
+    unsigned const bitshift = shift % WordBits;
+    if (shift >= d_size)
+        return reset();
+
+    for (std::size_t ix = 0; ix != words - wordshift; ++ix)
+    {
+        std::size_t const from = ix + wordshift;
+        uint64_t word = d_words[from] >> bitshift;
+        if (bitshift != 0 && from + 1 != words)
+            word |= d_words[from + 1] << (WordBits - bitshift);
+        d_words[ix] = word;
+    }
+    std::fill(d_words.end() - wordshift, d_words.end(), 0);
+    return *this;
+}
+
+inline bool DynamicBitset::operator==(DynamicBitset const &other) const
+{
+    return d_size == other.d_size && d_words == other.d_words;
+}
+
+inline std::span<uint64_t const> DynamicBitset::words() const
+{
+    return d_words;
+}
+
+inline bool DynamicBitset::proxy_return_action(std::size_t ix) const
+{
+    return (d_words[ix / WordBits] & mask(ix)) != 0;
+}
+
+inline bool DynamicBitset::proxy_accept_action(std::size_t ix, bool value)
+{
+    uint64_t &word = d_words[ix / WordBits];
+    if (value)
+        word |= mask(ix);
+    else
+        word &= ~mask(ix);
+    return value;
+}
+
+inline void DynamicBitset::proxy_prefetch_action(std::size_t ix) const
+{
+    __builtin_prefetch(&d_words[ix / WordBits]);
+}
+
+inline std::size_t DynamicBitset::word_count(std::size_t size)
+{
+    return (size + WordBits - 1) / WordBits;
+}
+
+inline uint64_t DynamicBitset::mask(std::size_t ix)
+{
+    return uint64_t(1) << ix % WordBits;
+}
+
+inline void DynamicBitset::clear_tail()
+{
+    if (d_size % WordBits != 0)
+        d_words.back() &= mask(d_size) - 1;
+}
+
+inline void DynamicBitset::require_same_size(DynamicBitset const &other) const
+{
+    if (other.d_size != d_size)
+        throw std::invalid_argument("DynamicBitsets of different sizes");
+}
+
+#endif //dynamicbitset_hh_defd
@@ -0,0 +1,210 @@
+#include "dynamicbitset.hh"
+#include "../../unittest/unittest.hh"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    vector<bool> random_bits(size_t size, unsigned seed)
+    {
+        mt19937 generator(seed);
+        vector<bool> bits(size);
+        for (size_t ix = 0; ix != size; ++ix)
+            bits[ix] = generator() % 3 == 0;
+        return bits;
+    }
+
+    DynamicBitset from(vector<bool> const &bits)
+    {
+        DynamicBitset result(bits.size());
+        for (size_t ix = 0; ix != bits.size(); ++ix)
+            result[ix] = bool(bits[ix]);
+        return result;
+    }
+
+    bool same(DynamicBitset const &bits, vector<bool> const &expected)
+    {
+        if (bits.size() != expected.size())
+            return false;
+        for (size_t ix = 0; ix != expected.size(); ++ix)
+            if (bits[ix] != expected[ix])
+                return false;
+        return true;
+    }
+}
+
+int main()
+{
+    test("Bits are set and read through proxies, and grow.",
+         []()
+         {
+             DynamicBitset bits(70);
+             bits[3] = true;
+             bits[69] = true;
+             bits[3] = false;
+             bits.push_back(true);
+             bits.resize(200, true);
+             return bits.size() == 200
+                 && bits[3] == false
+                 && bits[69] == true
+                 && bits[70] == true
+                 && bits[71] == true
+                 && bits[199] == true
+                 && bits.count() == 131;
+         });
+
+    test("Bulk operations and counts agree with vector<bool>.",
+         []()
+         {
+             for (size_t size: {3, 64, 517, 1000})
+             {
+                 vector<bool> lhs = random_bits(size, 1);
+                 vector<bool> rhs = random_bits(size, 2);
+                 vector<bool> conjunction(size), disjunction(size), exclusive(size), difference(size), complement(size);
+                 for (size_t ix = 0; ix != size; ++ix)
+                 {
+                     conjunction[ix] = lhs[ix] && rhs[ix];
+                     disjunction[ix] = lhs[ix] || rhs[ix];
+                     exclusive[ix] = lhs[ix] != rhs[ix];
+                     difference[ix] = lhs[ix] && not rhs[ix];
+                     complement[ix] = not lhs[ix];
+                 }
+                 size_t ones = count(lhs.begin(), lhs.end(), true);
+
+                 for (BitsetKernels const &kernels: BitsetKernels::available())
+                 {
+                     DynamicBitset bits = from(lhs);
+                     DynamicBitset other = from(rhs);
+                     vector<uint64_t> words(bits.words().begin(), bits.words().end());
+                     vector<uint64_t> otherwords(other.words().begin(), other.words().end());
+                     size_t count = words.size();
+
+                     DynamicBitset conjoined = bits & other;
+                     vector<uint64_t> result = words;
+                     kernels.and_words(result.data(), otherwords.data(), count);
+                     if (not equal(result.begin(), result.end(), conjoined.words().begin(), conjoined.words().end()))
+                         return false;
+                     if (kernels.popcount(words.data(), count) != ones)
+                         return false;
+                 }
+
+                 DynamicBitset bits = from(lhs);
+                 DynamicBitset other = from(rhs);
+                 if (not same(bits & other, conjunction)
+                     || not same(bits | other, disjunction)
+                     || not same(bits ^ other, exclusive)
+                     || not same(bits - other, difference)
+                     || not same(~bits, complement)
+                     || (~bits).count() != size - ones)
+                     return false;
+             }
+             return true;
+         });
+
+    test("Each kernel set computes every operation.",
+         []()
+         {
+             vector<bool> lhs = random_bits(777, 3);
+             vector<bool> rhs = random_bits(777, 4);
+             DynamicBitset bits = from(lhs);
+             DynamicBitset other = from(rhs);
+             vector<uint64_t> words(bits.words().begin(), bits.words().end());
+             vector<uint64_t> otherwords(other.words().begin(), other.words().end());
+
+             auto expected = [&](BitsetKernels::Binary binary)
+             {
+                 vector<uint64_t> result = words;
+                 binary(result.data(), otherwords.data(), result.size());
+                 return result;
+             };
+             BitsetKernels const scalar = BitsetKernels::available().front();
+             for (BitsetKernels const &kernels: BitsetKernels::available())
+             {
+                 for (auto binary: {&BitsetKernels::and_words, &BitsetKernels::or_words,
+                                    &BitsetKernels::xor_words, &BitsetKernels::andnot_words})
+                     if (expected(kernels.*binary) != expected(scalar.*binary))
+                         return false;
+                 vector<uint64_t> flipped = words;
+                 vector<uint64_t> scalarflipped = words;
+                 kernels.not_words(flipped.data(), flipped.size());
+                 scalar.not_words(scalarflipped.data(), scalarflipped.size());
+                 if (flipped != scalarflipped)
+                     return false;
+             }
+             return true;
+         });
+
+    test("any, none and all look at the bits within size().",
+         []()
+         {
+             DynamicBitset bits(130);
+             bool empty = bits.none() && not bits.any() && not bits.all();
+             bits[129] = true;
+             bool one = bits.any() && not bits.all();
+             bits.set();
+             return empty && one
+                 && bits.all()
+                 && bits.count() == 130
+                 && DynamicBitset().all();
+         });
+
+    test("find_first and find_next visit the set bits in order.",
+         []()
+         {
+             vector<bool> reference = random_bits(1000, 5);
+             reference[999] = true;
+             DynamicBitset bits = from(reference);
+             vector<size_t> found;
+             for (size_t ix = bits.find_first(); ix != DynamicBitset::npos; ix = bits.find_next(ix))
+                 found.push_back(ix);
+             vector<size_t> expected;
+             for (size_t ix = 0; ix != reference.size(); ++ix)
+                 if (reference[ix])
+                     expected.push_back(ix);
+             return found == expected
+                 && DynamicBitset(64).find_first() == DynamicBitset::npos;
+         });
+
+    test("Shifts move bits across words, and drop those shifted out.",
+         []()
+         {
+             vector<bool> reference = random_bits(300, 6);
+             for (size_t shift: {0, 1, 63, 64, 65, 130, 299, 300, 500})
+             {
+                 vector<bool> left(300), right(300);
+                 for (size_t ix = 0; ix != 300; ++ix)
+                 {
+                     left[ix] = ix >= shift && reference[ix - shift];
+                     right[ix] = ix + shift < 300 && reference[ix + shift];
+                 }
+                 DynamicBitset bits = from(reference);
+                 if (not same(bits << shift, left) || not same(bits >> shift, right))
+                     return false;
+                 if ((bits << shift).count() != size_t(count(left.begin(), left.end(), true)))
+                     return false; // Nothing beyond size().
+             }
+             return true;
+         });
+
+    test("Combining bitsets of different sizes throws.",
+         []()
+         {
+             DynamicBitset lhs(10);
+             try
+             {
+                 lhs |= DynamicBitset(11);
+             }
+             catch (invalid_argument const &)
+             {
+                 return true;
+             }
+             return false;
+         });
+
+    return TestCount::result();
+}
@@ -0,0 +1,123 @@
+#ifndef ones_hh_defd
+#define ones_hh_defd
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+
+/**
+   Range over the indices of the set bits of an array of 64-bit words,
+   bit ix being bit ix % 64 of word ix / 64:
+
+       for (std::size_t ix: bits.ones())
+           use(ix);
+
+   Finds each next bit by counting trailing zeros, and clears it with
+   word & (word - 1), which compile to tzcnt and blsr where available.
+   The words must not change during the iteration.
+*/
+class OnesRange
+{
+    std::span<uint64_t const> d_words;
+
+public:
+    class iterator;
+
+    explicit OnesRange(std::span<uint64_t const> words);
+
+    iterator begin() const;
+    std::default_sentinel_t end() const;
+};
+
+class OnesRange::iterator
+{
+    uint64_t const *d_word = nullptr;
+    uint64_t const *d_end = nullptr;
+    uint64_t d_bits = 0;       // Bits of *d_word not yet visited.
+    std::size_t d_base = 0;    // Index of bit 0 of *d_word.
+
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::size_t value_type;
+
+    iterator() = default;
+    iterator(uint64_t const *word, uint64_t const *end);
+
+    std::size_t operator*() const;
+    iterator &operator++();
+    iterator operator++(int);
+
+    bool operator==(iterator const &other) const;
+    bool operator==(std::default_sentinel_t) const;
+
+private:
+    void skip_zero_words();
+};
+
+inline OnesRange::OnesRange(std::span<uint64_t const> words)
+    : d_words(words)
+{}
+
+inline OnesRange::iterator OnesRange::begin() const
+{
+    return iterator(d_words.data(), d_words.data() + d_words.size());
+}
+
+inline std::default_sentinel_t OnesRange::end() const
+{
+    return std::default_sentinel;
+}
+
+inline OnesRange::iterator::iterator(uint64_t const *word, uint64_t const *end)
+    : d_word(word),
+      d_end(end),
+      d_bits(word != end ? *word : 0)
+{
+    skip_zero_words();
+}
+
+inline std::size_t OnesRange::iterator::operator*() const
+{
+    return d_base + std::countr_zero(d_bits);
+}
+
+inline OnesRange::iterator &OnesRange::iterator::operator++()
+{
+    d_bits &= d_bits - 1;
+    skip_zero_words();
+    return *this;
+}
+
+inline OnesRange::iterator OnesRange::iterator::operator++(int)
+{
+    iterator previous = *this;
+    ++*this;
+    return previous;
+}
+
+inline bool OnesRange::iterator::operator==(iterator const &other) const
+{
+    return d_word == other.d_word && d_bits == other.d_bits;
+}
+
+inline bool OnesRange::iterator::operator==(std::default_sentinel_t) const
+{
+    return d_word == d_end;
+}
+
+// Leaves d_word at d_end if no bits remain.
+inline void OnesRange::iterator::skip_zero_words()
+{
+    while (d_bits == 0 && d_word != d_end)
+    {
+        if (++d_word == d_end)
+            return;
+        d_bits = *d_word;
+        d_base += 64;
+    }
+}
+
+#endif //ones_hh_defd
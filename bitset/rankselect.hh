@@ -0,0 +1,282 @@
+#ifndef rankselect_hh_defd
+#define rankselect_hh_defd
+
+#include "../indexproxifier.hh"
+#include "dynamicbitset.hh"
+#include "ones.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#if defined(__BMI2__)
+    #include <immintrin.h>
+#endif
+
+// Position of the set bit of word with rank ones below it. word must have
+// more than rank set bits.
+inline unsigned select_in_word(uint64_t word, unsigned rank)
+{
+#if defined(__BMI2__)
+    return std::countr_zero(_pdep_u64(uint64_t(1) << rank, word));
+#else
+    for (; rank != 0; --rank)
+        word &= word - 1;
+    return std::countr_zero(word);
+#endif
+}
+
+/**
+   Directory for rank and select queries on an array of 64-bit words, of
+   about 3% of their size: the number of set bits before each superblock
+   of 4096 bits, and before each block of 1024 bits within its
+   superblock. rank pops at most 16 words; select also needs a binary
+   search over the superblocks between two samples, one per 8192 set bits.
+
+   The directory doesn't keep the words, and must be rebuilt when they
+   change.
+*/
+class RankSelect
+{
+public:
+    enum : std::size_t
+    {
+        WordsPerBlock = 16,
+        BlocksPerSuperblock = 4,
+        BlockBits = WordsPerBlock * 64,
+        SuperblockBits = BlocksPerSuperblock * BlockBits,
+        SampleRate = 8192, // Set bits per select sample.
+    };
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+private:
+    std::vector<uint64_t> d_superblocks; // Set bits before it.
+    std::vector<uint16_t> d_blocks;      // Set bits before it, in its superblock.
+    std::vector<uint32_t> d_samples;     // Superblock of set bit n * SampleRate.
+    std::size_t d_count = 0;
+
+public:
+    RankSelect() = default;
+    RankSelect(std::span<uint64_t const> words, std::size_t size);
+
+    void build(std::span<uint64_t const> words, std::size_t size);
+
+    // Set bits before bit ix, ix <= size.
+    std::size_t rank(std::span<uint64_t const> words, std::size_t ix) const;
+
+    // Index of set bit number rank (counting from 0), or npos.
+    std::size_t select(std::span<uint64_t const> words, std::size_t rank) const;
+
+    std::size_t count() const;
+    std::size_t bytes() const;
+};
+
+/**
+   DynamicBitset with rank and select:
+
+       RankedBitset bits(1000000);
+       bits[ix] = true;
+       std::size_t before = bits.rank(ix);      // Set bits before ix.
+       std::size_t where = bits.select(n);      // Position of set bit n.
+
+   Writes through the proxies mark the directory stale; the next query
+   rebuilds it. So batch the writes, and query afterwards. Queries on a
+   stale directory aren't thread-safe.
+*/
+class RankedBitset: protected IndexProxifier<RankedBitset>
+{
+    DynamicBitset d_bits;
+    mutable RankSelect d_directory;
+    mutable bool d_stale = true;
+
+public:
+    static constexpr std::size_t npos = RankSelect::npos;
+
+    RankedBitset() = default;
+    explicit RankedBitset(std::size_t size);
+    explicit RankedBitset(DynamicBitset bits);
+
+    std::size_t size() const;
+    void push_back(bool value);
+
+    std::size_t count() const;
+    std::size_t rank(std::size_t ix) const;
+    std::size_t select(std::size_t rank) const;
+    OnesRange ones() const;
+
+    DynamicBitset const &bits() const;
+    RankSelect const &directory() const;
+
+    using IndexProxifier<RankedBitset>::operator[];
+
+private:
+    friend IndexProxifier<RankedBitset>;
+
+    bool proxy_return_action(std::size_t ix) const;
+    bool proxy_accept_action(std::size_t ix, bool value);
+};
+
+inline RankSelect::RankSelect(std::span<uint64_t const> words, std::size_t size)
+{
+    build(words, size);
+}
+
+inline void RankSelect::build(std::span<uint64_t const> words, std::size_t size)
+{
+    std::size_t const blocks = size / BlockBits + 1; // Also one for ix == size.
+    d_superblocks.assign(size / SuperblockBits + 1, 0);
+    d_blocks.assign(blocks, 0);
+    d_samples.clear();
+
+    std::size_t total = 0;
+    std::size_t insuperblock = 0;
+    for (std::size_t block = 0; block != blocks; ++block)
+    {
+        if (block % BlocksPerSuperblock == 0)
+        {
+            d_superblocks[block / BlocksPerSuperblock] = total;
+            insuperblock = 0;
+        }
+        d_blocks[block] = static_cast<uint16_t>(insuperblock);
+
+        std::size_t const first = block * WordsPerBlock;
+        std::size_t const last = std::min(first + WordsPerBlock, words.size());
+        for (std::size_t word = first; word < last; ++word)
+        {
+            std::size_t const ones = std::popcount(words[word]);
+            while (d_samples.size() * SampleRate < total + ones) // Set bit n * SampleRate is here.
+                d_samples.push_back(static_cast<uint32_t>(block / BlocksPerSuperblock));
+            total += ones;
+            insuperblock += ones;
+        }
+    }
+    d_count = total;
+}
+
+inline std::size_t RankSelect::rank(std::span<uint64_t const> words, std::size_t ix) const
+{
+    std::size_t const block = ix / BlockBits;
+    std::size_t result = d_superblocks[ix / SuperblockBits] + d_blocks[block];
+    std::size_t const word = ix / 64;
+    for (std::size_t before = block * WordsPerBlock; before != word; ++before)
+        result += std::popcount(words[before]);
+    if (ix % 64 != 0)
+        result += std::popcount(words[word] & ((uint64_t(1) << ix % 64) - 1));
+    return result;
+}
+
+inline std::size_t RankSelect::select(std::span<uint64_t const> words, std::size_t rank) const
+{
+    if (rank >= count())
+        return npos;
+
+    // The last superblock starting with at most rank set bits before it.
+    std::size_t const sample = rank / SampleRate;
+    std::size_t const low = d_samples[sample];
+    std::size_t const high = sample + 1 < d_samples.size() ? d_samples[sample + 1] + 1 : d_superblocks.size();
+    std::size_t const superblock =
+        std::upper_bound(d_superblocks.begin() + low, d_superblocks.begin() + high, rank) - d_superblocks.begin() - 1;
+    rank -= d_superblocks[superblock];
+
+    std::size_t block = superblock * BlocksPerSuperblock;
+    std::size_t const lastblock = std::min(block + BlocksPerSuperblock, d_blocks.size());
+    while (block + 1 != lastblock && d_blocks[block + 1] <= rank)
+        ++block;
+    rank -= d_blocks[block];
+
+    for (std::size_t word = block * WordsPerBlock; ; ++word)
+    {
+        std::size_t const ones = std::popcount(words[word]);
+        if (rank < ones)
+            return word * 64 + select_in_word(words[word], rank);
+        rank -= ones;
+    }
+}
+
+inline std::size_t RankSelect::count() const
+{
+    return d_count;
+}
+
+inline std::size_t RankSelect::bytes() const
+{
+    return d_superblocks.size() * sizeof(uint64_t)
+         + d_blocks.size() * sizeof(uint16_t)
+         + d_samples.size() * sizeof(uint32_t);
+}
+
+inline RankedBitset::RankedBitset(std::size_t size)
+    : d_bits(size)
+{}
+
+inline RankedBitset::RankedBitset(DynamicBitset bits)
+    : d_bits(std::move(bits))
+{}
+
+inline std::size_t RankedBitset::size() const
+{
+    return d_bits.size();
+}
+
+inline void RankedBitset::push_back(bool value)
+{
+    d_bits.push_back(value);
+    d_stale = true;
+}
+
+inline std::size_t RankedBitset::count() const
+{
+    return directory().count();
+}
+
+inline std::size_t RankedBitset::rank(std::size_t ix) const
+{
+    return directory().rank(d_bits.words(), ix);
+}
+
+inline std::size_t RankedBitset::select(std::size_t rank) const
+{
+    return directory().select(d_bits.words(), rank);
+}
+
+inline OnesRange RankedBitset::ones() const
+{
+    return d_bits.ones();
+}
+
+inline DynamicBitset const &RankedBitset::bits() const
+{
+    return d_bits;
+}
+
+inline RankSelect const &RankedBitset::directory() const
+{
+    if (d_stale)
+    {
+        d_directory.build(d_bits.words(), d_bits.size());
+        d_stale = false;
+    }
+    return d_directory;
+}
+
+inline bool RankedBitset::proxy_return_action(std::size_t ix) const
+{
+    return d_bits[ix];
+}
+
+// Only a write that changes the bit makes the directory stale.
+inline bool RankedBitset::proxy_accept_action(std::size_t ix, bool value)
+{
+    if (d_bits[ix] != value)
+    {
+        d_bits[ix] = value;
+        d_stale = true;
+    }
+    return value;
+}
+
+#endif //rankselect_hh_defd
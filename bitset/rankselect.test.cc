@@ -0,0 +1,120 @@
+#include "rankselect.hh"
+#include "../../unittest/unittest.hh"
+
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // One in every density bits set, at random.
+    DynamicBitset random_bits(size_t size, unsigned density, unsigned seed)
+    {
+        mt19937 generator(seed);
+        DynamicBitset bits(size);
+        for (size_t ix = 0; ix != size; ++ix)
+            bits[ix] = generator() % density == 0;
+        return bits;
+    }
+
+    vector<size_t> positions(DynamicBitset const &bits)
+    {
+        vector<size_t> result;
+        for (size_t ix = 0; ix != bits.size(); ++ix)
+            if (bits[ix])
+                result.push_back(ix);
+        return result;
+    }
+}
+
+int main()
+{
+    test("ones() visits the set bits in order.",
+         []()
+         {
+             DynamicBitset bits = random_bits(1000, 5, 1);
+             bits[0] = true;
+             bits[999] = true;
+             vector<size_t> visited;
+             for (size_t ix: bits.ones())
+                 visited.push_back(ix);
+             DynamicBitset empty(200);
+             return visited == positions(bits)
+                 && empty.ones().begin() == empty.ones().end();
+         });
+
+    test("rank counts the set bits before each position.",
+         []()
+         {
+             for (size_t size: {0, 1, 64, 1000, 4096, 20000})
+                 for (unsigned density: {1, 2, 50})
+                 {
+                     RankedBitset bits(random_bits(size, density, size + density));
+                     size_t expected = 0;
+                     for (size_t ix = 0; ix != size; ++ix)
+                     {
+                         if (bits.rank(ix) != expected)
+                             return false;
+                         expected += bits[ix] ? 1 : 0;
+                     }
+                     if (bits.rank(size) != expected || bits.count() != expected)
+                         return false;
+                 }
+             return true;
+         });
+
+    test("select finds each set bit, and npos beyond the last.",
+         []()
+         {
+             for (size_t size: {1, 64, 5000, 50000})
+                 for (unsigned density: {1, 3, 700})
+                 {
+                     RankedBitset bits(random_bits(size, density, 7 * size + density));
+                     vector<size_t> expected = positions(bits.bits());
+                     for (size_t rank = 0; rank != expected.size(); ++rank)
+                         if (bits.select(rank) != expected[rank])
+                             return false;
+                     if (bits.select(expected.size()) != RankedBitset::npos)
+                         return false;
+                 }
+             return true;
+         });
+
+    test("Writes through proxies are reflected by the next query.",
+         []()
+         {
+             RankedBitset bits(10000);
+             bits[5000] = true;
+             size_t before = bits.rank(6000);
+             bits[100] = true;
+             bits[9999] = true;
+             bits.push_back(true);
+             return before == 1
+                 && bits.rank(6000) == 2
+                 && bits.select(2) == 9999
+                 && bits.select(3) == 10000
+                 && bits.count() == 4;
+         });
+
+    test("The directory takes about 3% of the bits.",
+         []()
+         {
+             RankedBitset bits(random_bits(1 << 20, 2, 3));
+             bits.count(); // Builds the directory.
+             double overhead = double(bits.directory().bytes()) / ((1 << 20) / 8);
+             return overhead < 0.035;
+         });
+
+    test("select_in_word picks the set bit of the given rank.",
+         []()
+         {
+             uint64_t word = 0x8000'0000'0001'0012u;
+             return select_in_word(word, 0) == 1
+                 && select_in_word(word, 1) == 4
+                 && select_in_word(word, 2) == 16
+                 && select_in_word(word, 3) == 63;
+         });
+
+    return TestCount::result();
+}
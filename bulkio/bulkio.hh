@@ -0,0 +1,303 @@
+#ifndef bulkio_hh_defd
+#define bulkio_hh_defd
+
+#include "../indexproxifier.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/**
+   Bulk binary save and load of owners deriving from IndexProxifier, keyed
+   by std::size_t 0 .. count.
+
+       ip::save(mc, sink);      // Uses mc.size() as count.
+       ip::save(mc, sink, count);
+       ip::load(mc, source);    // Count from the stream. Must equal
+                                // mc.size() if mc has a size().
+
+   The stream is a BulkIOHeader followed by the raw bytes of the elements, in
+   the byte order of the writing host. The header is versioned and tagged
+   with that byte order, and load() refuses streams it cannot interpret.
+
+   A sink has a write(char const *data, std::size_t size) and a source has a
+   read(char *data, std::size_t size). Both report success by converting to
+   bool. std::ostream/std::istream qualify, as do FdSink/FdSource below.
+
+   If the owner provides (private, like the other proxy_ actions)
+
+       bool proxy_serialize_range(Key first, Key last, Sink &sink) const;
+       bool proxy_deserialize_range(Key first, Key last, Source &source);
+
+   those stream the elements in one go, e.g. straight from the owner's own
+   storage. Otherwise save and load loop over the elements through LRProxies,
+   staging them in a large buffer.
+
+   Elements must be trivially copyable. Save and load return false on
+   failure. After a failure during the elements, the owner may have been
+   partially loaded.
+*/
+
+struct BulkIOHeader
+{
+    enum : uint16_t
+    {
+        Version = 1,
+        ByteOrder = 0x0102,  // Reads as 0x0201 on a host of other endianness.
+    };
+
+    char magic[4] = {'I', 'P', 'X', 'B'};
+    uint16_t version = Version;
+    uint16_t byteorder = ByteOrder;
+    uint32_t elementsize = 0;
+    uint32_t reserved = 0;
+    uint64_t count = 0;
+
+    bool valid_for(std::size_t size) const;
+};
+
+static_assert(sizeof(BulkIOHeader) == 24, "BulkIOHeader layout must be fixed.");
+
+inline bool BulkIOHeader::valid_for(std::size_t size) const
+{
+    return std::memcmp(magic, BulkIOHeader{}.magic, sizeof magic) == 0
+        && version == Version
+        && byteorder == ByteOrder
+        && elementsize == size;
+}
+
+// Buffered sink writing to a file descriptor. Large writes bypass the
+// buffer: pending data and the new block go out in one writev.
+class FdSink
+{
+    int d_fd;
+    std::vector<char> d_buffer;
+    std::size_t d_used = 0;
+
+public:
+    explicit FdSink(int fd, std::size_t buffersize = 1 << 20);
+    FdSink(FdSink const &other) = delete;
+    ~FdSink(); // Flushes. Call flush() first to see whether that worked.
+
+    bool write(char const *data, std::size_t size);
+    bool flush();
+
+private:
+    bool writev_all(iovec *iov, int count);
+};
+
+inline FdSink::FdSink(int fd, std::size_t buffersize)
+    : d_fd(fd),
+      d_buffer(buffersize)
+{}
+
+inline FdSink::~FdSink()
+{
+    flush();
+}
+
+inline bool FdSink::write(char const *data, std::size_t size)
+{
+    if (d_used + size <= d_buffer.size())
+    {
+        std::memcpy(d_buffer.data() + d_used, data, size);
+        d_used += size;
+        return true;
+    }
+    iovec iov[2] = {
+        {d_buffer.data(), d_used},
+        {const_cast<char *>(data), size}
+    };
+    d_used = 0;
+    return writev_all(iov, 2);
+}
+
+inline bool FdSink::flush()
+{
+    iovec iov[1] = {{d_buffer.data(), d_used}};
+    d_used = 0;
+    return writev_all(iov, 1);
+}
+
+inline bool FdSink::writev_all(iovec *iov, int count)
+{
+    while (count != 0)
+    {
+        ssize_t written = ::writev(d_fd, iov, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        // Skip what was written, which may end halfway an iovec.
+        std::size_t left = written;
+        while (count != 0 && left >= iov->iov_len)
+        {
+            left -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count != 0)
+        {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+// Buffered source reading from a file descriptor. Large reads bypass the
+// buffer.
+class FdSource
+{
+    int d_fd;
+    std::vector<char> d_buffer;
+    std::size_t d_begin = 0;
+    std::size_t d_end = 0;
+
+public:
+    explicit FdSource(int fd, std::size_t buffersize = 1 << 20);
+    FdSource(FdSource const &other) = delete;
+
+    bool read(char *data, std::size_t size);
+
+private:
+    // Reads at least min and at most max bytes into data.
+    bool read_some(char *data, std::size_t min, std::size_t max, std::size_t &got);
+};
+
+inline FdSource::FdSource(int fd, std::size_t buffersize)
+    : d_fd(fd),
+      d_buffer(buffersize)
+{}
+
+inline bool FdSource::read(char *data, std::size_t size)
+{
+    std::size_t buffered = std::min(size, d_end - d_begin);
+    std::memcpy(data, d_buffer.data() + d_begin, buffered);
+    d_begin += buffered;
+    data += buffered;
+    size -= buffered;
+    if (size == 0)
+        return true;
+
+    std::size_t got;
+    if (size >= d_buffer.size())
+        return read_some(data, size, size, got);
+
+    if (not read_some(d_buffer.data(), size, d_buffer.size(), got))
+        return false;
+    std::memcpy(data, d_buffer.data(), size);
+    d_begin = size;
+    d_end = got;
+    return true;
+}
+
+inline bool FdSource::read_some(char *data, std::size_t min, std::size_t max, std::size_t &got)
+{
+    got = 0;
+    while (got < min)
+    {
+        ssize_t count = ::read(d_fd, data + got, max - got);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false; // Error, or premature end of file.
+        got += count;
+    }
+    return true;
+}
+
+namespace ip
+{
+    template <typename Owner, typename Sink>
+        requires ProxyIndexed<Owner const &, std::size_t>
+    bool save(Owner const &owner, Sink &sink, std::size_t count)
+    {
+        typedef decltype(owner[std::size_t{}]) Proxy;
+        typedef typename std::remove_cvref<typename Proxy::indexproxifier_conversion_type>::type value_type;
+        static_assert(std::is_trivially_copyable<value_type>::value,
+                      "Bulk binary I/O needs trivially copyable elements.");
+
+        BulkIOHeader header;
+        header.elementsize = sizeof(value_type);
+        header.count = count;
+        if (not sink.write(reinterpret_cast<char const *>(&header), sizeof header))
+            return false;
+        if (count == 0)
+            return true;
+
+        if constexpr (LRProxyAccess::has_serialize_range_action<Proxy, Sink>)
+            return LRProxyAccess::run_serialize_range_action(owner[std::size_t{0}], count, sink);
+        else
+        {
+            std::vector<value_type> chunk(std::min<std::size_t>(count, (1 << 20) / sizeof(value_type) + 1));
+            for (std::size_t first = 0; first != count; )
+            {
+                std::size_t size = std::min(chunk.size(), count - first);
+                for (std::size_t ix = 0; ix != size; ++ix)
+                    chunk[ix] = owner[first + ix];
+                if (not sink.write(reinterpret_cast<char const *>(chunk.data()), size * sizeof(value_type)))
+                    return false;
+                first += size;
+            }
+            return true;
+        }
+    }
+
+    template <typename Owner, typename Sink>
+        requires ProxyIndexed<Owner const &, std::size_t>
+    bool save(Owner const &owner, Sink &sink)
+    {
+        return save(owner, sink, owner.size());
+    }
+
+    template <typename Owner, typename Source>
+        requires ProxyIndexed<Owner &, std::size_t>
+    bool load(Owner &owner, Source &source)
+    {
+        typedef decltype(owner[std::size_t{}]) Proxy;
+        typedef typename std::remove_cvref<typename Proxy::indexproxifier_conversion_type>::type value_type;
+        static_assert(std::is_trivially_copyable<value_type>::value,
+                      "Bulk binary I/O needs trivially copyable elements.");
+
+        BulkIOHeader header;
+        if (not source.read(reinterpret_cast<char *>(&header), sizeof header)
+            or not header.valid_for(sizeof(value_type)))
+            return false;
+        if constexpr (requires { owner.size(); })
+        {
+            if (header.count != owner.size())
+                return false;
+        }
+        std::size_t const count = header.count;
+        if (count == 0)
+            return true;
+
+        if constexpr (LRProxyAccess::has_deserialize_range_action<Proxy, Source>)
+            return LRProxyAccess::run_deserialize_range_action(owner[std::size_t{0}], count, source);
+        else
+        {
+            std::vector<value_type> chunk(std::min<std::size_t>(count, (1 << 20) / sizeof(value_type) + 1));
+            for (std::size_t first = 0; first != count; )
+            {
+                std::size_t size = std::min(chunk.size(), count - first);
+                if (not source.read(reinterpret_cast<char *>(chunk.data()), size * sizeof(value_type)))
+                    return false;
+                for (std::size_t ix = 0; ix != size; ++ix)
+                    owner[first + ix] = chunk[ix]; // Lvalue: accept action may take a reference.
+                first += size;
+            }
+            return true;
+        }
+    }
+}
+
+#endif //bulkio_hh_defd
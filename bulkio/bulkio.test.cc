@@ -0,0 +1,148 @@
+
+#include "bulkio.hh"
+#include "../lrproxy/unit_test/nibbles/nibbles.hh"
+#include "../../unittest/unittest.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+// A column of samples that streams its storage in one go.
+class Samples: protected IndexProxifier<Samples>
+{
+    std::vector<int32_t> d_data;
+
+public:
+    std::size_t d_ranges = 0; // Counts calls to the range actions.
+
+    explicit Samples(std::size_t size);
+    std::size_t size() const;
+
+    using IndexProxifier<Samples>::operator[];
+
+private:
+    friend IndexProxifier<Samples>;
+
+    int32_t proxy_return_action(std::size_t key) const;
+    int32_t proxy_accept_action(std::size_t key, int32_t value);
+
+    template <typename Sink>
+    bool proxy_serialize_range(std::size_t first, std::size_t last, Sink &sink) const;
+    template <typename Source>
+    bool proxy_deserialize_range(std::size_t first, std::size_t last, Source &source);
+};
+
+inline Samples::Samples(std::size_t size)
+    : d_data(size)
+{}
+
+inline std::size_t Samples::size() const
+{
+    return d_data.size();
+}
+
+inline int32_t Samples::proxy_return_action(std::size_t key) const
+{
+    return d_data[key];
+}
+
+inline int32_t Samples::proxy_accept_action(std::size_t key, int32_t value)
+{
+    return d_data[key] = value;
+}
+
+template <typename Sink>
+bool Samples::proxy_serialize_range(std::size_t first, std::size_t last, Sink &sink) const
+{
+    ++const_cast<Samples *>(this)->d_ranges;
+    return static_cast<bool>(sink.write(reinterpret_cast<char const *>(&d_data[first]), (last - first) * sizeof(int32_t)));
+}
+
+template <typename Source>
+bool Samples::proxy_deserialize_range(std::size_t first, std::size_t last, Source &source)
+{
+    ++d_ranges;
+    return static_cast<bool>(source.read(reinterpret_cast<char *>(&d_data[first]), (last - first) * sizeof(int32_t)));
+}
+
+using namespace std;
+
+int main()
+{
+    test("Owners with range actions save and load in one go.",
+         []()
+         {
+             Samples samples(1000);
+             for (std::size_t ix = 0; ix != samples.size(); ++ix)
+                 samples[ix] = static_cast<int32_t>(ix * ix) - 5000;
+             stringstream buffer;
+             Samples copy(1000);
+             if (not ip::save(samples, buffer) || not ip::load(copy, buffer))
+                 return false;
+             for (std::size_t ix = 0; ix != copy.size(); ++ix)
+                 if (copy[ix] != samples[ix])
+                     return false;
+             return samples.d_ranges == 1
+                 && copy.d_ranges == 1
+                 && buffer.str().size() == sizeof(BulkIOHeader) + 1000 * sizeof(int32_t);
+         });
+
+    test("Owners without range actions save and load element by element.",
+         []()
+         {
+             Nibbles nibbles{1, 2, 3, 4, 5, 6, 7, 8};
+             Nibbles copy;
+             stringstream buffer;
+             return ip::save(nibbles, buffer, Nibbles::Count)
+                 && ip::load(copy, buffer)
+                 && copy.internal() == nibbles.internal();
+         });
+
+    test("Loading refuses a stream of the wrong size or byte order.",
+         []()
+         {
+             Samples samples(10);
+             Samples bigger(11);
+             stringstream buffer;
+             ip::save(samples, buffer);
+             std::string const saved = buffer.str();
+             std::string corrupt = saved;
+             corrupt[6] ^= 3; // The byte order tag.
+             stringstream in1(saved);
+             stringstream in2(corrupt);
+             return not ip::load(bigger, in1)
+                 && not ip::load(samples, in2);
+         });
+
+    test("FdSink and FdSource stream through a file descriptor.",
+         []()
+         {
+             FILE *file = tmpfile();
+             if (file == nullptr)
+             {
+                 fail("No temporary file.");
+                 return false;
+             }
+             int fd = fileno(file);
+             Samples samples(100000);
+             Samples copy(100000);
+             for (std::size_t ix = 0; ix != samples.size(); ++ix)
+                 samples[ix] = static_cast<int32_t>(ix * 7);
+             bool ok;
+             {
+                 FdSink sink(fd, 4096); // Smaller than the data, so writev is used.
+                 ok = ip::save(samples, sink) && sink.flush();
+             }
+             lseek(fd, 0, SEEK_SET);
+             FdSource source(fd, 4096);
+             ok = ok && ip::load(copy, source);
+             fclose(file);
+             for (std::size_t ix = 0; ok && ix < copy.size(); ix += 997)
+                 ok = copy[ix] == samples[ix];
+             return ok;
+         });
+
+    return TestCount::result();
+}
@@ -0,0 +1,90 @@
+#include "compressedarray.hh"
+#include "../benchmark/benchmark.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+// Compression, bulk decoding, sequential and random reads, and random
+// writes, of two columns: sorted timestamps (delta blocks) and IDs from a
+// narrow range (frame of reference blocks). Plain vector reads for scale.
+
+using namespace std;
+
+namespace
+{
+    constexpr size_t Size = size_t(1) << 22;
+    constexpr size_t Accesses = size_t(1) << 20;
+
+    void run(char const *name, vector<int64_t> const &values)
+    {
+        string const prefix = string(name) + ", ";
+        CompressedArray<int64_t> column{span<int64_t const>(values)};
+        printf("%s: %zu values in %zu bytes, %.1fx smaller\n",
+               name, values.size(), column.bytes(), double(values.size() * sizeof(int64_t)) / column.bytes());
+
+        vector<int64_t> out(Size);
+        report((prefix + "decode all").c_str(),
+               best_seconds([&]() { column.decode(0, Size, out.data()); keep(out.back()); }), Size);
+
+        report((prefix + "sequential col[i]").c_str(),
+               best_seconds([&]()
+                            {
+                                int64_t sum = 0;
+                                for (size_t ix = 0; ix != Accesses; ++ix)
+                                    sum += column[ix];
+                                keep(sum);
+                            }), Accesses);
+
+        mt19937_64 random(42);
+        vector<size_t> keys(Accesses);
+        for (size_t &key: keys)
+            key = random() % Size;
+
+        report((prefix + "random col[i]").c_str(),
+               best_seconds([&]()
+                            {
+                                int64_t sum = 0;
+                                for (size_t key: keys)
+                                    sum += column[key];
+                                keep(sum);
+                            }), Accesses);
+        report((prefix + "random vector[i], for scale").c_str(),
+               best_seconds([&]()
+                            {
+                                int64_t sum = 0;
+                                for (size_t key: keys)
+                                    sum += values[key];
+                                keep(sum);
+                            }), Accesses);
+
+        // Rewriting what is there keeps the column, and its encodings, as is.
+        report((prefix + "random col[i] = v, and flush").c_str(),
+               best_seconds([&]()
+                            {
+                                for (size_t ix = 0; ix != Accesses / 16; ++ix)
+                                    column[keys[ix]] = values[keys[ix]];
+                                column.flush();
+                            }), Accesses / 16);
+    }
+}
+
+int main()
+{
+    mt19937_64 random(7);
+
+    vector<int64_t> timestamps(Size);
+    int64_t now = 1'700'000'000'000;
+    for (int64_t &timestamp: timestamps)
+        timestamp = now += 1 + random() % 100;
+
+    vector<int64_t> ids(Size);
+    for (int64_t &id: ids)
+        id = 5'000'000 + random() % 60'000;
+
+    run("timestamps", timestamps);
+    run("ids", ids);
+}
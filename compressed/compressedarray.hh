@@ -0,0 +1,382 @@
+#ifndef compressedarray_hh_defd
+#define compressedarray_hh_defd
+
+#include "../indexproxifier.hh"
+#include "../memo/clockcache.hh"
+#include "../packed/packedarray.hh"
+#include "../packed/packedkernels.hh"
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+   Array of integers compressed in blocks of BlockSize, as col[i] = v and
+   T v = col[i]:
+
+       CompressedArray<int64_t> timestamps(values); // Or push_back them.
+       int64_t when = timestamps[12345];
+       timestamps[12345] = when + 1;
+       timestamps.decode(0, timestamps.size(), out);
+
+   Each full block is stored in whichever encoding is smaller:
+   - frame of reference: the block's minimum, and each value's offset from
+     it, bit-packed as for PackedArray. Suits IDs from a narrow range;
+     col[i] unpacks just element i.
+   - delta: the first value, the smallest difference between neighbours,
+     and each difference's excess over that, bit-packed. Suits sorted
+     values like timestamps; col[i] needs the sum of the differences before
+     it, so reads decode whole blocks into a ClockCache of cachesize blocks.
+   - raw: the values themselves, if neither needs fewer than 33 bits.
+   The elements after the last full block are kept as they are until
+   the block fills.
+
+   Writes to a block go to a small buffer of pending writes, which reads
+   look in first. Once it has more than BlockSize / 32 writes, the block
+   is decoded, updated and encoded again; flush() does so for all blocks.
+
+   decode unpacks whole blocks with the PackedKernels the CPU supports
+   best (AVX2 gathers where available), without going through the cache.
+
+   Reads update the cache, so even const CompressedArrays are not thread
+   safe.
+*/
+template <typename T, std::size_t BlockSize = 256>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+class CompressedArray: protected IndexProxifier<CompressedArray<T, BlockSize>>
+{
+    static_assert(BlockSize >= 2 && BlockSize <= 4096, "CompressedArray blocks have 2 to 4096 elements.");
+
+    enum class Encoding : uint8_t
+    {
+        Frame,
+        Delta,
+        Raw,
+    };
+
+    struct Write
+    {
+        uint16_t ix;            // In the block.
+        T value;
+    };
+
+    // Values are handled as uint64_t, so differences simply wrap around.
+    struct Block
+    {
+        uint64_t base = 0;      // Minimum (Frame) or first value (Delta).
+        uint64_t step = 0;      // Smallest difference (Delta).
+        Encoding encoding = Encoding::Raw;
+        uint8_t width = 0;      // Of the offsets, or 64 (Raw).
+        std::vector<uint64_t> words; // Packed offsets, or raw values.
+        std::vector<Write> pending;  // Sorted by ix.
+    };
+
+    enum : std::size_t
+    {
+        PendingMax = BlockSize / 32,
+    };
+
+    std::vector<Block> d_blocks;
+    std::vector<T> d_tail;
+    mutable ClockCache<std::size_t, std::vector<T>> d_cache; // Without pending writes.
+    mutable std::size_t d_hits = 0;
+    mutable std::size_t d_misses = 0;
+
+public:
+    explicit CompressedArray(std::size_t cachesize = 8);
+    explicit CompressedArray(std::span<T const> values, std::size_t cachesize = 8);
+
+    std::size_t size() const;
+    void push_back(T value);
+
+    // Elements [first, last) to out.
+    void decode(std::size_t first, std::size_t last, T *out) const;
+
+    // Merges all pending writes.
+    void flush();
+
+    // Of the blocks, their buffers and the tail, not counting the cache.
+    std::size_t bytes() const;
+
+    // Reads of delta blocks answered by the cache, and those that decoded.
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+    using IndexProxifier<CompressedArray>::operator[];
+
+private:
+    friend IndexProxifier<CompressedArray>;
+
+    T proxy_return_action(std::size_t ix) const;
+    T proxy_accept_action(std::size_t ix, T value);
+
+    static Block encode(T const *values);
+    void decode_block(std::size_t block, T *out, bool pending) const;
+    void merge(std::size_t block);
+};
+
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+CompressedArray<T, BlockSize>::CompressedArray(std::size_t cachesize)
+    : d_cache(cachesize)
+{}
+
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+CompressedArray<T, BlockSize>::CompressedArray(std::span<T const> values, std::size_t cachesize)
+    : d_cache(cachesize)
+{
+    d_blocks.reserve(values.size() / BlockSize);
+    std::size_t ix = 0;
+    for (; ix + BlockSize <= values.size(); ix += BlockSize)
+        d_blocks.push_back(encode(values.data() + ix));
+    d_tail.assign(values.begin() + ix, values.end());
+}
+
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+std::size_t CompressedArray<T, BlockSize>::size() const
+{
+    return d_blocks.size() * BlockSize + d_tail.size();
+}
+
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+void CompressedArray<T, BlockSize>::push_back(T value)
+{
+    d_tail.push_back(value);
+    if (d_tail.size() == BlockSize)
+    {
+        d_blocks.push_back(encode(d_tail.data()));
+        d_tail.clear();
+    }
+}
+
+// Whole blocks are decoded straight into out; partial ones via a buffer.
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+void CompressedArray<T, BlockSize>::decode(std::size_t first, std::size_t last, T *out) const
+{
+    std::size_t const blocked = d_blocks.size() * BlockSize;
+    while (first < last && first < blocked)
+    {
+        std::size_t const block = first / BlockSize;
+        std::size_t const start = first % BlockSize;
+        std::size_t const count = std::min(BlockSize - start, last - first);
+        if (count == BlockSize)
+            decode_block(block, out, true);
+        else
+        {
+            T buffer[BlockSize];
+            decode_block(block, buffer, true);
+            std::copy_n(buffer + start, count, out);
+        }
+        first += count;
+        out += count;
+    }
+    if (first < last)
+        std::copy(d_tail.begin() + (first - blocked), d_tail.begin() + (last - blocked), out);
+}
+
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+void CompressedArray<T, BlockSize>::flush()
+{
+    for (std::size_t block = 0; block != d_blocks.size(); ++block)
+        if (not d_blocks[block].pending.empty())
+            merge(block);
+}
+
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+std::size_t CompressedArray<T, BlockSize>::bytes() const
+{
+    std::size_t total = d_blocks.size() * sizeof(Block) + d_tail.size() * sizeof(T);
+    for (Block const &block: d_blocks)
+        total += block.words.size() * sizeof(uint64_t) + block.pending.size() * sizeof(Write);
+    return total;
+}
+
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+std::size_t CompressedArray<T, BlockSize>::hits() const
+{
+    return d_hits;
+}
+
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+std::size_t CompressedArray<T, BlockSize>::misses() const
+{
+    return d_misses;
+}
+
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+T CompressedArray<T, BlockSize>::proxy_return_action(std::size_t ix) const
+{
+    std::size_t const blockix = ix / BlockSize;
+    if (blockix >= d_blocks.size())
+        return d_tail[ix - d_blocks.size() * BlockSize];
+
+    Block const &block = d_blocks[blockix];
+    std::size_t const inblock = ix % BlockSize;
+    auto pending = std::lower_bound(block.pending.begin(), block.pending.end(), inblock,
+                                    [](Write const &write, std::size_t ix) { return write.ix < ix; });
+    if (pending != block.pending.end() && pending->ix == inblock)
+        return pending->value;
+
+    switch (block.encoding)
+    {
+        case Encoding::Raw:
+            return static_cast<T>(block.words[inblock]);
+        case Encoding::Frame:
+            return static_cast<T>(block.base
+                                  + (block.width == 0 ? 0 : packed_detail::scalar_get(block.words.data(),
+                                                                                      inblock, block.width)));
+        case Encoding::Delta:
+            break;
+    }
+
+    if (std::vector<T> const *cached = d_cache.find(blockix))
+    {
+        ++d_hits;
+        return (*cached)[inblock];
+    }
+    ++d_misses;
+    std::vector<T> decoded(BlockSize);
+    decode_block(blockix, decoded.data(), false);
+    T const value = decoded[inblock];
+    d_cache.insert(blockix, std::move(decoded));
+    return value;
+}
+
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+T CompressedArray<T, BlockSize>::proxy_accept_action(std::size_t ix, T value)
+{
+    std::size_t const blockix = ix / BlockSize;
+    if (blockix >= d_blocks.size())
+        return d_tail[ix - d_blocks.size() * BlockSize] = value;
+
+    std::vector<Write> &pending = d_blocks[blockix].pending;
+    uint16_t const inblock = static_cast<uint16_t>(ix % BlockSize);
+    auto at = std::lower_bound(pending.begin(), pending.end(), inblock,
+                               [](Write const &write, uint16_t ix) { return write.ix < ix; });
+    if (at != pending.end() && at->ix == inblock)
+        at->value = value;
+    else
+        pending.insert(at, Write{inblock, value});
+    if (pending.size() > PendingMax)
+        merge(blockix);
+    return value;
+}
+
+// Delta wins only if strictly smaller: frame blocks read without the cache.
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+auto CompressedArray<T, BlockSize>::encode(T const *values) -> Block
+{
+    auto [min, max] = std::minmax_element(values, values + BlockSize);
+    unsigned const framewidth = std::bit_width(uint64_t(*max) - uint64_t(*min));
+
+    int64_t mindelta = INT64_MAX;
+    int64_t maxdelta = INT64_MIN;
+    for (std::size_t ix = 1; ix != BlockSize; ++ix)
+    {
+        int64_t const delta = static_cast<int64_t>(uint64_t(values[ix]) - uint64_t(values[ix - 1]));
+        mindelta = std::min(mindelta, delta);
+        maxdelta = std::max(maxdelta, delta);
+    }
+    unsigned const deltawidth = std::bit_width(uint64_t(maxdelta) - uint64_t(mindelta));
+
+    Block block;
+    if (std::min(framewidth, deltawidth) > 32)
+    {
+        block.width = 64;
+        block.words.assign(values, values + BlockSize);
+        return block;
+    }
+
+    uint32_t offsets[BlockSize];
+    std::size_t count = BlockSize;
+    if (deltawidth < framewidth)
+    {
+        block.encoding = Encoding::Delta;
+        block.width = deltawidth;
+        block.base = uint64_t(values[0]);
+        block.step = uint64_t(mindelta);
+        count = BlockSize - 1;
+        for (std::size_t ix = 0; ix != count; ++ix)
+            offsets[ix] = static_cast<uint32_t>(uint64_t(values[ix + 1]) - uint64_t(values[ix]) - block.step);
+    }
+    else
+    {
+        block.encoding = Encoding::Frame;
+        block.width = framewidth;
+        block.base = uint64_t(*min);
+        for (std::size_t ix = 0; ix != count; ++ix)
+            offsets[ix] = static_cast<uint32_t>(uint64_t(values[ix]) - block.base);
+    }
+
+    if (block.width != 0)   // Otherwise all offsets are 0.
+    {
+        PackedArray<> packed(count, block.width);
+        packed.encode(offsets, 0, count);
+        block.words.assign(packed.words().begin(), packed.words().end());
+    }
+    return block;
+}
+
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+void CompressedArray<T, BlockSize>::decode_block(std::size_t blockix, T *out, bool pending) const
+{
+    Block const &block = d_blocks[blockix];
+    if (block.encoding == Encoding::Raw)
+        for (std::size_t ix = 0; ix != BlockSize; ++ix)
+            out[ix] = static_cast<T>(block.words[ix]);
+    else
+    {
+        std::size_t const count = block.encoding == Encoding::Delta ? BlockSize - 1 : BlockSize;
+        uint32_t offsets[BlockSize];
+        if (block.width == 0)
+            std::fill_n(offsets, count, 0);
+        else
+            PackedKernels::best().decode(block.words.data(), 0, count, block.width, offsets);
+
+        if (block.encoding == Encoding::Frame)
+            for (std::size_t ix = 0; ix != BlockSize; ++ix)
+                out[ix] = static_cast<T>(block.base + offsets[ix]);
+        else
+        {
+            uint64_t value = block.base;
+            out[0] = static_cast<T>(value);
+            for (std::size_t ix = 1; ix != BlockSize; ++ix)
+            {
+                value += block.step + offsets[ix - 1];
+                out[ix] = static_cast<T>(value);
+            }
+        }
+    }
+
+    if (pending)
+        for (Write const &write: block.pending)
+            out[write.ix] = write.value;
+}
+
+template <typename T, std::size_t BlockSize>
+    requires std::integral<T> && (sizeof(T) <= sizeof(uint64_t))
+void CompressedArray<T, BlockSize>::merge(std::size_t blockix)
+{
+    T values[BlockSize];
+    decode_block(blockix, values, true);
+    d_blocks[blockix] = encode(values);
+    d_cache.erase(blockix);
+}
+
+#endif //compressedarray_hh_defd
@@ -0,0 +1,139 @@
+#include "compressedarray.hh"
+#include "../../unittest/unittest.hh"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Every second, with some jitter: delta encodes these in a few bits.
+    vector<int64_t> timestamps(size_t count)
+    {
+        mt19937 random(1);
+        vector<int64_t> result(count);
+        int64_t now = 1700000000000;
+        for (int64_t &value: result)
+            value = now += 1000 + random() % 16;
+        return result;
+    }
+
+    template <typename Array, typename T>
+    bool same(Array const &array, vector<T> const &values)
+    {
+        if (array.size() != values.size())
+            return false;
+        for (size_t ix = 0; ix != values.size(); ++ix)
+            if (array[ix] != values[ix])
+                return false;
+        vector<T> decoded(values.size());
+        array.decode(0, values.size(), decoded.data());
+        return decoded == values;
+    }
+}
+
+int main()
+{
+    test("Sorted timestamps delta encode to a fraction of their size.",
+         []()
+         {
+             vector<int64_t> const values = timestamps(100000);
+             CompressedArray<int64_t> column(values);
+             return same(column, values)
+                 && column.bytes() * 5 < values.size() * sizeof(int64_t);
+         });
+
+    test("IDs from a narrow range are framed, and read without the cache.",
+         []()
+         {
+             mt19937 random(2);
+             vector<uint32_t> values(10000);
+             for (uint32_t &value: values)
+                 value = 4000000000u + random() % 16;
+             CompressedArray<uint32_t> column(values);
+             return same(column, values)
+                 && column.bytes() * 4 < values.size() * sizeof(uint32_t)
+                 && column.hits() + column.misses() == 0;
+         });
+
+    test("Reads of a delta block decode it once, into the cache.",
+         []()
+         {
+             vector<int64_t> const values = timestamps(1024);
+             CompressedArray<int64_t> column(values, 2);
+             CompressedArray<int64_t> uncached(values, 0);
+             int64_t sum = 0;
+             for (size_t ix = 0; ix != 512; ++ix)
+                 sum += column[ix] - uncached[ix];
+             return sum == 0
+                 && column.misses() == 2
+                 && column.hits() == 510
+                 && uncached.misses() == 512;
+         });
+
+    test("Writes are seen at once, and merged into the block later.",
+         []()
+         {
+             vector<int64_t> values = timestamps(1000);
+             CompressedArray<int64_t> column(values);
+             size_t const before = column.bytes();
+             column[5] = -1;
+             values[5] = -1;
+             bool const pending = column[5] == -1 && column.bytes() > before;
+             for (size_t ix = 10; ix != 30; ++ix)      // More than 256 / 32 writes.
+                 values[ix] = column[ix] = int64_t(ix);
+             column[990] = 7;                           // In the tail.
+             values[990] = 7;
+             column.flush();
+             return pending
+                 && same(column, values);
+         });
+
+    test("Random writes of any value agree with a vector.",
+         []()
+         {
+             mt19937_64 random(3);
+             vector<int64_t> values = timestamps(3000);
+             CompressedArray<int64_t, 64> column(values, 4);
+             for (int step = 0; step != 20000; ++step)
+             {
+                 size_t const ix = random() % values.size();
+                 int64_t value = 0;
+                 switch (random() % 3)
+                 {
+                     case 0: value = static_cast<int64_t>(random()); break;   // Raw blocks.
+                     case 1: value = -int64_t(random() % 1000); break;
+                     default: value = values[ix] + 1; break;
+                 }
+                 values[ix] = column[ix] = value;
+                 if (step % 5000 == 0 && not same(column, values))
+                     return false;
+             }
+             return same(column, values);
+         });
+
+    test("push_back fills blocks, and decode handles any range.",
+         []()
+         {
+             CompressedArray<int8_t, 16> column;
+             vector<int8_t> values;
+             for (int ix = 0; ix != 100; ++ix)
+             {
+                 values.push_back(static_cast<int8_t>(ix % 7 == 0 ? -128 : 127 - ix));
+                 column.push_back(values.back());
+             }
+             for (size_t first = 0; first < values.size(); first += 7)
+                 for (size_t last = first; last <= values.size(); last += 13)
+                 {
+                     vector<int8_t> decoded(last - first);
+                     column.decode(first, last, decoded.data());
+                     if (decoded != vector<int8_t>(values.begin() + first, values.begin() + last))
+                         return false;
+                 }
+             return same(column, values);
+         });
+
+    return TestCount::result();
+}
@@ -0,0 +1,49 @@
+#ifndef constantkey_hh_defd
+#define constantkey_hh_defd
+
+#ifndef def_h_include_indexproxifier_hh
+#error "Don't include constantkey.hh. Include indexproxifier.hh instead."
+#endif
+
+#include <type_traits>
+
+namespace ip
+{
+    /**
+       Compile-time key: mc[ip::key<3>] or rec[ip::key<Field::Length>].
+
+       If Derived has a member template proxy_return_action<Value>() (and/or
+       proxy_accept_action<Value>(value)), the LRProxy calls that, so masks,
+       offsets and even the element type may depend on the key. Otherwise
+       the key converts to its value, and the ordinary
+       proxy_return_action(key) gets it at run time.
+    */
+    template <auto Value>
+    inline constexpr std::integral_constant<decltype(Value), Value> key{};
+}
+
+// constant_key<Key>::value is the value of a compile-time key, and doesn't
+// exist for other keys. Cv-qualifiers and references are ignored.
+template <typename Key>
+struct constant_key
+{};
+
+template <typename T, T Value>
+struct constant_key<std::integral_constant<T, Value>>
+{
+    static constexpr T value = Value;
+};
+
+template <typename Key>
+struct constant_key<Key const>: constant_key<Key>
+{};
+
+template <typename Key>
+struct constant_key<Key &>: constant_key<Key>
+{};
+
+template <typename Key>
+struct constant_key<Key &&>: constant_key<Key>
+{};
+
+#endif //constantkey_hh_defd
@@ -0,0 +1,181 @@
+#include "../indexproxifier.hh"
+#include "../lrproxy/unit_test/eightbits/eightbits.hh"
+#include "../../unittest/unittest.hh"
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+using namespace std;
+
+namespace
+{
+    enum class Field
+    {
+        Length,
+        Name,
+        Ratio,
+    };
+
+    // Heterogeneous record: each field has its own type.
+    class Record: protected IndexProxifier<Record>
+    {
+        uint16_t d_length = 0;
+        string d_name;
+        double d_ratio = 0;
+
+    public:
+        using IndexProxifier<Record>::operator[];
+
+    private:
+        friend IndexProxifier<Record>;
+
+        template <Field Key>
+        auto &field();
+
+        template <Field Key>
+        auto proxy_return_action()
+        {
+            return field<Key>();
+        }
+
+        template <Field Key, typename Value>
+        void proxy_accept_action(Value const &value)
+        {
+            field<Key>() = value;
+        }
+    };
+
+    template <Field Key>
+    auto &Record::field()
+    {
+        if constexpr (Key == Field::Length)
+                         return d_length;
+        else if constexpr (Key == Field::Name)
+                              return d_name;
+        else
+            return d_ratio;
+    }
+
+    // Register of 16 flag bits. Counts which actions ran.
+    class Flags: protected IndexProxifier<Flags>
+    {
+        uint16_t d_bits = 0;
+
+    public:
+        int runtime = 0;
+        int compiletime = 0;
+
+        constexpr uint16_t bits() const
+        {
+            return d_bits;
+        }
+
+        using IndexProxifier<Flags>::operator[];
+
+    private:
+        friend IndexProxifier<Flags>;
+
+        constexpr bool proxy_return_action(int key)
+        {
+            ++runtime;
+            return d_bits >> key & 1;
+        }
+
+        constexpr bool proxy_accept_action(int key, bool value)
+        {
+            ++runtime;
+            d_bits = value ? d_bits | 1u << key : d_bits & ~(1u << key);
+            return value;
+        }
+
+        template <int Key>
+        constexpr bool proxy_return_action()
+        {
+            static_assert(Key >= 0 && Key < 16, "Flags has 16 bits.");
+            ++compiletime;
+            return d_bits & Mask<Key>;
+        }
+
+        template <int Key>
+        constexpr bool proxy_accept_action(bool value)
+        {
+            static_assert(Key >= 0 && Key < 16, "Flags has 16 bits.");
+            ++compiletime;
+            d_bits = value ? d_bits | Mask<Key> : d_bits & ~Mask<Key>;
+            return value;
+        }
+
+        template <int Key>
+        static constexpr uint16_t Mask = 1u << Key;
+    };
+
+    consteval uint16_t set_flags()
+    {
+        Flags flags;
+        flags[ip::key<0>] = true;
+        flags[ip::key<15>] = true;
+        flags[ip::key<0>] = not flags[ip::key<15>];
+        return flags.bits();
+    }
+}
+
+int main()
+{
+    static_assert(set_flags() == 0x8000,
+                  "Compile-time keys should work in constant expressions.");
+
+    test("Compile-time keys go to the proxy action templates.",
+         []()
+         {
+             Flags flags;
+             flags[ip::key<3>] = true;
+             bool three = flags[ip::key<3>];
+             bool four = flags[ip::key<4>];
+             return three && not four
+                 && flags.bits() == 0x8
+                 && flags.compiletime == 3
+                 && flags.runtime == 0;
+         });
+
+    test("Run-time keys still go to the ordinary proxy actions.",
+         []()
+         {
+             Flags flags;
+             for (int key = 0; key < 16; key += 5)
+                 flags[key] = true;
+             return flags[5] == true
+                 && flags[ip::key<10>] == true
+                 && flags.bits() == 0x8421
+                 && flags.runtime == 5
+                 && flags.compiletime == 1;
+         });
+
+    test("Each field of a record has its own type.",
+         []()
+         {
+             Record record;
+             record[ip::key<Field::Length>] = 70000; // Wraps, as a uint16_t.
+             record[ip::key<Field::Name>] = "width";
+             record[ip::key<Field::Ratio>] = 0.5;
+             uint16_t length = record[ip::key<Field::Length>];
+             string name = record[ip::key<Field::Name>];
+             double ratio = record[ip::key<Field::Ratio>];
+             static_assert(is_same<decltype(record[ip::key<Field::Name>])::indexproxifier_conversion_type, string>::value,
+                           "A field's proxy converts to the field's type.");
+             return length == 70000 - 65536
+                 && name == "width"
+                 && ratio == 0.5;
+         });
+
+    test("Owners without action templates get the key's value.",
+         []()
+         {
+             EightBits bits;
+             bits[ip::key<2>] = true;
+             return bits[ip::key<2>] == true
+                 && bits.internal() == 4;
+         });
+
+    return TestCount::result();
+}
@@ -0,0 +1,235 @@
+#ifndef dictionarycolumn_hh_defd
+#define dictionarycolumn_hh_defd
+
+#include "../indexproxifier.hh"
+#include "../bitset/dynamicbitset.hh"
+#include "../packed/packedarray.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+   Column of strings, of which there are few distinct ones, stored as codes
+   into a dictionary of those:
+
+       DictionaryColumn country(1000000);
+       country[0] = "NL";                  // Interns "NL", stores its code.
+       std::string_view name = country[0]; // Into the dictionary.
+       DynamicBitset dutch = country.equal_to("NL");
+
+   Codes are packed in a PackedArray as wide as the number of distinct
+   strings needs; when the dictionary outgrows it, the codes are repacked
+   one bit wider. The empty string is code 0, so new rows are "".
+
+   Reads return std::string_view into the dictionary and allocate nothing.
+   Writes look the string up in a hash index of string_views, and only copy
+   it into the dictionary if it is new. Assigning an element of the same
+   column copies its code. Strings stay in the dictionary after the last
+   row using them is overwritten.
+
+   equal_to and count look the string up once, and then compare codes,
+   decoded a chunk at a time with PackedKernels::best().
+*/
+class DictionaryColumn: protected IndexProxifier<DictionaryColumn>
+{
+    enum : std::size_t
+    {
+        ScanChunk = 1024,
+    };
+
+    std::deque<std::string> d_dictionary;   // Never moves its strings.
+    std::unordered_map<std::string_view, uint32_t> d_codes;
+    std::optional<PackedArray<>> d_rows;    // Replaced when widened.
+
+public:
+    static constexpr uint32_t npos = static_cast<uint32_t>(-1);
+
+    explicit DictionaryColumn(std::size_t size = 0);
+    DictionaryColumn(DictionaryColumn const &other);
+    DictionaryColumn(DictionaryColumn &&tmp) = default; // The strings stay put.
+
+    std::size_t size() const;
+    void resize(std::size_t size);
+    void push_back(std::string_view value);
+
+    std::size_t cardinality() const;        // Distinct strings so far.
+    unsigned width() const;                 // Bits per row.
+    std::size_t bytes() const;              // Of the codes and the strings.
+
+    uint32_t code(std::size_t ix) const;
+    uint32_t find(std::string_view value) const; // Code of value, or npos.
+    std::string_view value(uint32_t code) const;
+
+    // Rows holding value.
+    DynamicBitset equal_to(std::string_view value) const;
+    std::size_t count(std::string_view value) const;
+
+    using IndexProxifier<DictionaryColumn>::operator[];
+
+private:
+    friend IndexProxifier<DictionaryColumn>;
+
+    std::string_view proxy_return_action(std::size_t ix) const;
+    std::string_view proxy_accept_action(std::size_t ix, std::string_view value);
+    std::string_view proxy_transfer_action(std::size_t ix, DictionaryColumn const &source,
+                                           std::size_t sourceix);
+
+    uint32_t intern(std::string_view value);
+
+    // Calls found(ix) for every row with code.
+    template <typename Found>
+    void scan(uint32_t code, Found &&found) const;
+};
+
+inline DictionaryColumn::DictionaryColumn(std::size_t size)
+    : d_rows(std::in_place, size, 1)
+{
+    intern("");
+}
+
+// The index must refer to our copies of the strings.
+inline DictionaryColumn::DictionaryColumn(DictionaryColumn const &other)
+    : IndexProxifier<DictionaryColumn>(other),
+      d_dictionary(other.d_dictionary),
+      d_rows(other.d_rows)
+{
+    d_codes.reserve(d_dictionary.size());
+    for (std::size_t code = 0; code != d_dictionary.size(); ++code)
+        d_codes.emplace(d_dictionary[code], static_cast<uint32_t>(code));
+}
+
+inline std::size_t DictionaryColumn::size() const
+{
+    return d_rows->size();
+}
+
+inline void DictionaryColumn::resize(std::size_t size)
+{
+    d_rows->resize(size);
+}
+
+inline void DictionaryColumn::push_back(std::string_view value)
+{
+    uint32_t const code = intern(value);
+    std::size_t const ix = size();
+    d_rows->resize(ix + 1);
+    (*d_rows)[ix] = code;
+}
+
+inline std::size_t DictionaryColumn::cardinality() const
+{
+    return d_dictionary.size();
+}
+
+inline unsigned DictionaryColumn::width() const
+{
+    return d_rows->width();
+}
+
+inline std::size_t DictionaryColumn::bytes() const
+{
+    std::size_t total = d_rows->words().size() * sizeof(uint64_t);
+    for (std::string const &value: d_dictionary)
+        total += sizeof(std::string) + (value.capacity() > 15 ? value.capacity() : 0);
+    return total;
+}
+
+inline uint32_t DictionaryColumn::code(std::size_t ix) const
+{
+    return (*d_rows)[ix];
+}
+
+inline uint32_t DictionaryColumn::find(std::string_view value) const
+{
+    auto found = d_codes.find(value);
+    return found == d_codes.end() ? npos : found->second;
+}
+
+inline std::string_view DictionaryColumn::value(uint32_t code) const
+{
+    return d_dictionary[code];
+}
+
+inline DynamicBitset DictionaryColumn::equal_to(std::string_view value) const
+{
+    DynamicBitset rows(size());
+    uint32_t const wanted = find(value);
+    if (wanted != npos)
+        scan(wanted, [&](std::size_t ix) { rows[ix] = true; });
+    return rows;
+}
+
+inline std::size_t DictionaryColumn::count(std::string_view value) const
+{
+    std::size_t total = 0;
+    uint32_t const wanted = find(value);
+    if (wanted != npos)
+        scan(wanted, [&](std::size_t) { ++total; });
+    return total;
+}
+
+inline std::string_view DictionaryColumn::proxy_return_action(std::size_t ix) const
+{
+    return d_dictionary[code(ix)];
+}
+
+inline std::string_view DictionaryColumn::proxy_accept_action(std::size_t ix, std::string_view value)
+{
+    uint32_t const code = intern(value);
+    (*d_rows)[ix] = code;
+    return d_dictionary[code];
+}
+
+inline std::string_view DictionaryColumn::proxy_transfer_action(std::size_t ix, DictionaryColumn const &source,
+                                                                std::size_t sourceix)
+{
+    if (&source != this)
+        return proxy_accept_action(ix, source.proxy_return_action(sourceix));
+    uint32_t const code = source.code(sourceix);
+    (*d_rows)[ix] = code;
+    return d_dictionary[code];
+}
+
+// Widens the codes when the new code wouldn't fit.
+inline uint32_t DictionaryColumn::intern(std::string_view value)
+{
+    if (auto found = d_codes.find(value); found != d_codes.end())
+        return found->second;
+
+    uint32_t const code = static_cast<uint32_t>(d_dictionary.size());
+    unsigned const needed = std::max(1u, static_cast<unsigned>(std::bit_width(code)));
+    if (needed > width())
+    {
+        std::vector<uint32_t> codes(size());
+        d_rows->decode(0, codes.size(), codes.data());
+        PackedArray<> wider(codes.size(), needed);
+        wider.encode(codes.data(), 0, codes.size());
+        d_rows.emplace(std::move(wider));
+    }
+    d_codes.emplace(d_dictionary.emplace_back(value), code);
+    return code;
+}
+
+template <typename Found>
+void DictionaryColumn::scan(uint32_t code, Found &&found) const
+{
+    uint32_t codes[ScanChunk];
+    for (std::size_t first = 0; first < size(); first += ScanChunk)
+    {
+        std::size_t const count = std::min<std::size_t>(ScanChunk, size() - first);
+        d_rows->decode(first, first + count, codes);
+        for (std::size_t ix = 0; ix != count; ++ix)
+            if (codes[ix] == code)
+                found(first + ix);
+    }
+}
+
+#endif //dictionarycolumn_hh_defd
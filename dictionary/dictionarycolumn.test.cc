@@ -0,0 +1,142 @@
+#include "dictionarycolumn.hh"
+#include "../../unittest/unittest.hh"
+
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    string city(size_t ix)
+    {
+        return "city number " + to_string(ix);
+    }
+}
+
+int main()
+{
+    test("Rows read back what was written, as views into the dictionary.",
+         []()
+         {
+             DictionaryColumn column(3);
+             column[0] = "Amsterdam";
+             column[1] = string("Rotterdam");
+             column[2] = "Amsterdam";
+             string_view first = column[0];
+             string_view last = column[2];
+             return first == "Amsterdam"
+                 && first.data() == last.data()     // The same dictionary entry.
+                 && column[1] == "Rotterdam"
+                 && column.cardinality() == 3       // With "".
+                 && column.code(0) == column.code(2);
+         });
+
+    test("New rows are empty strings.",
+         []()
+         {
+             DictionaryColumn column(2);
+             column.push_back("x");
+             column.resize(5);
+             return column[0] == ""
+                 && column[2] == "x"
+                 && column[4] == ""
+                 && column.size() == 5;
+         });
+
+    test("Codes widen as the dictionary grows, keeping the rows.",
+         []()
+         {
+             DictionaryColumn column;
+             unsigned const narrow = column.width();
+             vector<string> expected;
+             for (size_t ix = 0; ix != 3000; ++ix)
+             {
+                 expected.push_back(city(ix % 1000));
+                 column.push_back(expected.back());
+             }
+             for (size_t ix = 0; ix != expected.size(); ++ix)
+                 if (column[ix] != expected[ix])
+                     return false;
+             return narrow == 1
+                 && column.width() == 10                     // 1001 strings.
+                 && column.cardinality() == 1001;
+         });
+
+    test("Equality filters compare codes.",
+         []()
+         {
+             mt19937 random(4);
+             DictionaryColumn column;
+             vector<size_t> rows;
+             for (size_t ix = 0; ix != 10000; ++ix)
+             {
+                 size_t const which = random() % 50;
+                 column.push_back(city(which));
+                 if (which == 7)
+                     rows.push_back(ix);
+             }
+             DynamicBitset const matches = column.equal_to(city(7));
+             vector<size_t> found;
+             for (size_t ix: matches.ones())
+                 found.push_back(ix);
+             return found == rows
+                 && column.count(city(7)) == rows.size()
+                 && column.count("nowhere") == 0
+                 && column.equal_to("nowhere").none()
+                 && column.find("nowhere") == DictionaryColumn::npos;
+         });
+
+    test("Element to element assignment copies codes, also across columns.",
+         []()
+         {
+             DictionaryColumn lhs(2), rhs(1);
+             lhs[0] = "a";
+             rhs[0] = "b";
+             lhs[1] = lhs[0];
+             size_t const before = lhs.cardinality();
+             lhs[0] = rhs[0];
+             return lhs[1] == "a"
+                 && lhs.code(1) == lhs.find("a")
+                 && before == 2
+                 && lhs[0] == "b"
+                 && lhs.cardinality() == 3;
+         });
+
+    test("A copy has its own dictionary, and outlives the original.",
+         []()
+         {
+             DictionaryColumn *original = new DictionaryColumn(2);
+             (*original)[0] = "kept";
+             (*original)[1] = "also kept";
+             DictionaryColumn copy(*original);
+             delete original;
+             copy[1] = "kept";               // Looks up an existing string ...
+             copy.push_back("new");          // ... and interns a new one.
+             string_view first = copy[0];
+             return first == "kept"
+                 && copy.code(1) == copy.code(0)
+                 && copy[2] == "new"
+                 && copy.find("also kept") != DictionaryColumn::npos
+                 && copy.cardinality() == 4;
+         });
+
+    test("Low-cardinality columns take a fraction of the strings' memory.",
+         []()
+         {
+             DictionaryColumn column;
+             size_t plain = 0;
+             for (size_t ix = 0; ix != 100000; ++ix)
+             {
+                 string const value = city(ix % 100) + " with a name too long for SSO";
+                 plain += sizeof(string) + value.capacity();
+                 column.push_back(value);
+             }
+             return column.width() == 7
+                 && column.bytes() * 20 < plain;
+         });
+
+    return TestCount::result();
+}
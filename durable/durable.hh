@@ -0,0 +1,678 @@
+#ifndef durable_hh_defd
+#define durable_hh_defd
+
+#include "../indexproxifier.hh"
+#include "../bulkio/bulkio.hh"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+   Makes the writes to an owner deriving from IndexProxifier survive
+   crashes, by logging them ahead:
+
+       Ledger ledger(1000);
+       Durable<Ledger> durable(ledger, "ledger.wal");   // Replays the log.
+       durable[key] = value;        // Returns once value is on disk.
+       long value = durable[key];
+
+   Every accepted (key, value) is appended to a binary write-ahead log. A
+   background thread writes the log and fdatasyncs it; all writes that came
+   in during one fdatasync share the next one (group commit), so many
+   concurrent writers need few syncs.
+
+   In mode Acknowledged (the default), a write returns once it is durable.
+   In mode FireAndForget it returns at once, and is durable after the next
+   sync; wait_durable() waits for that.
+
+   Writes are applied to the owner at once, so reads see them before they
+   are durable. If writing or syncing the log fails, the writes not yet
+   durable are taken back, newest first, so the owner again holds what a
+   restart would restore: a write that threw leaves no trace. Later writes
+   throw std::system_error too.
+
+   On construction, the checkpoint (path + ".checkpoint", if there is one)
+   is loaded into the owner, and then the log is replayed. A torn record at
+   the end of the log, from a crash while writing it, is cut off.
+   checkpoint() saves the owner to the checkpoint file and empties the log;
+   that also happens automatically when the log grows beyond checkpointsize
+   bytes. The owner is only copied to memory while reads and writes wait:
+   the log is renamed to path + ".old" and a new one started, and another
+   thread writes the checkpoint and then removes the old log. (A restart
+   finding an old log replays it before the log, and checkpoints.)
+   Checkpoints require an owner ip::save and ip::load can handle, i.e. one
+   with size(): for other owners checkpoint() doesn't compile, and the log
+   grows without bound.
+
+   Keys and values must be trivially copyable. Errors opening or reading the
+   files throw std::system_error.
+*/
+
+struct WalHeader
+{
+    enum : uint16_t
+    {
+        Version = 1,
+        ByteOrder = 0x0102,
+    };
+
+    char magic[4] = {'I', 'P', 'X', 'W'};
+    uint16_t version = Version;
+    uint16_t byteorder = ByteOrder;
+    uint32_t keysize = 0;
+    uint32_t valuesize = 0;
+
+    bool valid_for(std::size_t keysize, std::size_t valuesize) const;
+};
+
+static_assert(sizeof(WalHeader) == 16, "WalHeader layout must be fixed.");
+
+inline bool WalHeader::valid_for(std::size_t keysize_, std::size_t valuesize_) const
+{
+    return std::memcmp(magic, WalHeader{}.magic, sizeof magic) == 0
+        && version == Version
+        && byteorder == ByteOrder
+        && keysize == keysize_
+        && valuesize == valuesize_;
+}
+
+// FNV-1a: detects torn and garbled records, not tampering.
+inline uint32_t wal_checksum(char const *data, std::size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (std::size_t ix = 0; ix != size; ++ix)
+        hash = (hash ^ static_cast<unsigned char>(data[ix])) * 16777619u;
+    return hash;
+}
+
+template <typename Owner, typename Key = std::size_t>
+class Durable: protected IndexProxifier<Durable<Owner, Key>>
+{
+public:
+    typedef typename std::remove_cvref<
+        typename decltype(std::declval<Owner &>()[std::declval<Key const &>()])::indexproxifier_conversion_type
+        >::type value_type;
+
+    enum Mode
+    {
+        Acknowledged,
+        FireAndForget,
+    };
+
+private:
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<value_type>::value,
+                  "The write-ahead log needs trivially copyable keys and values.");
+
+    // Record: key, value, checksum of both.
+    enum : std::size_t
+    {
+        RecordSize = sizeof(Key) + sizeof(value_type) + sizeof(uint32_t)
+    };
+
+    // What a write not yet durable replaced.
+    struct Undo
+    {
+        Key key;
+        value_type previous;
+    };
+
+    // Collects a snapshot of the owner for ip::save.
+    struct SnapshotSink
+    {
+        std::vector<char> &snapshot;
+
+        bool write(char const *data, std::size_t size);
+    };
+
+    Owner &d_owner;
+    std::string d_path;
+    Mode d_mode;
+    std::size_t d_checkpointsize;
+    int d_fd = -1;
+
+    std::mutex d_mutex;                 // Guards all below, and d_owner.
+    std::condition_variable d_work;     // For the flusher.
+    std::condition_variable d_done;     // For writers awaiting durability.
+    std::condition_variable d_snapshotready; // For the checkpointer.
+    std::vector<char> d_buffer;         // Records not yet written.
+    std::vector<Undo> d_undo;           // Of the records in d_buffer.
+    uint64_t d_appended = 0;            // Records accepted.
+    uint64_t d_durable = 0;             // Records synced.
+    std::size_t d_logsize = 0;          // Bytes in the log file.
+    std::size_t d_syncs = 0;
+    bool d_checkpointwanted = false;
+    bool d_checkpointing = false;       // From log rotation to old log removal.
+    std::vector<char> d_snapshot;       // For the checkpointer to write.
+    bool d_newlog = false;              // Its directory entry isn't synced yet.
+    std::size_t d_checkpoints = 0;
+    int d_error = 0;                    // errno of a failed write or sync.
+    bool d_stopping = false;
+    std::thread d_flusher;
+    std::thread d_checkpointer;
+
+public:
+    Durable(Owner &owner, std::string path, Mode mode = Acknowledged,
+            std::size_t checkpointsize = 64 << 20);
+    Durable(Durable const &other) = delete;
+    ~Durable(); // Writes and syncs what is left.
+
+    // Waits until all writes accepted so far are durable.
+    void wait_durable();
+
+    // Saves the owner and empties the log. Waits for it to happen.
+    void checkpoint()
+        requires requires (Owner &owner) { owner.size(); };
+
+    std::size_t syncs();
+    std::size_t log_size();
+
+    using IndexProxifier<Durable>::operator[];
+
+private:
+    friend IndexProxifier<Durable>;
+
+    value_type proxy_return_action(Key const &key);
+    value_type proxy_accept_action(Key const &key, value_type const &value);
+
+    void open_log();
+    std::size_t replay(int fd, std::string const &path);
+    bool replay_old_log();
+    void flush();
+    bool start_checkpoint();
+    bool rotate_log();
+    void checkpointer();
+    bool write_checkpoint(std::vector<char> const &snapshot) const;
+    void fail(int error);
+    void undo(std::vector<Undo> &undo);
+    void throw_if_failed() const;
+
+    static bool write_fully(int fd, char const *data, std::size_t size);
+    static bool sync_directory_of(std::string const &path);
+};
+
+template <typename Owner, typename Key>
+bool Durable<Owner, Key>::SnapshotSink::write(char const *data, std::size_t size)
+{
+    snapshot.insert(snapshot.end(), data, data + size);
+    return true;
+}
+
+template <typename Owner, typename Key>
+Durable<Owner, Key>::Durable(Owner &owner, std::string path, Mode mode, std::size_t checkpointsize)
+    : d_owner(owner),
+      d_path(std::move(path)),
+      d_mode(mode),
+      d_checkpointsize(checkpointsize)
+{
+    if constexpr (requires { owner.size(); })
+    {
+        int fd = ::open((d_path + ".checkpoint").c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0)
+        {
+            FdSource source(fd);
+            bool loaded = ip::load(d_owner, source);
+            ::close(fd);
+            if (not loaded)
+                throw std::system_error(EILSEQ, std::generic_category(), "Cannot load " + d_path + ".checkpoint");
+        }
+    }
+    bool const interrupted = replay_old_log();
+    open_log();
+    if (::lseek(d_fd, 0, SEEK_SET) < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot seek " + d_path);
+    d_logsize = replay(d_fd, d_path);
+    if (::ftruncate(d_fd, d_logsize) < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot truncate " + d_path);
+
+    if constexpr (requires { owner.size(); })
+    {
+        // Before the old log gets overwritten by the next rotation.
+        if (interrupted)
+        {
+            std::vector<char> snapshot;
+            SnapshotSink sink{snapshot};
+            if (not ip::save(d_owner, sink)
+                or not write_checkpoint(snapshot)
+                or ::unlink((d_path + ".old").c_str()) < 0
+                or ::ftruncate(d_fd, sizeof(WalHeader)) < 0
+                or ::fdatasync(d_fd) < 0)
+                throw std::system_error(errno != 0 ? errno : EIO, std::system_category(),
+                                        "Cannot checkpoint " + d_path);
+            d_logsize = sizeof(WalHeader);
+        }
+        d_checkpointer = std::thread(&Durable::checkpointer, this);
+    }
+    d_flusher = std::thread(&Durable::flush, this);
+}
+
+template <typename Owner, typename Key>
+Durable<Owner, Key>::~Durable()
+{
+    {
+        std::lock_guard<std::mutex> lock(d_mutex);
+        d_stopping = true;
+    }
+    d_work.notify_one();
+    d_flusher.join();
+    d_snapshotready.notify_one();
+    if (d_checkpointer.joinable())
+        d_checkpointer.join();  // After finishing a checkpoint it has started.
+    ::close(d_fd);
+}
+
+template <typename Owner, typename Key>
+void Durable<Owner, Key>::wait_durable()
+{
+    std::unique_lock<std::mutex> lock(d_mutex);
+    uint64_t const target = d_appended;
+    d_done.wait(lock,
+        [&]()
+        {
+            return d_durable >= target || d_error != 0;
+        });
+    throw_if_failed();
+}
+
+template <typename Owner, typename Key>
+void Durable<Owner, Key>::checkpoint()
+    requires requires (Owner &owner) { owner.size(); }
+{
+    std::unique_lock<std::mutex> lock(d_mutex);
+    // One in progress may have a snapshot from before the call.
+    std::size_t const target = d_checkpoints + (d_checkpointing ? 2 : 1);
+    d_checkpointwanted = true;
+    d_work.notify_one();
+    d_done.wait(lock,
+        [&]()
+        {
+            return d_checkpoints >= target || d_error != 0;
+        });
+    throw_if_failed();
+}
+
+template <typename Owner, typename Key>
+std::size_t Durable<Owner, Key>::syncs()
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+    return d_syncs;
+}
+
+template <typename Owner, typename Key>
+std::size_t Durable<Owner, Key>::log_size()
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+    return d_logsize;
+}
+
+template <typename Owner, typename Key>
+typename Durable<Owner, Key>::value_type Durable<Owner, Key>::proxy_return_action(Key const &key)
+{
+    std::lock_guard<std::mutex> lock(d_mutex);
+    return d_owner[key];
+}
+
+// Applied to the owner at once, so reads see it, but acknowledged only
+// once the log holds it. The previous value is kept until then, to take
+// the write back if the log fails.
+template <typename Owner, typename Key>
+typename Durable<Owner, Key>::value_type Durable<Owner, Key>::proxy_accept_action(Key const &key, value_type const &value)
+{
+    std::unique_lock<std::mutex> lock(d_mutex);
+    throw_if_failed();
+
+    value_type const previous = d_owner[key];
+    value_type copy = value;
+    d_owner[key] = copy; // Lvalue: accept action may take a reference.
+    d_undo.push_back(Undo{key, previous});
+
+    std::size_t const used = d_buffer.size();
+    d_buffer.resize(used + RecordSize);
+    char *record = d_buffer.data() + used;
+    std::memcpy(record, &key, sizeof(Key));
+    std::memcpy(record + sizeof(Key), &value, sizeof(value_type));
+    uint32_t const checksum = wal_checksum(record, sizeof(Key) + sizeof(value_type));
+    std::memcpy(record + sizeof(Key) + sizeof(value_type), &checksum, sizeof checksum);
+
+    uint64_t const sequence = ++d_appended;
+    d_work.notify_one();
+    if (d_mode == Acknowledged)
+    {
+        d_done.wait(lock,
+            [&]()
+            {
+                return d_durable >= sequence || d_error != 0;
+            });
+        if (d_durable < sequence) // Else durable, whatever failed later.
+            throw_if_failed();
+    }
+    return value;
+}
+
+template <typename Owner, typename Key>
+void Durable<Owner, Key>::open_log()
+{
+    d_fd = ::open(d_path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (d_fd < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot open " + d_path);
+
+    struct stat status;
+    if (::fstat(d_fd, &status) < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot stat " + d_path);
+    if (status.st_size != 0)
+        return;
+
+    WalHeader header;
+    header.keysize = sizeof(Key);
+    header.valuesize = sizeof(value_type);
+    if (not write_fully(d_fd, reinterpret_cast<char const *>(&header), sizeof header) or ::fdatasync(d_fd) < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot initialize " + d_path);
+}
+
+// Applies the records in the log, up to the first one that is torn, and
+// returns the size up to there. Reads from fd's current position.
+template <typename Owner, typename Key>
+std::size_t Durable<Owner, Key>::replay(int fd, std::string const &path)
+{
+    FdSource source(fd);
+
+    WalHeader header;
+    if (not source.read(reinterpret_cast<char *>(&header), sizeof header)
+        or not header.valid_for(sizeof(Key), sizeof(value_type)))
+        throw std::system_error(EILSEQ, std::generic_category(), path + " is not a matching log");
+
+    std::size_t size = sizeof header;
+    char record[RecordSize];
+    while (source.read(record, RecordSize))
+    {
+        uint32_t checksum;
+        std::memcpy(&checksum, record + sizeof(Key) + sizeof(value_type), sizeof checksum);
+        if (checksum != wal_checksum(record, sizeof(Key) + sizeof(value_type)))
+            break;
+        Key key;
+        value_type value;
+        std::memcpy(&key, record, sizeof(Key));
+        std::memcpy(&value, record + sizeof(Key), sizeof(value_type));
+        d_owner[key] = value; // Lvalue: accept action may take a reference.
+        size += RecordSize;
+    }
+    return size;
+}
+
+// Replays the old log of a checkpoint a crash interrupted, if any. It
+// holds the writes between the checkpoint and the log. Returns whether
+// there was one.
+template <typename Owner, typename Key>
+bool Durable<Owner, Key>::replay_old_log()
+{
+    std::string const old = d_path + ".old";
+    int fd = ::open(old.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        if (errno == ENOENT)
+            return false;
+        throw std::system_error(errno, std::system_category(), "Cannot open " + old);
+    }
+    try
+    {
+        replay(fd, old);
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    return true;
+}
+
+// The flusher thread. Writes and syncs whatever accumulated meanwhile.
+template <typename Owner, typename Key>
+void Durable<Owner, Key>::flush()
+{
+    std::unique_lock<std::mutex> lock(d_mutex);
+    std::vector<char> writing;
+    std::vector<Undo> undoing;
+    while (true)
+    {
+        d_work.wait(lock,
+            [&]()
+            {
+                return not d_buffer.empty() || (d_checkpointwanted && not d_checkpointing) || d_stopping;
+            });
+
+        if (not d_buffer.empty() && d_error == 0)
+        {
+            writing.swap(d_buffer);
+            undoing.swap(d_undo);
+            uint64_t const sequence = d_appended;
+            bool const newlog = std::exchange(d_newlog, false);
+            lock.unlock();
+            bool const written = write_fully(d_fd, writing.data(), writing.size())
+                                 && ::fdatasync(d_fd) == 0
+                                 && (not newlog || sync_directory_of(d_path));
+            int const error = written ? 0 : errno;
+            lock.lock();
+            if (written)
+            {
+                d_durable = sequence;
+                d_logsize += writing.size();
+                ++d_syncs;
+            }
+            else
+            {
+                fail(error);        // Takes back the later writes,
+                undo(undoing);      // and then these.
+            }
+            writing.clear();
+            undoing.clear();
+            d_done.notify_all();
+            continue; // More may have come in.
+        }
+
+        // Everything is synced, and writers wait for the lock. A requested
+        // checkpoint is answered even after an error (checkpoint() then
+        // throws), or the wait above would keep returning at once.
+        if constexpr (requires { d_owner.size(); })
+            if ((d_checkpointwanted || (d_logsize > d_checkpointsize && d_error == 0))
+                && not d_checkpointing && not d_stopping)
+            {
+                d_checkpointwanted = false;
+                if (d_error == 0 && start_checkpoint())
+                {
+                    d_checkpointing = true;
+                    d_snapshotready.notify_one();
+                }
+                else
+                {
+                    ++d_checkpoints;
+                    d_done.notify_all();
+                }
+            }
+
+        if (d_stopping)
+        {
+            d_done.notify_all();
+            return;
+        }
+    }
+}
+
+// Copies the owner to d_snapshot and starts a new log, with the lock held
+// and everything synced. The checkpointer takes it from there.
+template <typename Owner, typename Key>
+bool Durable<Owner, Key>::start_checkpoint()
+{
+    d_snapshot.clear();
+    SnapshotSink sink{d_snapshot};
+    errno = 0;
+    if (not ip::save(d_owner, sink) or not rotate_log())
+    {
+        d_snapshot.clear();
+        fail(errno != 0 ? errno : EIO);
+        return false;
+    }
+    return true;
+}
+
+// Renames the log to path + ".old", and starts an empty one. Its directory
+// entry is synced with its first records, before they are acknowledged.
+template <typename Owner, typename Key>
+bool Durable<Owner, Key>::rotate_log()
+{
+    if (::rename(d_path.c_str(), (d_path + ".old").c_str()) < 0)
+        return false;
+    int fd = ::open(d_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    WalHeader header;
+    header.keysize = sizeof(Key);
+    header.valuesize = sizeof(value_type);
+    if (not write_fully(fd, reinterpret_cast<char const *>(&header), sizeof header))
+    {
+        int const error = errno;
+        ::close(fd);
+        errno = error;
+        return false;
+    }
+    ::close(d_fd);
+    d_fd = fd;
+    d_logsize = sizeof header;
+    d_newlog = true;
+    return true;
+}
+
+// The checkpointer thread. Writes the snapshots the flusher takes, without
+// the lock, and then removes the old log.
+template <typename Owner, typename Key>
+void Durable<Owner, Key>::checkpointer()
+{
+    std::unique_lock<std::mutex> lock(d_mutex);
+    std::vector<char> snapshot;
+    while (true)
+    {
+        d_snapshotready.wait(lock,
+            [&]()
+            {
+                return not d_snapshot.empty() || d_stopping;
+            });
+        if (d_snapshot.empty())
+            return; // Stopping.
+
+        snapshot.swap(d_snapshot);
+        lock.unlock();
+        bool const saved = write_checkpoint(snapshot)
+                           && ::unlink((d_path + ".old").c_str()) == 0;
+        int const error = saved ? 0 : (errno != 0 ? errno : EIO);
+        lock.lock();
+        snapshot.clear();
+        if (not saved)
+            fail(error);
+        d_checkpointing = false;
+        ++d_checkpoints;
+        d_done.notify_all();
+        d_work.notify_one(); // A checkpoint may have been requested meanwhile.
+    }
+}
+
+// Write to a temporary, sync, rename: a crash leaves the old checkpoint or
+// the new one. The old log is removed after, so a crash in between replays
+// records the checkpoint already has, which is harmless.
+template <typename Owner, typename Key>
+bool Durable<Owner, Key>::write_checkpoint(std::vector<char> const &snapshot) const
+{
+    std::string const final = d_path + ".checkpoint";
+    std::string const temporary = final + ".tmp";
+
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+    bool const written = write_fully(fd, snapshot.data(), snapshot.size())
+                         && ::fdatasync(fd) == 0;
+    int const error = errno;
+    ::close(fd);
+    if (not written)
+    {
+        errno = error;
+        return false;
+    }
+    return ::rename(temporary.c_str(), final.c_str()) == 0
+        && sync_directory_of(final);
+}
+
+// Records the first error, and takes back the writes not yet handed to the
+// flusher. Later writes throw before changing anything.
+template <typename Owner, typename Key>
+void Durable<Owner, Key>::fail(int error)
+{
+    if (d_error == 0)
+        d_error = error != 0 ? error : EIO;
+    d_buffer.clear();
+    undo(d_undo);
+}
+
+// Newest first, so each key gets back the value it had before them all.
+template <typename Owner, typename Key>
+void Durable<Owner, Key>::undo(std::vector<Undo> &undo)
+{
+    for (auto entry = undo.rbegin(); entry != undo.rend(); ++entry)
+    {
+        value_type previous = entry->previous;
+        d_owner[entry->key] = previous; // Lvalue: accept action may take a reference.
+    }
+    undo.clear();
+}
+
+template <typename Owner, typename Key>
+void Durable<Owner, Key>::throw_if_failed() const
+{
+    if (d_error != 0)
+        throw std::system_error(d_error, std::system_category(), "Write-ahead log " + d_path + " failed");
+}
+
+template <typename Owner, typename Key>
+bool Durable<Owner, Key>::write_fully(int fd, char const *data, std::size_t size)
+{
+    while (size != 0)
+    {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Makes a rename in the directory durable.
+template <typename Owner, typename Key>
+bool Durable<Owner, Key>::sync_directory_of(std::string const &path)
+{
+    std::size_t const slash = path.rfind('/');
+    std::string const directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    bool const synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+#endif //durable_hh_defd
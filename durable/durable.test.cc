@@ -0,0 +1,343 @@
+#include "durable.hh"
+#include "../../unittest/unittest.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+    class Ledger: protected IndexProxifier<Ledger>
+    {
+        vector<long> d_balances;
+
+    public:
+        explicit Ledger(size_t size);
+
+        size_t size() const;
+
+        using IndexProxifier<Ledger>::operator[];
+
+    private:
+        friend IndexProxifier<Ledger>;
+
+        long proxy_return_action(size_t key) const;
+        void proxy_accept_action(size_t key, long value);
+    };
+
+    Ledger::Ledger(size_t size)
+        : d_balances(size)
+    {}
+
+    size_t Ledger::size() const
+    {
+        return d_balances.size();
+    }
+
+    long Ledger::proxy_return_action(size_t key) const
+    {
+        return d_balances.at(key);
+    }
+
+    void Ledger::proxy_accept_action(size_t key, long value)
+    {
+        d_balances.at(key) = value;
+    }
+
+    // An owner bulkio can't save: no checkpoints.
+    class Sizeless: protected IndexProxifier<Sizeless>
+    {
+        long d_value = 0;
+
+    public:
+        using IndexProxifier<Sizeless>::operator[];
+
+    private:
+        friend IndexProxifier<Sizeless>;
+
+        long proxy_return_action(size_t) const
+        {
+            return d_value;
+        }
+
+        void proxy_accept_action(size_t, long value)
+        {
+            d_value = value;
+        }
+    };
+
+    template <typename Owner>
+    constexpr bool can_checkpoint = requires (Durable<Owner> &durable) { durable.checkpoint(); };
+
+    static_assert(can_checkpoint<Ledger>);
+    static_assert(not can_checkpoint<Sizeless>);
+
+    // A fresh directory for the log, removed afterwards.
+    struct Scratch
+    {
+        string directory;
+        string log;
+
+        Scratch()
+        {
+            char name[] = "/tmp/durableXXXXXX";
+            directory = mkdtemp(name);
+            log = directory + "/ledger.wal";
+        }
+
+        ~Scratch()
+        {
+            unlink(log.c_str());
+            unlink((log + ".old").c_str());
+            unlink((log + ".checkpoint").c_str());
+            unlink((log + ".checkpoint.tmp").c_str());
+            rmdir(directory.c_str());
+        }
+    };
+
+    // Makes the descriptor this process has open on path read-only, so
+    // writing to it fails.
+    bool break_descriptor_of(string const &path)
+    {
+        int readonly = open("/dev/null", O_RDONLY);
+        bool broken = false;
+        for (int fd = 0; fd != 1024 && not broken; ++fd)
+        {
+            char target[4096];
+            ssize_t size = readlink(("/proc/self/fd/" + to_string(fd)).c_str(), target, sizeof target - 1);
+            if (size > 0 && string(target, size) == path)
+                broken = dup2(readonly, fd) == fd;
+        }
+        close(readonly);
+        return broken;
+    }
+}
+
+int main()
+{
+    test("Writes survive a restart.",
+         []()
+         {
+             Scratch scratch;
+             {
+                 Ledger ledger(10);
+                 Durable<Ledger> durable(ledger, scratch.log);
+                 durable[3] = 30;
+                 durable[4] = 40;
+                 durable[3] = 33;
+             }
+             Ledger restored(10);
+             Durable<Ledger> durable(restored, scratch.log);
+             return restored[3] == 33 && restored[4] == 40 && durable[4] == 40;
+         });
+
+    test("A torn record at the end of the log is cut off.",
+         []()
+         {
+             Scratch scratch;
+             size_t size;
+             {
+                 Ledger ledger(10);
+                 Durable<Ledger> durable(ledger, scratch.log);
+                 durable[1] = 10;
+                 size = durable.log_size();
+             }
+             int fd = open(scratch.log.c_str(), O_WRONLY | O_APPEND);
+             char const garbage[] = "torn record";
+             bool appended = write(fd, garbage, sizeof garbage) == sizeof garbage;
+             close(fd);
+
+             Ledger restored(10);
+             Durable<Ledger> durable(restored, scratch.log);
+             size_t replayed = durable.log_size();
+             durable[2] = 20;
+             return appended
+                 && replayed == size
+                 && restored[1] == 10
+                 && restored[2] == 20;
+         });
+
+    test("Concurrent acknowledged writes share syncs.",
+         []()
+         {
+             enum { Threads = 8, Writes = 100 };
+             Scratch scratch;
+             size_t syncs;
+             {
+                 Ledger ledger(Threads * Writes);
+                 Durable<Ledger> durable(ledger, scratch.log);
+                 vector<thread> writers;
+                 for (size_t id = 0; id != Threads; ++id)
+                     writers.emplace_back(
+                         [&, id]()
+                         {
+                             for (size_t ix = 0; ix != Writes; ++ix)
+                                 durable[id * Writes + ix] = long(ix + 1);
+                         });
+                 for (thread &writer: writers)
+                     writer.join();
+                 syncs = durable.syncs();
+             }
+             Ledger restored(Threads * Writes);
+             Durable<Ledger> durable(restored, scratch.log);
+             for (size_t key = 0; key != Threads * Writes; ++key)
+                 if (restored[key] != long(key % Writes + 1))
+                     return false;
+             return syncs < Threads * Writes;
+         });
+
+    test("Fire and forget writes are durable after wait_durable.",
+         []()
+         {
+             Scratch scratch;
+             Ledger ledger(100);
+             Durable<Ledger> durable(ledger, scratch.log, Durable<Ledger>::FireAndForget);
+             for (size_t key = 0; key != 100; ++key)
+                 durable[key] = long(key);
+             durable.wait_durable();
+             return durable.log_size() == sizeof(WalHeader) + 100 * (sizeof(size_t) + sizeof(long) + 4)
+                 && durable.syncs() <= 100;
+         });
+
+    test("A checkpoint empties the log, and restarts load it.",
+         []()
+         {
+             Scratch scratch;
+             {
+                 Ledger ledger(10);
+                 Durable<Ledger> durable(ledger, scratch.log);
+                 durable[1] = 11;
+                 durable.checkpoint();
+                 if (durable.log_size() != sizeof(WalHeader))
+                     return false;
+                 durable[2] = 22;
+             }
+             Ledger restored(10);
+             Durable<Ledger> durable(restored, scratch.log);
+             return restored[1] == 11 && restored[2] == 22;
+         });
+
+    test("A failed checkpoint fails later ones and writes, without a busy flusher.",
+         []()
+         {
+             Scratch scratch;
+             Ledger ledger(10);
+             Durable<Ledger> durable(ledger, scratch.log);
+             durable[1] = 11;
+             unlink(scratch.log.c_str());       // The checkpoint can't be written
+             rmdir(scratch.directory.c_str());  // in a removed directory.
+
+             int failures = 0;
+             for (int attempt = 0; attempt != 2; ++attempt)
+                 try
+                 {
+                     durable.checkpoint();
+                 }
+                 catch (system_error const &)
+                 {
+                     ++failures;
+                 }
+             clock_t const before = clock();
+             this_thread::sleep_for(chrono::milliseconds(200));
+             clock_t const spent = clock() - before; // CPU time, of the flusher too.
+
+             bool writefailed = false;
+             try
+             {
+                 durable[2] = 22;
+             }
+             catch (system_error const &)
+             {
+                 writefailed = true;
+             }
+             return failures == 2
+                 && writefailed
+                 && spent < CLOCKS_PER_SEC / 20;
+         });
+
+    test("A write that threw is not visible, nor are later ones.",
+         []()
+         {
+             Scratch scratch;
+             Ledger ledger(10);
+             Durable<Ledger> durable(ledger, scratch.log);
+             durable[1] = 11;
+             if (not break_descriptor_of(scratch.log))
+                 return false;
+
+             int failures = 0;
+             for (long value: {22, 33})
+                 try
+                 {
+                     durable[2] = value;
+                 }
+                 catch (system_error const &)
+                 {
+                     ++failures;
+                 }
+             return failures == 2
+                 && durable[2] == 0
+                 && ledger[2] == 0
+                 && durable[1] == 11;
+         });
+
+    test("Writes during checkpoints survive a restart.",
+         []()
+         {
+             enum { Keys = 2000 };
+             Scratch scratch;
+             {
+                 Ledger ledger(Keys);
+                 Durable<Ledger> durable(ledger, scratch.log, Durable<Ledger>::FireAndForget, 4096);
+                 thread checkpointing(
+                     [&]()
+                     {
+                         for (int count = 0; count != 20; ++count)
+                             durable.checkpoint();
+                     });
+                 for (size_t key = 0; key != Keys; ++key)
+                     durable[key] = long(key) + 1;
+                 checkpointing.join();
+             }
+             Ledger restored(Keys);
+             Durable<Ledger> durable(restored, scratch.log);
+             for (size_t key = 0; key != Keys; ++key)
+                 if (restored[key] != long(key) + 1)
+                     return false;
+             return true;
+         });
+
+    test("A checkpoint interrupted after starting a new log is completed on restart.",
+         []()
+         {
+             Scratch scratch;
+             {
+                 Ledger ledger(10);
+                 Durable<Ledger> durable(ledger, scratch.log);
+                 durable[1] = 11;
+                 durable[2] = 22;
+             }
+             // As if a crash came right after rotating the log.
+             rename(scratch.log.c_str(), (scratch.log + ".old").c_str());
+             {
+                 Ledger ledger(10);
+                 Durable<Ledger> durable(ledger, scratch.log);
+                 durable[2] = 20;
+             }
+             Ledger restored(10);
+             Durable<Ledger> durable(restored, scratch.log);
+             return restored[1] == 11
+                 && restored[2] == 20
+                 && access((scratch.log + ".old").c_str(), F_OK) != 0;
+         });
+
+    return TestCount::result();
+}
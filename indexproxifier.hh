@@ -16,6 +16,7 @@
 
 #include "keytypechoosers/prefervaluepreferconst.hh" // Keytype choice policy.
 #include "keytypechoosers/byvalue.hh" // Alternative policy (example).
+#include "constantkey/constantkey.hh" // ip::key<Value>.
 
 
 /**
@@ -46,6 +47,11 @@ private:
     template <typename K, typename Owner>
     class LRProxy;
 
+    // std::type_identity of what Owner's proxy_return_action returns for a K,
+    // or of void if there is none (e.g. for owners with only async actions).
+    template <typename K, typename Owner>
+    static constexpr auto return_type_identity();
+
     friend class IndexProxifier_unittest;
     friend class LRProxy_unittest;
     
@@ -89,6 +95,9 @@ protected:
 // The nested LRProxy class template.
 #include "lrproxy/lrproxy.hh"
 
+// Random access iterator over an owner's LRProxies. E.g. for std::sort.
+#include "proxyiterator/proxyiterator.hh"
+
 // The index operator function templates. All differ in four congruent spots.
 
 template <typename Derived, template <typename, typename> typename KeyTypeChooser>
@@ -96,7 +105,7 @@ template <typename K>
 constexpr typename IndexProxifier<Derived, KeyTypeChooser>:: template LRProxy<K, Derived &> // 1: Derived&
 IndexProxifier<Derived, KeyTypeChooser>::operator[](K &&key) & // 2: '&' ref-qualifier
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Normal reference, operator[] -> LRProxy<K, Derived&>.\n";
@@ -112,7 +121,7 @@ template <typename K>
 constexpr typename IndexProxifier<Derived, KeyTypeChooser>:: template LRProxy<K, Derived const &>
 IndexProxifier<Derived, KeyTypeChooser>::operator[](K &&key) const &
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Const reference, operator[] -> LRProxy<K, Derived const &>.\n";
@@ -128,7 +137,7 @@ template <typename K>
 constexpr typename IndexProxifier<Derived, KeyTypeChooser>:: template LRProxy<K, Derived volatile &>
 IndexProxifier<Derived, KeyTypeChooser>::operator[](K &&key) volatile &
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Volatile reference, operator[] -> LRProxy<K, Derived volatile &>.\n";
@@ -144,7 +153,7 @@ template <typename K>
 constexpr typename IndexProxifier<Derived, KeyTypeChooser>:: template LRProxy<K, Derived const volatile &>
 IndexProxifier<Derived, KeyTypeChooser>::operator[](K &&key) const volatile &
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Const volatile reference, operator[] -> LRProxy<K, Derived const volatile&>.\n";
@@ -161,7 +170,7 @@ template <typename K>
 constexpr typename IndexProxifier<Derived, KeyTypeChooser>:: template LRProxy<K, Derived &&>
 IndexProxifier<Derived, KeyTypeChooser>::operator[](K &&key) &&
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Rvalue reference, operator[] -> LRProxy<K, Derived &&>.\n";
@@ -177,7 +186,7 @@ template <typename K>
 constexpr typename IndexProxifier<Derived, KeyTypeChooser>:: template LRProxy<K, Derived const &&>
 IndexProxifier<Derived, KeyTypeChooser>::operator[](K &&key) const &&
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Const rvalue reference, operator[] -> LRProxy<K, Derived const &&> (which is silly).\n";
@@ -193,7 +202,7 @@ template <typename K>
 constexpr typename IndexProxifier<Derived, KeyTypeChooser>:: template LRProxy<K, Derived volatile &&>
 IndexProxifier<Derived, KeyTypeChooser>::operator[](K &&key) volatile &&
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Volatile rvalue reference, operator[] -> LRProxy<K, Derived volatile &&>.\n";
@@ -209,7 +218,7 @@ template <typename K>
 constexpr typename IndexProxifier<Derived, KeyTypeChooser>:: template LRProxy<K, Derived const volatile &&>
 IndexProxifier<Derived, KeyTypeChooser>::operator[](K &&key) const volatile &&
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Const volatile rvalue reference, operator[] -> LRProxy<K, Derived const volatile&&>.\n";
@@ -11,25 +11,61 @@
 #include "../../ostreamable/ostreamable.hh"
 #include "../../istreamable/istreamable.hh"
 #include "../../proper_forward/proper_forward.hh"
+#include <charconv>
+#include <compare>
+#include <concepts>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <utility>
 #include <type_traits>
 
 
+// ifdebug<DEBUG_INDEXPROXIFIER>::run(report), except during constant
+// evaluation: then there is no std::cout, and ifdebug::run needn't be constexpr.
+template <typename Report>
+constexpr void indexproxifier_debug(Report &&report)
+{
+    if (not std::is_constant_evaluated())
+        ifdebug<DEBUG_INDEXPROXIFIER>::run(std::forward<Report>(report));
+}
+
 #define template_IndexProxifier_LRProxy_boilerplate \
     template <typename Derived, template <typename, typename> typename KeyTypeChooser> \
     template <typename K, typename Owner>
 
+struct LRProxyAccess;
+
+// Owner's operator[] takes a Key and returns an LRProxy, whatever the
+// element type (IsLRProxy also requires it to be streamable).
+template <typename Owner, typename Key>
+concept ProxyIndexed = requires(Owner &&owner, Key key)
+{
+    typename decltype(std::forward<Owner>(owner)[key])::Owner_T;
+};
+
 template <typename Proxy>
 concept IsLRProxy = requires(Proxy proxy)
 {
-    Proxy::Owner_T;
-    Proxy::indexproxifier_conversion_type;
+    typename Proxy::Owner_T;
+    typename Proxy::indexproxifier_conversion_type;
     std::move(proxy).operator typename Proxy::indexproxifier_conversion_type();
     std::cout << proxy;
-    std::cin >> proxy;
+    std::cin >> std::move(proxy);
 };
 
+template <typename Derived, template <typename, typename> typename KeyTypeChooser>
+template <typename K, typename Owner>
+constexpr auto IndexProxifier<Derived, KeyTypeChooser>::return_type_identity()
+{
+    if constexpr (requires(Owner &&owner) { std::forward<Owner>(owner).template proxy_return_action<constant_key<K>::value>(); })
+                     return std::type_identity<typename proper_forward<decltype(std::declval<Owner>().template proxy_return_action<constant_key<K>::value>())>::type>{};
+    else if constexpr (requires(Owner &&owner, K &key) { std::forward<Owner>(owner).proxy_return_action(key); })
+                     return std::type_identity<typename proper_forward<decltype(std::declval<Owner>().proxy_return_action(std::declval<K &>()))>::type>{};
+    else
+        return std::type_identity<void>{};
+}
+
 /**
    This nested class LRProxy is the actual proxy, introduced by the IndexProxifier.
    It has
@@ -47,7 +83,7 @@ concept IsLRProxy = requires(Proxy proxy)
    Test: What if there are multiple proxy_return_action()s? 
 
    FixMe:
-   overload operators like <=>, +, *=, -> etc.
+   overload operators like +, *= etc.
 
 */
 template_IndexProxifier_LRProxy_boilerplate
@@ -75,21 +111,67 @@ public: // types
     typedef Owner Owner_T; // Solely for debug/test.
 
     // constexpr operator auto() const; // Not all compilers accept this. Hence next line.
-    typedef typename proper_forward<decltype(std::forward<Owner>(d_owner).proxy_return_action(d_key))>::type indexproxifier_conversion_type;
+    typedef typename decltype(return_type_identity<K, Owner>())::type indexproxifier_conversion_type;
+
+    // Returned by operator-> if the element must be materialised. See below.
+    class Pin;
 
 public: //member functions
 
     // All public members are rvalue-ref-qualified to discourage named proxies.
     // Although decltype(auto), they don't return rvalue references.
     
-    constexpr operator indexproxifier_conversion_type() &&; // Anonymous temporary objects can also be converted.
+    constexpr operator indexproxifier_conversion_type() && // Anonymous temporary objects can also be converted.
+        requires (not std::is_void<indexproxifier_conversion_type>::value);
 
     // Using convert_or_pass_on, one assignment template handles all cases.
     template <typename T>
     constexpr decltype(auto) operator=(T &&whatever) &&;
+
+    // Assignment to a const rvalue proxy still writes through to the owner,
+    // like assignment through a const pointer would. Proxy iterators need this
+    // (std::indirectly_writable). Owner's constness is unaffected.
+    template <typename T>
+    constexpr decltype(auto) operator=(T &&whatever) const &&;
     
+    // Uses Derived::proxy_add_action(key, value) if available, else reads,
+    // adds and passes the sum on to proxy_accept_action.
     template <typename T>
     constexpr decltype(auto) operator+=(T &&whatever) &&;
+
+    // Member access to the element, as in mc[k]->field. Returns, in order of
+    // preference:
+    // - whatever Derived::proxy_access_action(key) returns (a pointer, or
+    //   an accessor object with its own operator->),
+    // - a pointer to the element if proxy_return_action returns a reference,
+    // - a Pin holding the element's value until the end of the full
+    //   expression, which then hands it to Derived::proxy_commit_action(key,
+    //   value) if that exists and the value was modified. Without it, the
+    //   Pin is read-only.
+    constexpr decltype(auto) operator->() &&;
+
+    // co_await mc[k] awaits what Derived::proxy_return_async(key) returns,
+    // which must be an awaiter (e.g. a Task, see async/task.hh).
+    // Likewise, mc[k] = value returns what proxy_accept_async(key, value)
+    // returns if Derived has no proxy_accept_action, so it can be co_awaited.
+    constexpr decltype(auto) operator co_await() &&
+        requires requires(Owner &&owner, K &key) { std::forward<Owner>(owner).proxy_return_async(key); };
+
+    // Hint that the element will be accessed soon: calls
+    // Derived::proxy_prefetch_action(key) if that exists, and does nothing
+    // otherwise. Must not change the element. See prefetch/prefetch.hh.
+    constexpr void prefetch() &&;
+
+    // Swapping two proxies swaps the proxied elements, not the proxies.
+    // A hidden friend, so only ADL finds it: unqualified swap(mc[a], mc[b])
+    // and std::ranges::swap do, qualified std::swap never does. Algorithms
+    // reach it through ProxyIterator's iter_swap (and, in libstdc++, through
+    // std::iter_swap, which swaps unqualified).
+    template <typename K2, typename Owner2>
+    friend constexpr void swap(LRProxy &&lhs, LRProxy<K2, Owner2> &&rhs)
+    {
+        swap_elements(lhs, rhs);
+    }
     
 private:
 
@@ -105,17 +187,265 @@ private:
     template <typename T>
     static constexpr decltype(auto) convert_or_pass_on(T &&arg);
 
+    static constexpr bool chars_convertible =
+        std::is_same<bool, typename std::remove_cvref<indexproxifier_conversion_type>::type>::value
+        || requires(typename std::remove_cvref<indexproxifier_conversion_type>::type value, char *ptr)
+           {
+               std::to_chars(ptr, ptr, value);
+               std::from_chars(ptr, ptr, value);
+           };
+
+    std::to_chars_result write_chars(char *first, char *last) const;
+    std::from_chars_result read_chars(char const *first, char const *last) const;
+
+    // Locale-free text conversion without stream sentries, by ADL like
+    // std::to_chars/std::from_chars. Bools are written and read as 0 and 1.
+    // from_chars passes the value on to proxy_accept_action only if parsing
+    // succeeds, like operator>>.
+    friend std::to_chars_result to_chars(char *first, char *last, LRProxy &&proxy)
+        requires chars_convertible
+    {
+        return proxy.write_chars(first, last);
+    }
+
+    friend std::from_chars_result from_chars(char const *first, char const *last, LRProxy &&proxy)
+        requires chars_convertible
+    {
+        return proxy.read_chars(first, last);
+    }
+
+    // Other LRProxies are compared by their conversion value, anything else as is.
+    template <typename T>
+    static constexpr decltype(auto) compare_operand(T const &arg);
+
+    template <typename T>
+    using compare_operand_t = decltype(compare_operand(std::declval<T const &>()));
+
+    template <typename T>
+    static constexpr bool has_compare_action = requires(LRProxy const &proxy, T const &other)
+    {
+        std::forward<Owner>(proxy.d_owner).proxy_compare_action(proxy.d_key, compare_operand(other));
+    };
+
+    template <typename T>
+    constexpr bool equals(T const &other) const;
+
+    template <typename T>
+    constexpr auto compare(T const &other) const;
+
+    // Comparisons use Derived::proxy_compare_action(key, other) if it exists,
+    // otherwise they compare whatever proxy_return_action returns (so a
+    // returned reference is compared in place, not copied).
+    // Other LRProxies are compared by their conversion values.
+    // <, <=, > and >= are rewritten in terms of <=>.
+    template <typename T>
+        requires (has_compare_action<T> || requires(indexproxifier_conversion_type value, compare_operand_t<T> other) { value == other; })
+    friend constexpr bool operator==(LRProxy const &lhs, T const &rhs)
+    {
+        return lhs.equals(rhs);
+    }
+
+    template <typename T>
+        requires (has_compare_action<T> || requires(indexproxifier_conversion_type value, compare_operand_t<T> other) { value <=> other; })
+    friend constexpr auto operator<=>(LRProxy const &lhs, T const &rhs)
+    {
+        return lhs.compare(rhs);
+    }
+
+    // Bulk binary I/O (see bulkio/bulkio.hh) uses Derived's optional
+    // proxy_serialize_range(first, last, sink) and
+    // proxy_deserialize_range(first, last, source), with d_key as first.
+    template <typename Sink>
+    static constexpr bool has_serialize_range_action = requires(LRProxy const &proxy, Sink &sink)
+    {
+        std::forward<Owner>(proxy.d_owner).proxy_serialize_range(proxy.d_key, proxy.d_key, sink);
+    };
+
+    template <typename Source>
+    static constexpr bool has_deserialize_range_action = requires(LRProxy const &proxy, Source &source)
+    {
+        std::forward<Owner>(proxy.d_owner).proxy_deserialize_range(proxy.d_key, proxy.d_key, source);
+    };
+
+    template <typename Sink>
+    bool run_serialize_range_action(typename std::remove_reference<K>::type const &last, Sink &sink) const;
+
+    template <typename Source>
+    bool run_deserialize_range_action(typename std::remove_reference<K>::type const &last, Source &source) const;
+
+    // Batched writes (see ip::accept_batch in accumulate/shardedaccumulator.hh)
+    // use Derived's optional proxy_accept_batch(updates), updates being a
+    // range of (key, value) pairs.
+    template <typename Updates>
+    static constexpr bool has_accept_batch_action = requires(LRProxy const &proxy, Updates const &updates)
+    {
+        std::forward<Owner>(proxy.d_owner).proxy_accept_batch(updates);
+    };
+
+    template <typename Updates>
+    void run_accept_batch_action(Updates const &updates) const;
+
+    template <auto Field>
+    static constexpr bool has_field_action = requires(LRProxy const &proxy)
+    {
+        std::forward<Owner>(proxy.d_owner).template proxy_field_action<Field>(proxy.d_key);
+    };
+
+    template <auto Field>
+    constexpr decltype(auto) run_field_action() const;
+
+    // get<Field>(mc[k]) returns what Derived::proxy_field_action<Field>(key)
+    // returns: typically a reference to one field of a composite element,
+    // e.g. in a column of a struct-of-arrays (see soa/soa.hh). Found by ADL.
+    // Declared here, as its constraint needs has_field_action.
+    template <auto Field>
+    friend constexpr decltype(auto) get(LRProxy &&proxy)
+        requires has_field_action<Field>
+    {
+        return proxy.template run_field_action<Field>();
+    }
+
+    template <typename Value>
+    static constexpr bool has_commit_action = requires(LRProxy const &proxy, Value &value)
+    {
+        std::forward<Owner>(proxy.d_owner).proxy_commit_action(proxy.d_key, value);
+    };
+
+    // Common body of the operator= overloads.
+    template <typename T>
+    constexpr decltype(auto) assign(T &&whatever) const;
+
+    // Uses Derived::proxy_transfer_action(key, source_owner, source_key) if
+    // whatever is an LRProxy that Derived can transfer from directly.
+    // Otherwise converts whatever and passes it on to proxy_accept_action.
+    template <typename T>
+    constexpr decltype(auto) run_transfer_or_accept_action(T &&whatever) const;
+
+    // Uses Derived::proxy_swap_action(key1, key2) if available and both
+    // proxies refer to the same owner. Otherwise swaps through a temporary.
+    template <typename K2, typename Owner2>
+    static constexpr void swap_elements(LRProxy const &lhs, LRProxy<K2, Owner2> const &rhs);
+
     constexpr std::ostream &write(std::ostream &os) const; // Forced const by operator<<.
     constexpr std::istream &read(std::istream &os) &&;
 
+    template <typename, template <typename, typename> typename>
+    friend class IndexProxifier; // Its LRProxies too, e.g. for swap and transfer.
     friend class LRProxy_unittest; // For testing purposes.
     friend class IndexProxifier_unittest; // For testing.
     friend IndexProxifier<Derived, KeyTypeChooser>; // Could be tighter.
     friend std::ostream &operator<< <>(std::ostream &, Ostreamable<IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>> const &);
     friend std::istream &operator>> <>(std::istream &, Istreamable<IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>> &&);
-    
+    friend struct LRProxyAccess; // For add-ons running the hooks above.
+};
+
+
+/**
+   A Pin holds the value of one element, so its members can be accessed
+   through operator->. It lives until the end of the full expression that
+   created it. If Derived has a proxy_commit_action(key, value), the Pin's
+   destructor passes the value to it if it was modified, so mc[k]->x reads
+   don't write back. To tell, the Pin keeps a second copy of the value, and
+   compares the bytes of trivially copyable values, or else uses ==. Values
+   it cannot copy or compare are committed regardless.
+*/
+template_IndexProxifier_LRProxy_boilerplate
+class IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::Pin
+{
+    typedef typename std::remove_cvref<indexproxifier_conversion_type>::type value_type;
+
+    static constexpr bool snapshots = has_commit_action<value_type>
+        && std::is_copy_constructible<value_type>::value
+        && (std::is_trivially_copyable<value_type>::value || std::equality_comparable<value_type>);
+
+    struct NoSnapshot
+    {};
+
+    LRProxy const &d_proxy; // Outlives us: both are temporaries of the same full expression.
+    value_type d_value;
+    [[no_unique_address]] std::conditional_t<snapshots, value_type, NoSnapshot> d_original;
+
+    explicit constexpr Pin(LRProxy const &proxy);
+
+    static constexpr auto snapshot(value_type const &value);
+    constexpr bool modified() const;
+
+    constexpr Pin(Pin const &other) = delete;
+    constexpr Pin(Pin &&tmp) = delete;
+
+    friend LRProxy;
+
+public:
+
+    constexpr ~Pin();
+
+    // Without a proxy_commit_action, modifications would be lost. Hence const.
+    constexpr auto operator->() &&;
 };
 
+template_IndexProxifier_LRProxy_boilerplate
+constexpr IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::Pin::Pin(LRProxy const &proxy)
+    : d_proxy(proxy),
+      d_value(proxy.indexproxifier_conversion_value()),
+      d_original(snapshot(d_value))
+{
+    // Padding too, so that memcmp only sees modifications.
+    if constexpr (snapshots && std::is_trivially_copyable<value_type>::value)
+        if (not std::is_constant_evaluated())
+            std::memcpy(static_cast<void *>(std::addressof(d_original)), std::addressof(d_value), sizeof(value_type));
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+constexpr auto IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::Pin::snapshot(value_type const &value)
+{
+    if constexpr (snapshots)
+        return value;
+    else
+        return NoSnapshot{};
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+constexpr bool IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::Pin::modified() const
+{
+    if constexpr (not snapshots)
+        return true;
+    else if constexpr (std::is_trivially_copyable<value_type>::value)
+    {
+        if (not std::is_constant_evaluated())
+            return std::memcmp(std::addressof(d_value), std::addressof(d_original), sizeof(value_type)) != 0;
+        if constexpr (std::equality_comparable<value_type>)
+            return not (d_value == d_original);
+        else
+            return true;
+    }
+    else
+        return not (d_value == d_original);
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+constexpr IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::Pin::~Pin()
+{
+    if constexpr (has_commit_action<value_type>)
+    {
+        if (not modified())
+            return;
+        indexproxifier_debug(
+            []()
+            {
+                std::cout << "Committing pinned value of LRProxy.\n";
+            });
+        std::forward<Owner>(d_proxy.d_owner).proxy_commit_action(d_proxy.d_key, d_value);
+    }
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+constexpr auto IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::Pin::operator->() &&
+{
+    if constexpr (has_commit_action<value_type>)
+                     return std::addressof(d_value);
+    else
+        return std::addressof(std::as_const(d_value));
+}
 
 template_IndexProxifier_LRProxy_boilerplate
 constexpr IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::LRProxy(Owner &&owner, K &&key)
@@ -127,7 +457,7 @@ constexpr IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::LRProxy(Ow
         std::is_base_of<IndexProxifier<Derived, KeyTypeChooser>, Derived>::value,
         "Trying to construct LRProxy, but IndexProxifier is not a base of Derived."
         );
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Constructing IndexProxifier from rvalue reference to Owner.\n";
@@ -137,8 +467,9 @@ constexpr IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::LRProxy(Ow
 // operator indexproxifier_conversion_type
 template_IndexProxifier_LRProxy_boilerplate
 constexpr IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::operator indexproxifier_conversion_type() &&
+    requires (not std::is_void<indexproxifier_conversion_type>::value)
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Conversion of rvalue-reference-to-LRProxy to indexproxifier_conversion_type.\n";
@@ -146,16 +477,54 @@ constexpr IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::operator i
     return indexproxifier_conversion_value();
 }
 
+template_IndexProxifier_LRProxy_boilerplate
+constexpr decltype(auto) IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::operator->() &&
+{
+    indexproxifier_debug(
+        []()
+        {
+            std::cout << "Member access through rvalue LRProxy.\n";
+        });
+    if constexpr (requires { std::forward<Owner>(d_owner).proxy_access_action(d_key); })
+                     return std::forward<Owner>(d_owner).proxy_access_action(d_key);
+    else if constexpr (std::is_lvalue_reference<indexproxifier_conversion_type>::value)
+        return std::addressof(indexproxifier_conversion_value());
+    else
+        return Pin(*this);
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+constexpr decltype(auto) IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::operator co_await() &&
+    requires requires(Owner &&owner, K &key) { std::forward<Owner>(owner).proxy_return_async(key); }
+{
+    indexproxifier_debug(
+        []()
+        {
+            std::cout << "co_await on rvalue LRProxy.\n";
+        });
+    return std::forward<Owner>(d_owner).proxy_return_async(d_key);
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+constexpr void IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::prefetch() &&
+{
+    if constexpr (requires { std::forward<Owner>(d_owner).proxy_prefetch_action(d_key); })
+                     std::forward<Owner>(d_owner).proxy_prefetch_action(d_key);
+}
+
 template_IndexProxifier_LRProxy_boilerplate
 constexpr typename IndexProxifier<Derived, KeyTypeChooser>::template LRProxy<K, Owner>::indexproxifier_conversion_type
 IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::indexproxifier_conversion_value() const
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Returning value of rvalue-reference-to-LRProxy.\n";
         });
-    return std::forward<Owner>(d_owner).proxy_return_action(d_key);
+    if constexpr (requires { std::forward<Owner>(d_owner).template proxy_return_action<constant_key<K>::value>(); })
+                     return std::forward<Owner>(d_owner).template proxy_return_action<constant_key<K>::value>();
+    else
+        return std::forward<Owner>(d_owner).proxy_return_action(d_key);
 }
 
 template_IndexProxifier_LRProxy_boilerplate
@@ -163,7 +532,13 @@ template <typename T>
 constexpr decltype(auto)
 IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::run_accept_action(T &&value) const
 {
-    return std::forward<Owner>(d_owner).proxy_accept_action(d_key, std::forward<T>(value));
+    if constexpr (requires { std::forward<Owner>(d_owner).template proxy_accept_action<constant_key<K>::value>(std::forward<T>(value)); })
+                     return std::forward<Owner>(d_owner).template proxy_accept_action<constant_key<K>::value>(std::forward<T>(value));
+    else if constexpr (requires { std::forward<Owner>(d_owner).proxy_accept_async(d_key, std::forward<T>(value)); }
+                       && not requires { std::forward<Owner>(d_owner).proxy_accept_action(d_key, std::forward<T>(value)); })
+                          return std::forward<Owner>(d_owner).proxy_accept_async(d_key, std::forward<T>(value));
+    else
+        return std::forward<Owner>(d_owner).proxy_accept_action(d_key, std::forward<T>(value));
 }
 
 template_IndexProxifier_LRProxy_boilerplate
@@ -178,7 +553,7 @@ constexpr decltype(auto)
 IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::convert_or_pass_on(T &&arg)
 {
     if constexpr (IsLRProxy<typename std::remove_reference<T>::type>)
-                     std::forward<T>(arg).indexproxifier_conversion_value();
+                     return std::forward<T>(arg).indexproxifier_conversion_value();
     else
         return std::forward<T>(arg);
     // FixMe?: Passing rvalue references through this function ensures that
@@ -186,27 +561,188 @@ IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::convert_or_pass_on(T
     // and relying on copy elision and/or return value optimization.
 }
 
+template_IndexProxifier_LRProxy_boilerplate
+template <typename T>
+constexpr decltype(auto)
+IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::compare_operand(T const &arg)
+{
+    if constexpr (IsLRProxy<T>)
+                     return arg.indexproxifier_conversion_value();
+    else
+        return arg;
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+template <typename T>
+constexpr bool
+IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::equals(T const &other) const
+{
+    indexproxifier_debug(
+        []()
+        {
+            std::cout << "Comparing LRProxy for equality.\n";
+        });
+    if constexpr (has_compare_action<T>)
+                     return std::forward<Owner>(d_owner).proxy_compare_action(d_key, compare_operand(other)) == 0;
+    else
+        return indexproxifier_conversion_value() == compare_operand(other);
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+template <typename T>
+constexpr auto
+IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::compare(T const &other) const
+{
+    indexproxifier_debug(
+        []()
+        {
+            std::cout << "Three-way comparison of LRProxy.\n";
+        });
+    if constexpr (has_compare_action<T>)
+                     return std::forward<Owner>(d_owner).proxy_compare_action(d_key, compare_operand(other));
+    else
+        return indexproxifier_conversion_value() <=> compare_operand(other);
+}
+
 template_IndexProxifier_LRProxy_boilerplate
 template <typename T>
 constexpr decltype(auto)
 IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::operator=(T &&whatever) &&
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Assignment to rvalue LRProxy.\n";
         });
-    if constexpr (std::is_same<void, decltype(run_accept_action(convert_or_pass_on(std::forward<T>(whatever))))>::value)
-                     return;
+    return assign(std::forward<T>(whatever));
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+template <typename T>
+constexpr decltype(auto)
+IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::operator=(T &&whatever) const &&
+{
+    indexproxifier_debug(
+        []()
+        {
+            std::cout << "Assignment to const rvalue LRProxy.\n";
+        });
+    return assign(std::forward<T>(whatever));
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+template <typename T>
+constexpr decltype(auto)
+IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::assign(T &&whatever) const
+{
+    if constexpr (std::is_same<void, decltype(run_transfer_or_accept_action(std::forward<T>(whatever)))>::value)
+                     run_transfer_or_accept_action(std::forward<T>(whatever));
+    else
+        return forward_properly(run_transfer_or_accept_action(std::forward<T>(whatever)));
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+template <typename T>
+constexpr decltype(auto)
+IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::run_transfer_or_accept_action(T &&whatever) const
+{
+    typedef typename std::remove_cvref<T>::type Source;
+    if constexpr (IsLRProxy<Source>)
+    {
+        typedef typename Source::Owner_T SourceOwner;
+        if constexpr (requires { std::forward<Owner>(d_owner).proxy_transfer_action(d_key, std::forward<SourceOwner>(whatever.d_owner), whatever.d_key); })
+        {
+            indexproxifier_debug(
+                []()
+                {
+                    std::cout << "Direct transfer from LRProxy to LRProxy.\n";
+                });
+            return std::forward<Owner>(d_owner).proxy_transfer_action(d_key, std::forward<SourceOwner>(whatever.d_owner), whatever.d_key);
+        }
+        else
+            return run_accept_action(convert_or_pass_on(std::forward<T>(whatever)));
+    }
     else
-        return forward_properly(run_accept_action(convert_or_pass_on(std::forward<T>(whatever))));
+        return run_accept_action(convert_or_pass_on(std::forward<T>(whatever)));
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+template <typename Sink>
+bool IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::run_serialize_range_action(typename std::remove_reference<K>::type const &last, Sink &sink) const
+{
+    indexproxifier_debug(
+        []()
+        {
+            std::cout << "Serializing range starting at LRProxy.\n";
+        });
+    return static_cast<bool>(std::forward<Owner>(d_owner).proxy_serialize_range(d_key, last, sink));
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+template <typename Source>
+bool IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::run_deserialize_range_action(typename std::remove_reference<K>::type const &last, Source &source) const
+{
+    indexproxifier_debug(
+        []()
+        {
+            std::cout << "Deserializing range starting at LRProxy.\n";
+        });
+    return static_cast<bool>(std::forward<Owner>(d_owner).proxy_deserialize_range(d_key, last, source));
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+template <auto Field>
+constexpr decltype(auto) IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::run_field_action() const
+{
+    indexproxifier_debug(
+        []()
+        {
+            std::cout << "Field access through LRProxy.\n";
+        });
+    return std::forward<Owner>(d_owner).template proxy_field_action<Field>(d_key);
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+template <typename Updates>
+void IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::run_accept_batch_action(Updates const &updates) const
+{
+    indexproxifier_debug(
+        []()
+        {
+            std::cout << "Accepting batch through LRProxy.\n";
+        });
+    std::forward<Owner>(d_owner).proxy_accept_batch(updates);
 }
 
+template_IndexProxifier_LRProxy_boilerplate
+template <typename K2, typename Owner2>
+constexpr void
+IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::swap_elements(LRProxy const &lhs, LRProxy<K2, Owner2> const &rhs)
+{
+    indexproxifier_debug(
+        []()
+        {
+            std::cout << "Swapping the elements referred to by two LRProxies.\n";
+        });
+    if constexpr (requires { std::forward<Owner>(lhs.d_owner).proxy_swap_action(lhs.d_key, rhs.d_key); })
+    {
+        // The proxies may refer to two distinct objects of the same type.
+        if (std::addressof(lhs.d_owner) == std::addressof(rhs.d_owner))
+        {
+            std::forward<Owner>(lhs.d_owner).proxy_swap_action(lhs.d_key, rhs.d_key);
+            return;
+        }
+    }
+    // Lvalue, because proxy_accept_action may take its value by reference.
+    std::remove_cvref_t<indexproxifier_conversion_type> value(lhs.indexproxifier_conversion_value());
+    lhs.run_accept_action(rhs.indexproxifier_conversion_value());
+    rhs.run_accept_action(value);
+}
 
 template_IndexProxifier_LRProxy_boilerplate
 constexpr std::ostream &IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::write(std::ostream &os) const
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Writing LRProxy to ostream.\n";
@@ -221,7 +757,7 @@ constexpr std::istream &IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owne
         not std::is_const<typename std::remove_reference<indexproxifier_conversion_type>::type>::value,
         "Cannot read a new value into a const type or reference."
         );
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Reading LRProxy from istream.\n";
@@ -243,20 +779,105 @@ constexpr std::istream &IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owne
     return is;
 }
 
+template_IndexProxifier_LRProxy_boilerplate
+std::to_chars_result IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::write_chars(char *first, char *last) const
+{
+    indexproxifier_debug(
+        []()
+        {
+            std::cout << "Writing LRProxy to chars.\n";
+        });
+    if constexpr (std::is_same<bool, typename std::remove_cvref<indexproxifier_conversion_type>::type>::value)
+    {
+        if (first == last)
+            return {last, std::errc::value_too_large};
+        *first = indexproxifier_conversion_value() ? '1' : '0';
+        return {first + 1, std::errc{}};
+    }
+    else
+        return std::to_chars(first, last, indexproxifier_conversion_value());
+}
+
+template_IndexProxifier_LRProxy_boilerplate
+std::from_chars_result IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::read_chars(char const *first, char const *last) const
+{
+    static_assert(
+        not std::is_const<typename std::remove_reference<indexproxifier_conversion_type>::type>::value,
+        "Cannot read a new value into a const type or reference."
+        );
+    indexproxifier_debug(
+        []()
+        {
+            std::cout << "Reading LRProxy from chars.\n";
+        });
+    typename std::remove_cvref<indexproxifier_conversion_type>::type newvalue{};
+    std::from_chars_result result;
+    if constexpr (std::is_same<bool, decltype(newvalue)>::value)
+    {
+        if (first == last || (*first != '0' && *first != '1'))
+            return {first, std::errc::invalid_argument};
+        newvalue = *first == '1';
+        result = {first + 1, std::errc{}};
+    }
+    else
+        result = std::from_chars(first, last, newvalue);
+    if (result.ec == std::errc{})
+        run_accept_action(newvalue); // Lvalue, like read() passes it on.
+    return result;
+}
+
 template_IndexProxifier_LRProxy_boilerplate
 template <typename T>
 constexpr decltype(auto)
 IndexProxifier<Derived, KeyTypeChooser>::LRProxy<K, Owner>::operator+=(T &&whatever) &&
 {
-    ifdebug<DEBUG_INDEXPROXIFIER>::run(
+    indexproxifier_debug(
         []()
         {
             std::cout << "Operator += on rvalue LRProxy.\n";
         });
-    return forward_properly(run_accept_action(indexproxifier_conversion_value() + convert_or_pass_on(std::forward<T>(whatever))));
+    if constexpr (requires { std::forward<Owner>(d_owner).proxy_add_action(d_key, convert_or_pass_on(std::forward<T>(whatever))); })
+                     return forward_properly(std::forward<Owner>(d_owner).proxy_add_action(d_key, convert_or_pass_on(std::forward<T>(whatever))));
+    else
+        return forward_properly(run_accept_action(indexproxifier_conversion_value() + convert_or_pass_on(std::forward<T>(whatever))));
 }
 
 
+/**
+   How add-ons outside the core (bulk I/O, batched writes) detect and run
+   the optional owner hooks that LRProxy keeps private. LRProxy befriends
+   only this, rather than the add-ons' functions themselves.
+*/
+struct LRProxyAccess
+{
+    template <typename Proxy, typename Sink>
+    static constexpr bool has_serialize_range_action = Proxy::template has_serialize_range_action<Sink>;
+
+    template <typename Proxy, typename Source>
+    static constexpr bool has_deserialize_range_action = Proxy::template has_deserialize_range_action<Source>;
+
+    template <typename Proxy, typename Updates>
+    static constexpr bool has_accept_batch_action = Proxy::template has_accept_batch_action<Updates>;
+
+    template <typename Proxy, typename Last, typename Sink>
+    static bool run_serialize_range_action(Proxy const &first, Last const &last, Sink &sink)
+    {
+        return first.run_serialize_range_action(last, sink);
+    }
+
+    template <typename Proxy, typename Last, typename Source>
+    static bool run_deserialize_range_action(Proxy const &first, Last const &last, Source &source)
+    {
+        return first.run_deserialize_range_action(last, source);
+    }
+
+    template <typename Proxy, typename Updates>
+    static void run_accept_batch_action(Proxy const &proxy, Updates const &updates)
+    {
+        proxy.run_accept_batch_action(updates);
+    }
+};
+
 #undef template_IndexProxifier_LRProxy_boilerplate
 
 #endif //def_h_include_lrproxy_hh
@@ -0,0 +1,141 @@
+
+#include "../../indexproxifier.hh"
+#include "../../../unittest/unittest.hh"
+#include "eightbits/eightbits.hh"
+#include "nibbles/nibbles.hh"
+#include "retbyref/retbyvalue.hh"
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Counts its copies, and compares by its value.
+struct Counted
+{
+    static inline std::size_t s_copies = 0;
+    int d_value = 0;
+
+    Counted() = default;
+    Counted(int value)
+        : d_value(value)
+    {}
+    Counted(Counted const &other)
+        : d_value(other.d_value)
+    {
+        ++s_copies;
+    }
+    Counted &operator=(Counted const &other)
+    {
+        d_value = other.d_value;
+        ++s_copies;
+        return *this;
+    }
+    friend bool operator==(Counted const &lhs, Counted const &rhs) = default;
+    friend auto operator<=>(Counted const &lhs, Counted const &rhs) = default;
+};
+
+// Computes its elements, but can compare them without doing so.
+class Blobs: protected IndexProxifier<Blobs>
+{
+    std::size_t d_computed = 0;
+
+public:
+    std::size_t computed() const;
+
+    using IndexProxifier<Blobs>::operator[];
+
+private:
+    friend IndexProxifier<Blobs>;
+
+    std::string proxy_return_action(std::size_t key);
+    std::strong_ordering proxy_compare_action(std::size_t key, std::string_view other) const;
+};
+
+inline std::size_t Blobs::computed() const
+{
+    return d_computed;
+}
+
+inline std::string Blobs::proxy_return_action(std::size_t key)
+{
+    ++d_computed;
+    return std::string(key, 'x');
+}
+
+inline std::strong_ordering Blobs::proxy_compare_action(std::size_t key, std::string_view other) const
+{
+    // Element key consists of key 'x's.
+    for (char ch: other.substr(0, key))
+        if (ch != 'x')
+            return 'x' <=> ch;
+    return key <=> other.size();
+}
+
+using namespace std;
+
+int main()
+{
+    test("Proxies compare to values and to other proxies.",
+         []()
+         {
+             Nibbles nibbles{1, 2, 2, 15};
+             return nibbles[1] == nibbles[2]
+                 && nibbles[0] != nibbles[1]
+                 && nibbles[0] < nibbles[1]
+                 && nibbles[3] >= 15u
+                 && 3u > nibbles[2]
+                 && (nibbles[3] <=> nibbles[0]) == std::strong_ordering::greater;
+         });
+
+    test("Proxies of different owner types compare by their values.",
+         []()
+         {
+             Nibbles nibbles{0, 1};
+             EightBits bits{0b10};
+             return nibbles[1] == bits[1]
+                 && bits[0] == nibbles[0]
+                 && bits[1] > nibbles[0];
+         });
+
+    test("Comparing proxies whose return action yields a reference doesn't copy.",
+         []()
+         {
+             RetByValue<Counted> counted{1, 2, 3, 1};
+             Counted::s_copies = 0;
+             Counted const three(3);
+             bool result =
+                 counted[0] == counted[3]
+                 && counted[0] < counted[1]
+                 && counted[2] == three
+                 && three >= counted[1];
+             return result && Counted::s_copies == 0;
+         });
+
+    test("Comparisons use proxy_compare_action if available.",
+         []()
+         {
+             Blobs blobs;
+             string const xx("xx");
+             bool result =
+                 blobs[2] == xx
+                 && blobs[2] == "xx"sv
+                 && blobs[1] < "xx"sv
+                 && blobs[3] > xx
+                 && blobs[2] != "xy"sv
+                 && blobs[2] == blobs[2];
+             // Only the right hand side proxy was computed.
+             return result && blobs.computed() == 1;
+         });
+
+    test("std::sort compares proxies through LRProxy's operators.",
+         []()
+         {
+             Nibbles nibbles{4, 3, 2, 1, 8, 7, 6, 5};
+             std::sort(nibbles.begin(), nibbles.end(), std::greater<>{});
+             return nibbles.internal() == 0x12345678u;
+         });
+
+    return TestCount::result();
+}
@@ -0,0 +1,133 @@
+#include "../../indexproxifier.hh"
+#include "../../../unittest/unittest.hh"
+#include "eightbits/eightbits.hh"
+#include "retbyref/retbyvalue.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+using namespace std;
+
+namespace
+{
+    // Fixed-size lookup table, as precomputed CRC or bitmask tables are.
+    template <typename T, size_t Size>
+    class Lookup: protected IndexProxifier<Lookup<T, Size>>
+    {
+        array<T, Size> d_entries{};
+
+    public:
+        constexpr Lookup() = default;
+
+        using IndexProxifier<Lookup>::operator[];
+
+    private:
+        friend IndexProxifier<Lookup>;
+
+        constexpr T proxy_return_action(size_t ix) const
+        {
+            return d_entries[ix];
+        }
+
+        constexpr T proxy_accept_action(size_t ix, T value)
+        {
+            return d_entries[ix] = value;
+        }
+    };
+
+    // Reflected CRC-32 (polynomial 0xedb88320) of the byte ix.
+    constexpr uint32_t crc32_entry(uint32_t ix)
+    {
+        for (int bit = 0; bit != 8; ++bit)
+            ix = ix & 1 ? (ix >> 1) ^ 0xedb88320u : ix >> 1;
+        return ix;
+    }
+
+    consteval Lookup<uint32_t, 256> crc32_table()
+    {
+        Lookup<uint32_t, 256> table;
+        for (size_t ix = 0; ix != 256; ++ix)
+            table[ix] = crc32_entry(ix);
+        return table;
+    }
+
+    constexpr Lookup<uint32_t, 256> crc32_lookup = crc32_table(); // Read-only data.
+
+    constexpr uint32_t crc32(string_view bytes)
+    {
+        uint32_t crc = ~0u;
+        for (unsigned char byte: bytes)
+            crc = crc32_lookup[size_t{(crc ^ byte) & 0xffu}] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    consteval EightBits every_other_bit()
+    {
+        EightBits bits;
+        for (int ix = 0; ix != 8; ix += 2)
+            bits[ix] = true;
+        return bits;
+    }
+
+    // RetByValue can't be copied out, so this returns what its proxies saw.
+    consteval int written_then_read()
+    {
+        RetByValue<int> values{1, 2, 3, 4};
+        for (size_t ix = 0; ix != 4; ++ix)
+        {
+            int value = 10 * int(ix); // Lvalue: proxy_accept_action takes a reference.
+            values[ix] = value;
+        }
+        swap(values[size_t{0}], values[size_t{3}]);
+        return values[size_t{0}] + 100 * values[size_t{1}];
+    }
+
+    consteval bool compares()
+    {
+        EightBits bits(0b100);
+        Lookup<int, 4> table;
+        table[size_t{1}] = 5;
+        table[size_t{1}] += 2;
+        return bits[2] == true
+            && bits[1] != true
+            && table[size_t{1}] > 6
+            && (table[size_t{1}] <=> 7) == 0;
+    }
+}
+
+int main()
+{
+    static_assert(every_other_bit().internal() == 0x55,
+                  "Writing through proxies should work in a consteval function.");
+    static_assert(written_then_read() == 30 + 100 * 10,
+                  "Assignment and swap through proxies should be constant expressions.");
+    static_assert(compares(),
+                  "Compound assignment and comparisons should be constant expressions.");
+    static_assert(crc32_lookup[size_t{1}] == 0x77073096u,
+                  "Reading a constexpr table through its proxies should be a constant expression.");
+    static_assert(crc32("123456789") == 0xcbf43926u,
+                  "A constexpr table should be usable in other constant expressions.");
+
+    test("A table built at compile time reads the same at run time.",
+         []()
+         {
+             for (uint32_t ix = 0; ix != 256; ++ix)
+                 if (crc32_lookup[size_t{ix}] != crc32_entry(ix))
+                     return false;
+             string_view check = "123456789";
+             return crc32(check) == 0xcbf43926u;
+         });
+
+    test("An owner built at compile time can be copied and modified at run time.",
+         []()
+         {
+             EightBits bits = every_other_bit();
+             bits[1] = true;
+             return bits.internal() == 0x57;
+         });
+
+    return TestCount::result();
+}
@@ -2,6 +2,7 @@
 #include "../../indexproxifier.hh"
 #include "../../../unittest/unittest.hh"
 #include "eightbits/eightbits.hh"
+#include "nibbles/nibbles.hh"
 #include "retbyref/retbyref.hh"
 #include "retbyref/retbyconstref.hh"
 #include "retbyref/retbyvalue.hh"
@@ -16,6 +17,7 @@ namespace {
     void ut_op_indexproxifier_conversion_type();
     void ut_no_copy_constructor();
     void ut_op_assign();
+    void ut_transfer();
     void ut_io();
 }
 
@@ -49,6 +51,7 @@ int main()
     ut_no_copy_constructor();
     ut_op_indexproxifier_conversion_type();
     ut_op_assign();
+    ut_transfer();
     ut_io();
 
     return TestCount::result();
@@ -236,6 +239,48 @@ namespace {
             });
     }
 
+    void ut_transfer()
+    {
+        static_assert(IsLRProxy<std::remove_reference<decltype(Nibbles{}[1])>::type>,
+                      "The index operator should return something that satisfies IsLRProxy.");
+
+        test("Proxy-to-proxy assignment uses proxy_transfer_action if available.",
+             []()
+             {
+                 Nibbles source{1, 2, 3, 4};
+                 Nibbles destination;
+                 destination[5] = source[2];
+                 destination[6] = destination[5];
+                 return destination.transfers() == 2
+                     && destination[5] == 3u
+                     && destination[6] == 3u
+                     && destination.internal() == 0x03300000u;
+             });
+
+        test("Transfer returns what proxy_transfer_action returns, so chaining works.",
+             []()
+             {
+                 Nibbles nibbles{9};
+                 unsigned value = nibbles[2] = nibbles[1] = nibbles[0];
+                 return value == 9u
+                     && nibbles.transfers() == 1 // Outer assignment is from unsigned.
+                     && nibbles.internal() == 0x999u;
+             });
+
+        test("Without a matching proxy_transfer_action, assignment converts first.",
+             []()
+             {
+                 Nibbles nibbles;
+                 RetByRef numbers{1, 2, 3, 4};
+                 EightBits bits;
+                 nibbles[0] = numbers[3];
+                 bits[1] = nibbles[0];
+                 return nibbles.transfers() == 0
+                     && nibbles[0] == 4u
+                     && bits.internal() == 0b10;
+             });
+    }
+
     void ut_io()
     {
 
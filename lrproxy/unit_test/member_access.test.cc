@@ -0,0 +1,166 @@
+
+#include "../../indexproxifier.hh"
+#include "../../../unittest/unittest.hh"
+#include "retbyref/retbyvalue.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+struct Point
+{
+    int x = 0;
+    int y = 0;
+};
+
+// Packs Points as pairs of int16_t. Elements are computed, so operator->
+// yields a Pin, which commits modifications through proxy_commit_action.
+class PackedPoints: protected IndexProxifier<PackedPoints>
+{
+    uint32_t d_data[4] = {};
+    std::size_t d_commits = 0;
+
+public:
+    std::size_t commits() const;
+
+    using IndexProxifier<PackedPoints>::operator[];
+
+private:
+    friend IndexProxifier<PackedPoints>;
+
+    Point proxy_return_action(std::size_t key) const;
+    Point proxy_accept_action(std::size_t key, Point const &value);
+    void proxy_commit_action(std::size_t key, Point const &value);
+};
+
+inline std::size_t PackedPoints::commits() const
+{
+    return d_commits;
+}
+
+inline Point PackedPoints::proxy_return_action(std::size_t key) const
+{
+    return Point{static_cast<int16_t>(d_data[key] & 0xffff), static_cast<int16_t>(d_data[key] >> 16)};
+}
+
+inline Point PackedPoints::proxy_accept_action(std::size_t key, Point const &value)
+{
+    d_data[key] = static_cast<uint16_t>(value.x) | static_cast<uint32_t>(static_cast<uint16_t>(value.y)) << 16;
+    return value;
+}
+
+inline void PackedPoints::proxy_commit_action(std::size_t key, Point const &value)
+{
+    proxy_accept_action(key, value);
+    ++d_commits;
+}
+
+// Hands out its own accessor: a pointer into its storage.
+class Accessible: protected IndexProxifier<Accessible>
+{
+    Point d_points[2] = {};
+
+public:
+    using IndexProxifier<Accessible>::operator[];
+
+private:
+    friend IndexProxifier<Accessible>;
+
+    Point proxy_return_action(std::size_t key) const;
+    Point *proxy_access_action(std::size_t key);
+    Point const *proxy_access_action(std::size_t key) const;
+};
+
+inline Point Accessible::proxy_return_action(std::size_t key) const
+{
+    return d_points[key];
+}
+
+inline Point *Accessible::proxy_access_action(std::size_t key)
+{
+    return &d_points[key];
+}
+
+inline Point const *Accessible::proxy_access_action(std::size_t key) const
+{
+    return &d_points[key];
+}
+
+// Computes its elements and has no proxy_commit_action.
+struct Computed: protected IndexProxifier<Computed>
+{
+    using IndexProxifier<Computed>::operator[];
+
+private:
+    friend IndexProxifier<Computed>;
+
+    Point proxy_return_action(int key) const
+    {
+        return Point{key, 2 * key};
+    }
+};
+
+template <typename T>
+using WritableX = decltype(std::declval<T &>()[0]->x = 1);
+
+using namespace std;
+
+int main()
+{
+    test("If proxy_return_action returns a reference, operator-> yields a pointer to the element.",
+         []()
+         {
+             RetByValue<Point> points;
+             points[1]->y = 7;
+             static_assert(std::is_same<Point *, decltype(points[1].operator->())>::value);
+             return points.d_data[1].y == 7
+                 && points[1]->y == 7
+                 && &points[1]->x == &points.d_data[1].x;
+         });
+
+    test("operator-> uses proxy_access_action if available.",
+         []()
+         {
+             Accessible accessible;
+             accessible[0]->x = 3;
+             Accessible const &cref(accessible);
+             static_assert(std::is_same<Point const *, decltype(cref[0].operator->())>::value,
+                           "Const owners should hand out const access.");
+             return cref[0]->x == 3;
+         });
+
+    test("Writes through a Pin are committed by proxy_commit_action.",
+         []()
+         {
+             PackedPoints points;
+             points[2]->x = -5;
+             points[2]->y = 9;
+             Point result = points[2];
+             return result.x == -5
+                 && result.y == 9
+                 && points.commits() == 2;
+         });
+
+    test("Reading through a Pin, or writing what was there, commits nothing.",
+         []()
+         {
+             PackedPoints points;
+             points[1] = Point{3, 4};
+             int x = points[1]->x;
+             points[1]->y = 4;
+             return x == 3
+                 && points[1]->y == 4
+                 && points.commits() == 0;
+         });
+
+    test("Without proxy_commit_action, a Pin is read-only.",
+         []()
+         {
+             Computed computed;
+             static_assert(not std::experimental::is_detected<WritableX, Computed>::value,
+                           "Writing through a Pin without commit action should not compile.");
+             return computed[4]->y == 8;
+         });
+
+    return TestCount::result();
+}
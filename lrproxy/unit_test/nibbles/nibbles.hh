@@ -0,0 +1,111 @@
+#ifndef nibbles_hh_defd
+#define nibbles_hh_defd
+
+#include "../../../indexproxifier.hh"
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+// Eight 4-bit unsigned integers packed into one 32-bit word.
+class Nibbles: protected IndexProxifier<Nibbles>
+{
+
+    typedef uint32_t data_t;
+    data_t d_data = 0;
+    std::size_t d_swaps = 0; // Counts calls to proxy_swap_action.
+    std::size_t d_transfers = 0; // Counts calls to proxy_transfer_action.
+
+public:
+    enum { Count = 8 };
+
+    Nibbles() = default;
+    Nibbles(std::initializer_list<unsigned> items);
+    data_t internal() const;
+    std::size_t swaps() const;
+    std::size_t transfers() const;
+
+    ProxyIterator<Nibbles> begin();
+    ProxyIterator<Nibbles> end();
+
+    using IndexProxifier<Nibbles>::operator[];
+
+private:
+
+    friend IndexProxifier<Nibbles>;
+
+    unsigned proxy_return_action(std::size_t key) const;
+    unsigned proxy_accept_action(std::size_t key, unsigned value);
+    void proxy_swap_action(std::size_t key1, std::size_t key2);
+    unsigned proxy_transfer_action(std::size_t key, Nibbles const &source, std::size_t sourcekey);
+
+    static constexpr unsigned shift(std::size_t key);
+};
+
+
+inline Nibbles::Nibbles(std::initializer_list<unsigned> items)
+{
+    std::size_t key = 0;
+    for (unsigned item: items)
+        proxy_accept_action(key++, item);
+}
+
+inline Nibbles::data_t Nibbles::internal() const
+{
+    return d_data;
+}
+
+inline std::size_t Nibbles::swaps() const
+{
+    return d_swaps;
+}
+
+inline std::size_t Nibbles::transfers() const
+{
+    return d_transfers;
+}
+
+inline ProxyIterator<Nibbles> Nibbles::begin()
+{
+    return {*this, 0};
+}
+
+inline ProxyIterator<Nibbles> Nibbles::end()
+{
+    return {*this, Count};
+}
+
+inline constexpr unsigned Nibbles::shift(std::size_t key)
+{
+    return 4 * key;
+}
+
+inline unsigned Nibbles::proxy_return_action(std::size_t key) const
+{
+    return (d_data >> shift(key)) & 0xf;
+}
+
+inline unsigned Nibbles::proxy_accept_action(std::size_t key, unsigned value)
+{
+    d_data &= ~(data_t{0xf} << shift(key));
+    d_data |= data_t{value & 0xf} << shift(key);
+    return value;
+}
+
+// Swaps two nibbles in place: xor-swap of the bits that differ.
+inline void Nibbles::proxy_swap_action(std::size_t key1, std::size_t key2)
+{
+    data_t diff = ((d_data >> shift(key1)) ^ (d_data >> shift(key2))) & 0xf;
+    d_data ^= (diff << shift(key1)) | (diff << shift(key2));
+    ++d_swaps;
+}
+
+// Copies a nibble from source without unpacking it to an unsigned first.
+inline unsigned Nibbles::proxy_transfer_action(std::size_t key, Nibbles const &source, std::size_t sourcekey)
+{
+    data_t nibble = (source.d_data >> shift(sourcekey)) & 0xf;
+    d_data = (d_data & ~(data_t{0xf} << shift(key))) | (nibble << shift(key));
+    ++d_transfers;
+    return nibble;
+}
+
+#endif //nibbles_hh_defd
@@ -0,0 +1,86 @@
+
+#include "../../indexproxifier.hh"
+#include "../../../unittest/unittest.hh"
+#include "nibbles/nibbles.hh"
+#include "retbyref/retbyref.hh"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+using namespace std;
+
+int main()
+{
+    static_assert(std::random_access_iterator<ProxyIterator<Nibbles>>,
+                  "ProxyIterator should model std::random_access_iterator.");
+    static_assert(std::permutable<ProxyIterator<Nibbles>>,
+                  "ProxyIterator should allow permuting algorithms, e.g. partition.");
+
+    test("Swapping two proxies swaps the elements through proxy_swap_action.",
+         []()
+         {
+             Nibbles nibbles{1, 2, 3, 4};
+             swap(nibbles[0], nibbles[3]);
+             return nibbles[0] == 4u
+                 && nibbles[3] == 1u
+                 && nibbles.swaps() == 1;
+         });
+
+    test("Swapping proxies into different owners swaps through a temporary.",
+         []()
+         {
+             Nibbles lhs{1, 2};
+             Nibbles rhs{3, 4};
+             swap(lhs[1], rhs[0]);
+             return lhs[1] == 3u
+                 && rhs[0] == 2u
+                 && lhs.swaps() == 0
+                 && rhs.swaps() == 0;
+         });
+
+    test("Without proxy_swap_action, proxies swap through a temporary.",
+         []()
+         {
+             RetByRef numbers{1, 2, 3, 4};
+             swap(numbers[0], numbers[2]);
+             return numbers.d_data[0] == 3
+                 && numbers.d_data[2] == 1;
+         });
+
+    test("std::sort sorts a proxified owner in place.",
+         []()
+         {
+             Nibbles nibbles{7, 3, 15, 0, 9, 3, 1, 12};
+             std::sort(nibbles.begin(), nibbles.end());
+             return nibbles.internal() == 0xfc973310u;
+         });
+
+    test("std::partition swaps through proxy_swap_action.",
+         []()
+         {
+             Nibbles nibbles{1, 2, 3, 4, 5, 6, 7, 8};
+             auto middle = std::partition(nibbles.begin(), nibbles.end(),
+                                          [](unsigned value)
+                                          {
+                                              return value % 2 == 0;
+                                          });
+             return middle - nibbles.begin() == 4
+                 && nibbles.swaps() != 0
+                 && std::all_of(nibbles.begin(), middle,
+                                [](unsigned value)
+                                {
+                                    return value % 2 == 0;
+                                });
+         });
+
+    test("iter_move yields the element's value.",
+         []()
+         {
+             Nibbles nibbles{5, 6};
+             unsigned value = std::ranges::iter_move(nibbles.begin() + 1);
+             return value == 6u;
+         });
+
+    return TestCount::result();
+}
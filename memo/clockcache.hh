@@ -0,0 +1,132 @@
+#ifndef clockcache_hh_defd
+#define clockcache_hh_defd
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+   Bounded key to value cache with CLOCK (second chance) eviction: an
+   approximation of LRU that doesn't reorder anything on a hit, it only sets
+   a bit. When full, a hand sweeps the entries, clearing set bits, and
+   evicts the first entry whose bit was already clear.
+
+   Not thread safe. A capacity of 0 caches nothing.
+*/
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ClockCache
+{
+    struct Entry
+    {
+        Key key;
+        Value value;
+        bool referenced;
+    };
+
+    std::vector<Entry> d_entries;
+    std::unordered_map<Key, std::size_t, Hash> d_index; // Into d_entries.
+    std::size_t d_capacity;
+    std::size_t d_hand = 0;
+
+public:
+    explicit ClockCache(std::size_t capacity = 0);
+
+    // Null if key isn't cached.
+    Value const *find(Key const &key);
+
+    // Caches value for key, which must not be cached yet.
+    void insert(Key const &key, Value value);
+
+    void erase(Key const &key);
+    void clear();
+
+    std::size_t size() const;
+    std::size_t capacity() const;
+};
+
+template <typename Key, typename Value, typename Hash>
+ClockCache<Key, Value, Hash>::ClockCache(std::size_t capacity)
+    : d_capacity(capacity)
+{
+    d_entries.reserve(capacity);
+    d_index.reserve(capacity);
+}
+
+template <typename Key, typename Value, typename Hash>
+Value const *ClockCache<Key, Value, Hash>::find(Key const &key)
+{
+    auto found = d_index.find(key);
+    if (found == d_index.end())
+        return nullptr;
+    Entry &entry = d_entries[found->second];
+    entry.referenced = true;
+    return &entry.value;
+}
+
+template <typename Key, typename Value, typename Hash>
+void ClockCache<Key, Value, Hash>::insert(Key const &key, Value value)
+{
+    if (d_capacity == 0)
+        return;
+
+    if (d_entries.size() < d_capacity)
+    {
+        d_index.emplace(key, d_entries.size());
+        d_entries.push_back(Entry{key, std::move(value), false});
+        return;
+    }
+
+    while (d_entries[d_hand].referenced)
+    {
+        d_entries[d_hand].referenced = false;
+        d_hand = (d_hand + 1) % d_entries.size();
+    }
+    Entry &victim = d_entries[d_hand];
+    d_index.erase(victim.key);
+    d_index.emplace(key, d_hand);
+    victim = Entry{key, std::move(value), false};
+    d_hand = (d_hand + 1) % d_entries.size();
+}
+
+// Moves the last entry into the hole, so the entries stay contiguous.
+template <typename Key, typename Value, typename Hash>
+void ClockCache<Key, Value, Hash>::erase(Key const &key)
+{
+    auto found = d_index.find(key);
+    if (found == d_index.end())
+        return;
+    std::size_t const hole = found->second;
+    d_index.erase(found);
+    if (hole != d_entries.size() - 1)
+    {
+        d_entries[hole] = std::move(d_entries.back());
+        d_index[d_entries[hole].key] = hole;
+    }
+    d_entries.pop_back();
+    if (d_hand >= d_entries.size())
+        d_hand = 0;
+}
+
+template <typename Key, typename Value, typename Hash>
+void ClockCache<Key, Value, Hash>::clear()
+{
+    d_entries.clear();
+    d_index.clear();
+    d_hand = 0;
+}
+
+template <typename Key, typename Value, typename Hash>
+std::size_t ClockCache<Key, Value, Hash>::size() const
+{
+    return d_entries.size();
+}
+
+template <typename Key, typename Value, typename Hash>
+std::size_t ClockCache<Key, Value, Hash>::capacity() const
+{
+    return d_capacity;
+}
+
+#endif //clockcache_hh_defd
@@ -0,0 +1,254 @@
+#ifndef memoised_hh_defd
+#define memoised_hh_defd
+
+#include "../indexproxifier.hh"
+#include "clockcache.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+/**
+   Caches the elements of an owner deriving from IndexProxifier whose
+   proxy_return_action is expensive, like decoding a tile or computing a
+   derived metric. The owner itself is unchanged; it is wrapped:
+
+       Tiles tiles;
+       Memoised<Tiles> cached(tiles, 1024);   // Caches up to 1024 elements.
+       Tile tile = cached[key];                // Computed once,
+       tile = cached[key];                     // then cached.
+       cached[key] = other;                    // Writes through to tiles.
+
+   Reads go through a ClockCache of the given capacity. A write through the
+   wrapper goes to the owner, and evicts the key's cached element, so the
+   next read sees whatever the owner made of it. Writes to the owner that
+   bypass the wrapper require invalidate(key) or clear().
+
+   hits() and misses() count the reads answered by the cache and those
+   passed on to the owner.
+
+   ShardedMemoised is the same for concurrent readers and writers: the
+   cache is split into shards, each with its own lock, picked by the hash of
+   the key. A miss calls the owner with the shard locked, so the owner's
+   reads must be safe to do concurrently, for keys in different shards, and
+   so must its writes.
+*/
+
+template <typename Owner, typename Key = std::size_t, typename Hash = std::hash<Key>>
+class Memoised: protected IndexProxifier<Memoised<Owner, Key, Hash>>
+{
+public:
+    typedef typename std::remove_cvref<
+        typename decltype(std::declval<Owner &>()[std::declval<Key const &>()])::indexproxifier_conversion_type
+        >::type value_type;
+
+private:
+    Owner &d_owner;
+    mutable ClockCache<Key, value_type, Hash> d_cache;
+    mutable std::size_t d_hits = 0;
+    mutable std::size_t d_misses = 0;
+
+public:
+    Memoised(Owner &owner, std::size_t capacity);
+
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+    void invalidate(Key const &key);
+    void clear();
+
+    using IndexProxifier<Memoised>::operator[];
+
+private:
+    friend IndexProxifier<Memoised>;
+
+    value_type proxy_return_action(Key const &key) const;
+    decltype(auto) proxy_accept_action(Key const &key, value_type const &value);
+};
+
+template <typename Owner, typename Key, typename Hash>
+Memoised<Owner, Key, Hash>::Memoised(Owner &owner, std::size_t capacity)
+    : d_owner(owner),
+      d_cache(capacity)
+{}
+
+template <typename Owner, typename Key, typename Hash>
+std::size_t Memoised<Owner, Key, Hash>::hits() const
+{
+    return d_hits;
+}
+
+template <typename Owner, typename Key, typename Hash>
+std::size_t Memoised<Owner, Key, Hash>::misses() const
+{
+    return d_misses;
+}
+
+template <typename Owner, typename Key, typename Hash>
+void Memoised<Owner, Key, Hash>::invalidate(Key const &key)
+{
+    d_cache.erase(key);
+}
+
+template <typename Owner, typename Key, typename Hash>
+void Memoised<Owner, Key, Hash>::clear()
+{
+    d_cache.clear();
+}
+
+template <typename Owner, typename Key, typename Hash>
+typename Memoised<Owner, Key, Hash>::value_type Memoised<Owner, Key, Hash>::proxy_return_action(Key const &key) const
+{
+    if (value_type const *cached = d_cache.find(key))
+    {
+        ++d_hits;
+        return *cached;
+    }
+    ++d_misses;
+    value_type value = d_owner[key];
+    d_cache.insert(key, value);
+    return value;
+}
+
+template <typename Owner, typename Key, typename Hash>
+decltype(auto) Memoised<Owner, Key, Hash>::proxy_accept_action(Key const &key, value_type const &value)
+{
+    d_cache.erase(key);
+    return d_owner[key] = value;
+}
+
+template <typename Owner, typename Key = std::size_t, std::size_t ShardCount = 16, typename Hash = std::hash<Key>>
+class ShardedMemoised: protected IndexProxifier<ShardedMemoised<Owner, Key, ShardCount, Hash>>
+{
+    static_assert(ShardCount != 0, "ShardedMemoised needs at least one shard.");
+
+public:
+    typedef typename Memoised<Owner, Key, Hash>::value_type value_type;
+
+private:
+    // Own cache line each, so shards don't contend through false sharing.
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        ClockCache<Key, value_type, Hash> cache;
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+    };
+
+    Owner &d_owner;
+    mutable std::array<Shard, ShardCount> d_shards;
+
+public:
+    // Capacity is for all shards together.
+    ShardedMemoised(Owner &owner, std::size_t capacity);
+
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+    void invalidate(Key const &key);
+    void clear();
+
+    using IndexProxifier<ShardedMemoised>::operator[];
+
+private:
+    friend IndexProxifier<ShardedMemoised>;
+
+    value_type proxy_return_action(Key const &key) const;
+    decltype(auto) proxy_accept_action(Key const &key, value_type const &value);
+
+    Shard &shard(Key const &key) const;
+};
+
+template <typename Owner, typename Key, std::size_t ShardCount, typename Hash>
+ShardedMemoised<Owner, Key, ShardCount, Hash>::ShardedMemoised(Owner &owner, std::size_t capacity)
+    : d_owner(owner)
+{
+    for (std::size_t ix = 0; ix != ShardCount; ++ix)
+        d_shards[ix].cache = ClockCache<Key, value_type, Hash>(
+            capacity / ShardCount + (ix < capacity % ShardCount));
+}
+
+template <typename Owner, typename Key, std::size_t ShardCount, typename Hash>
+std::size_t ShardedMemoised<Owner, Key, ShardCount, Hash>::hits() const
+{
+    std::size_t sum = 0;
+    for (Shard &shard: d_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        sum += shard.hits;
+    }
+    return sum;
+}
+
+template <typename Owner, typename Key, std::size_t ShardCount, typename Hash>
+std::size_t ShardedMemoised<Owner, Key, ShardCount, Hash>::misses() const
+{
+    std::size_t sum = 0;
+    for (Shard &shard: d_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        sum += shard.misses;
+    }
+    return sum;
+}
+
+template <typename Owner, typename Key, std::size_t ShardCount, typename Hash>
+void ShardedMemoised<Owner, Key, ShardCount, Hash>::invalidate(Key const &key)
+{
+    Shard &owning = shard(key);
+    std::lock_guard<std::mutex> lock(owning.mutex);
+    owning.cache.erase(key);
+}
+
+template <typename Owner, typename Key, std::size_t ShardCount, typename Hash>
+void ShardedMemoised<Owner, Key, ShardCount, Hash>::clear()
+{
+    for (Shard &shard: d_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.cache.clear();
+    }
+}
+
+// The owner is read with the shard locked: otherwise a concurrent write
+// could slip in between the read and caching its (by then stale) result.
+template <typename Owner, typename Key, std::size_t ShardCount, typename Hash>
+typename ShardedMemoised<Owner, Key, ShardCount, Hash>::value_type
+ShardedMemoised<Owner, Key, ShardCount, Hash>::proxy_return_action(Key const &key) const
+{
+    Shard &owning = shard(key);
+    std::lock_guard<std::mutex> lock(owning.mutex);
+    if (value_type const *cached = owning.cache.find(key))
+    {
+        ++owning.hits;
+        return *cached;
+    }
+    ++owning.misses;
+    value_type value = d_owner[key];
+    owning.cache.insert(key, value);
+    return value;
+}
+
+template <typename Owner, typename Key, std::size_t ShardCount, typename Hash>
+decltype(auto) ShardedMemoised<Owner, Key, ShardCount, Hash>::proxy_accept_action(Key const &key, value_type const &value)
+{
+    Shard &owning = shard(key);
+    std::lock_guard<std::mutex> lock(owning.mutex);
+    owning.cache.erase(key);
+    return d_owner[key] = value;
+}
+
+// Scrambles the hash first: std::hash of an integer is often the integer.
+template <typename Owner, typename Key, std::size_t ShardCount, typename Hash>
+typename ShardedMemoised<Owner, Key, ShardCount, Hash>::Shard &
+ShardedMemoised<Owner, Key, ShardCount, Hash>::shard(Key const &key) const
+{
+    uint64_t mixed = static_cast<uint64_t>(Hash{}(key)) * 0x9e3779b97f4a7c15;
+    return d_shards[(mixed >> 32) % ShardCount];
+}
+
+#endif //memoised_hh_defd
@@ -0,0 +1,152 @@
+#include "memoised.hh"
+#include "../lrproxy/unit_test/nibbles/nibbles.hh"
+#include "../../unittest/unittest.hh"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Stands in for an owner whose elements are costly to compute: counts
+    // how often they are.
+    class Expensive: protected IndexProxifier<Expensive>
+    {
+        vector<long> d_values;
+        mutable atomic<size_t> d_computations{0};
+
+    public:
+        explicit Expensive(size_t size);
+
+        size_t computations() const;
+
+        using IndexProxifier<Expensive>::operator[];
+
+    private:
+        friend IndexProxifier<Expensive>;
+
+        long proxy_return_action(size_t key) const;
+        void proxy_accept_action(size_t key, long value);
+    };
+
+    Expensive::Expensive(size_t size)
+        : d_values(size)
+    {
+        for (size_t key = 0; key != size; ++key)
+            d_values[key] = 3 * key;
+    }
+
+    size_t Expensive::computations() const
+    {
+        return d_computations;
+    }
+
+    long Expensive::proxy_return_action(size_t key) const
+    {
+        ++d_computations;
+        return d_values.at(key);
+    }
+
+    void Expensive::proxy_accept_action(size_t key, long value)
+    {
+        d_values.at(key) = value;
+    }
+}
+
+int main()
+{
+    test("Repeated reads are computed once.",
+         []()
+         {
+             Expensive expensive(10);
+             Memoised<Expensive> cached(expensive, 4);
+             long sum = 0;
+             for (int round = 0; round != 5; ++round)
+                 sum += cached[2] + cached[3];
+             return sum == 5 * (6 + 9)
+                 && expensive.computations() == 2
+                 && cached.hits() == 8
+                 && cached.misses() == 2;
+         });
+
+    test("A write goes to the owner, and the next read sees what it made of it.",
+         []()
+         {
+             Nibbles nibbles{1, 2, 3};
+             Memoised<Nibbles> cached(nibbles, 8);
+             unsigned before = cached[1];
+             cached[1] = 0x17u; // Nibbles keeps the low 4 bits.
+             unsigned after = cached[1];
+             return before == 2
+                 && after == 7
+                 && nibbles[1] == 7u
+                 && cached.misses() == 2;
+         });
+
+    test("CLOCK evicts entries that weren't referenced since the last sweep.",
+         []()
+         {
+             ClockCache<int, int> cache(2);
+             cache.insert(1, 10);
+             cache.insert(2, 20);
+             cache.find(1);           // Second chance for 1 ...
+             cache.insert(3, 30);     // ... so 2 goes.
+             cache.insert(4, 40);     // 1 spent its chance: it goes now.
+             return cache.size() == 2
+                 && cache.find(1) == nullptr
+                 && cache.find(2) == nullptr
+                 && *cache.find(3) == 30
+                 && *cache.find(4) == 40;
+         });
+
+    test("Erasing keeps the cache consistent.",
+         []()
+         {
+             ClockCache<int, int> cache(3);
+             cache.insert(1, 10);
+             cache.insert(2, 20);
+             cache.insert(3, 30);
+             cache.erase(1);
+             cache.insert(4, 40);
+             cache.insert(5, 50);     // 3 took 1's place, and goes first.
+             return cache.size() == 3
+                 && cache.find(1) == nullptr
+                 && cache.find(3) == nullptr
+                 && *cache.find(2) == 20
+                 && *cache.find(4) == 40
+                 && *cache.find(5) == 50;
+         });
+
+    test("Concurrent reads through ShardedMemoised compute each element once.",
+         []()
+         {
+             enum { Keys = 1000, Threads = 4, Rounds = 20 };
+             Expensive expensive(Keys);
+             ShardedMemoised<Expensive> cached(expensive, 4 * Keys); // No evictions.
+             atomic<bool> correct{true};
+
+             vector<thread> threads;
+             for (int id = 0; id != Threads; ++id)
+                 threads.emplace_back(
+                     [&, id]()
+                     {
+                         for (int round = 0; round != Rounds; ++round)
+                             for (size_t key = id; key < Keys; key += 1 + id)
+                                 if (cached[key] != 3 * long(key))
+                                     correct = false;
+                     });
+             for (thread &worker: threads)
+                 worker.join();
+
+             cached[size_t{5}] = 1234;
+             size_t reads = cached.hits() + cached.misses();
+             return correct
+                 && cached[size_t{5}] == 1234
+                 && expensive.computations() == Keys + 1
+                 && reads > Keys;
+         });
+
+    return TestCount::result();
+}
@@ -0,0 +1,166 @@
+#ifndef packedarray_hh_defd
+#define packedarray_hh_defd
+
+#include "../indexproxifier.hh"
+#include "packedkernels.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+/**
+   Array of unsigned integers of width bits each (1 <= width <= 32), packed
+   back to back into 64-bit words, so e.g. a million 5-bit values take
+   625 kB instead of 4 MB:
+
+       PackedArray<5> small(1000000);          // Width fixed at compile time,
+       PackedArray<> counts(1000000, width);   // or at run time.
+       small[7] = 19u;
+       uint32_t value = small[7];
+
+   Elements may straddle two words. Values wider than width lose their high
+   bits when stored. decode and encode convert ranges of elements at once;
+   decode uses the PackedKernels the CPU supports best.
+*/
+template <unsigned Bits = 0>
+class PackedArray: protected IndexProxifier<PackedArray<Bits>>
+{
+    static_assert(Bits <= 32, "PackedArray elements have at most 32 bits.");
+
+    std::vector<uint64_t> d_words; // With one word of padding.
+    std::size_t d_size = 0;
+    unsigned d_width = Bits;
+
+public:
+    explicit PackedArray(std::size_t size = 0, unsigned width = Bits);
+
+    std::size_t size() const;
+    unsigned width() const;
+    void resize(std::size_t size);
+
+    // Elements [first, last) to out, and from in.
+    void decode(std::size_t first, std::size_t last, uint32_t *out) const;
+    void encode(uint32_t const *in, std::size_t first, std::size_t last);
+
+    // Element ix is at bits ix * width() and up, counting from bit 0 of
+    // word 0.
+    std::span<uint64_t const> words() const;
+
+    using IndexProxifier<PackedArray>::operator[];
+
+private:
+    friend IndexProxifier<PackedArray>;
+
+    uint32_t proxy_return_action(std::size_t ix) const;
+    uint32_t proxy_accept_action(std::size_t ix, uint32_t value);
+
+    static std::size_t word_count(std::size_t size, unsigned width);
+};
+
+template <unsigned Bits>
+PackedArray<Bits>::PackedArray(std::size_t size, unsigned width)
+    : d_width(width)
+{
+    if (width == 0 || width > 32 || (Bits != 0 && width != Bits))
+        throw std::invalid_argument("PackedArray width must be 1 to 32 bits");
+    resize(size);
+}
+
+template <unsigned Bits>
+std::size_t PackedArray<Bits>::size() const
+{
+    return d_size;
+}
+
+template <unsigned Bits>
+unsigned PackedArray<Bits>::width() const
+{
+    if constexpr (Bits != 0)
+        return Bits; // Lets the compiler fold the shifts.
+    else
+        return d_width;
+}
+
+// Elements beyond the old size are 0: their bits were never set.
+template <unsigned Bits>
+void PackedArray<Bits>::resize(std::size_t size)
+{
+    if (size < d_size)
+        encode(std::vector<uint32_t>(d_size - size).data(), size, d_size);
+    d_words.resize(word_count(size, width()));
+    d_size = size;
+}
+
+template <unsigned Bits>
+void PackedArray<Bits>::decode(std::size_t first, std::size_t last, uint32_t *out) const
+{
+    PackedKernels::best().decode(d_words.data(), first, last - first, width(), out);
+}
+
+// Collects bits in a 64-bit accumulator, and stores whole words.
+template <unsigned Bits>
+void PackedArray<Bits>::encode(uint32_t const *in, std::size_t first, std::size_t last)
+{
+    if (first == last)
+        return;
+    unsigned const bits = width();
+    uint64_t const mask = packed_detail::mask(bits);
+    std::size_t word = first * bits / 64;
+    unsigned offset = first * bits % 64;
+    uint64_t accumulator = d_words[word] & packed_detail::mask(offset); // Keep what precedes first.
+
+    for (std::size_t ix = first; ix != last; ++ix)
+    {
+        uint64_t const value = *in++ & mask;
+        accumulator |= value << offset;
+        offset += bits;
+        if (offset >= 64)
+        {
+            d_words[word++] = accumulator;
+            offset -= 64;
+            accumulator = offset == 0 ? 0 : value >> (bits - offset);
+        }
+    }
+    if (offset != 0) // Keep what follows last.
+        d_words[word] = accumulator | (d_words[word] & ~packed_detail::mask(offset));
+}
+
+template <unsigned Bits>
+std::span<uint64_t const> PackedArray<Bits>::words() const
+{
+    return d_words;
+}
+
+template <unsigned Bits>
+uint32_t PackedArray<Bits>::proxy_return_action(std::size_t ix) const
+{
+    return packed_detail::scalar_get(d_words.data(), ix, width());
+}
+
+template <unsigned Bits>
+uint32_t PackedArray<Bits>::proxy_accept_action(std::size_t ix, uint32_t value)
+{
+    unsigned const bits = width();
+    uint64_t const mask = packed_detail::mask(bits);
+    uint64_t const stored = value & mask;
+    std::size_t const position = ix * bits;
+    unsigned const offset = position % 64;
+    uint64_t &word = d_words[position / 64];
+    word = (word & ~(mask << offset)) | stored << offset;
+    if (offset + bits > 64)
+    {
+        uint64_t &next = d_words[position / 64 + 1];
+        next = (next & ~(mask >> (64 - offset))) | stored >> (64 - offset);
+    }
+    return static_cast<uint32_t>(stored);
+}
+
+template <unsigned Bits>
+std::size_t PackedArray<Bits>::word_count(std::size_t size, unsigned width)
+{
+    return (size * width + 63) / 64 + 1;
+}
+
+#endif //packedarray_hh_defd
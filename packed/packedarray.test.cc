@@ -0,0 +1,124 @@
+#include "packedarray.hh"
+#include "../../unittest/unittest.hh"
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    vector<uint32_t> random_values(size_t size, unsigned width, unsigned seed)
+    {
+        mt19937 generator(seed);
+        vector<uint32_t> values(size);
+        for (uint32_t &value: values)
+            value = generator() & packed_detail::mask(width);
+        return values;
+    }
+}
+
+int main()
+{
+    test("Elements of every width read back what was written, across words.",
+         []()
+         {
+             for (unsigned width = 1; width <= 32; ++width)
+             {
+                 vector<uint32_t> values = random_values(200, width, width);
+                 PackedArray<> packed(values.size(), width);
+                 for (size_t ix = 0; ix != values.size(); ++ix)
+                     packed[ix] = values[ix];
+                 for (size_t ix = 0; ix != values.size(); ++ix)
+                     if (packed[ix] != values[ix])
+                         return false;
+             }
+             return true;
+         });
+
+    test("Stored values keep their low width bits, and spare their neighbours.",
+         []()
+         {
+             PackedArray<20> packed(5);
+             packed[size_t{2}] = 0xfffffu;      // Bits 40 to 59.
+             packed[size_t{3}] = 0x123456u;     // Bits 60 to 79, straddling.
+             packed[size_t{4}] = 0xabcdeu;
+             return packed[size_t{3}] == 0x23456u
+                 && packed[size_t{2}] == 0xfffffu
+                 && packed[size_t{4}] == 0xabcdeu
+                 && packed[size_t{1}] == 0u;
+         });
+
+    test("Every decode kernel agrees with the proxies, for any range.",
+         []()
+         {
+             for (unsigned width = 1; width <= 32; ++width)
+             {
+                 vector<uint32_t> values = random_values(300, width, 100 + width);
+                 PackedArray<> packed(values.size(), width);
+                 for (size_t ix = 0; ix != values.size(); ++ix)
+                     packed[ix] = values[ix];
+
+                 for (PackedKernels const &kernels: PackedKernels::available())
+                     for (size_t first: {0, 1, 7, 8, 13})
+                         for (size_t last: {first, first + 5, size_t{299}, size_t{300}})
+                         {
+                             vector<uint32_t> out(last - first);
+                             kernels.decode(packed.words().data(), first, last - first, width, out.data());
+                             if (out != vector<uint32_t>(values.begin() + first, values.begin() + last))
+                                 return false;
+                         }
+             }
+             return true;
+         });
+
+    test("encode writes a range, and leaves the elements around it alone.",
+         []()
+         {
+             for (unsigned width: {1, 3, 7, 20, 31, 32})
+             {
+                 vector<uint32_t> values = random_values(250, width, 200 + width);
+                 vector<uint32_t> range = random_values(150, width, 300 + width);
+                 PackedArray<> packed(values.size(), width);
+                 packed.encode(values.data(), 0, values.size());
+                 packed.encode(range.data(), 37, 187);
+                 copy(range.begin(), range.end(), values.begin() + 37);
+
+                 vector<uint32_t> decoded(values.size());
+                 packed.decode(0, values.size(), decoded.data());
+                 if (decoded != values)
+                     return false;
+             }
+             return true;
+         });
+
+    test("Packing saves memory, and resizing zeroes new elements.",
+         []()
+         {
+             PackedArray<5> packed(1000);
+             size_t words = packed.words().size();
+             packed[size_t{999}] = 31u;
+             packed.resize(990);
+             packed.resize(1000);
+             return words == (1000 * 5 + 63) / 64 + 1
+                 && packed[size_t{999}] == 0u
+                 && packed.width() == 5;
+         });
+
+    test("Widths outside 1 to 32 are refused.",
+         []()
+         {
+             try
+             {
+                 PackedArray<> packed(10, 33);
+             }
+             catch (invalid_argument const &)
+             {
+                 return true;
+             }
+             return false;
+         });
+
+    return TestCount::result();
+}
@@ -0,0 +1,142 @@
+#ifndef packedkernels_hh_defd
+#define packedkernels_hh_defd
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__)
+    #define PACKEDKERNELS_X86 1
+    #include <immintrin.h>
+#else
+    #define PACKEDKERNELS_X86 0
+#endif
+
+/**
+   Unpacking of width-bit unsigned integers (1 <= width <= 32), stored
+   back to back from bit 0 of words[0] on, for PackedArray. The scalar
+   version works anywhere; on x86 with AVX2, groups of eight elements are
+   gathered and shifted into place in one go. best() picks the fastest
+   the CPU supports, once; available() lists all usable ones, for testing.
+
+   decode writes elements first up to first + count to out. words must
+   have one word of padding beyond the last element.
+*/
+struct PackedKernels
+{
+    typedef void (*Decode)(uint64_t const *words, std::size_t first, std::size_t count,
+                           unsigned width, uint32_t *out);
+
+    char const *name;
+    Decode decode;
+
+    static PackedKernels const &best();
+    static std::vector<PackedKernels> available();
+};
+
+namespace packed_detail
+{
+    inline uint64_t mask(unsigned width)
+    {
+        return (uint64_t(1) << width) - 1;
+    }
+
+    inline uint32_t scalar_get(uint64_t const *words, std::size_t ix, unsigned width)
+    {
+        std::size_t const position = ix * width;
+        unsigned const offset = position % 64;
+        uint64_t value = words[position / 64] >> offset;
+        if (offset + width > 64)
+            value |= words[position / 64 + 1] << (64 - offset);
+        return static_cast<uint32_t>(value & mask(width));
+    }
+
+    inline void scalar_decode(uint64_t const *words, std::size_t first, std::size_t count,
+                              unsigned width, uint32_t *out)
+    {
+        for (std::size_t ix = 0; ix != count; ++ix)
+            out[ix] = scalar_get(words, first + ix, width);
+    }
+
+#if PACKEDKERNELS_X86
+    // Eight elements starting at a multiple of eight occupy exactly width
+    // bytes, starting on a byte boundary. Element j of them starts j * width
+    // bits in: reading 32 bits (64 if width > 25) from byte j * width / 8
+    // and shifting right by j * width % 8 brings it down to bit 0.
+    __attribute__((target("avx2")))
+    inline void avx2_decode(uint64_t const *words, std::size_t first, std::size_t count,
+                            unsigned width, uint32_t *out)
+    {
+        std::size_t ix = 0;
+        std::size_t const head = (8 - first % 8) % 8;
+        for (; ix != count && ix != head; ++ix)
+            out[ix] = scalar_get(words, first + ix, width);
+
+        alignas(32) int32_t bytes[8];
+        alignas(32) int32_t shifts[8];
+        for (unsigned lane = 0; lane != 8; ++lane)
+        {
+            bytes[lane] = lane * width / 8;
+            shifts[lane] = lane * width % 8;
+        }
+        __m256i const byteoffsets = _mm256_load_si256(reinterpret_cast<__m256i const *>(bytes));
+        __m256i const bitshifts = _mm256_load_si256(reinterpret_cast<__m256i const *>(shifts));
+        char const *const base = reinterpret_cast<char const *>(words);
+
+        if (width <= 25) // Shift + width <= 32.
+        {
+            __m256i const valuemask = _mm256_set1_epi32(static_cast<int32_t>(mask(width)));
+            for (; ix + 8 <= count; ix += 8)
+            {
+                char const *group = base + (first + ix) / 8 * width;
+                __m256i values = _mm256_i32gather_epi32(reinterpret_cast<int const *>(group), byteoffsets, 1);
+                values = _mm256_and_si256(_mm256_srlv_epi32(values, bitshifts), valuemask);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + ix), values);
+            }
+        }
+        else
+        {
+            __m256i const valuemask = _mm256_set1_epi64x(static_cast<int64_t>(mask(width)));
+            __m256i const lowhalves = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+            __m256i const lowshifts = _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bitshifts));
+            __m256i const highshifts = _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bitshifts, 1));
+            for (; ix + 8 <= count; ix += 8)
+            {
+                char const *group = base + (first + ix) / 8 * width;
+                long long const *at = reinterpret_cast<long long const *>(group);
+                __m256i low = _mm256_i32gather_epi64(at, _mm256_castsi256_si128(byteoffsets), 1);
+                __m256i high = _mm256_i32gather_epi64(at, _mm256_extracti128_si256(byteoffsets, 1), 1);
+                low = _mm256_and_si256(_mm256_srlv_epi64(low, lowshifts), valuemask);
+                high = _mm256_and_si256(_mm256_srlv_epi64(high, highshifts), valuemask);
+                // Keep the low 32 bits of each 64-bit lane, in order.
+                __m128i lows = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(low, lowhalves));
+                __m128i highs = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(high, lowhalves));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + ix), _mm256_set_m128i(highs, lows));
+            }
+        }
+
+        for (; ix != count; ++ix)
+            out[ix] = scalar_get(words, first + ix, width);
+    }
+#endif
+}
+
+inline PackedKernels const &PackedKernels::best()
+{
+    static PackedKernels const chosen = available().back();
+    return chosen;
+}
+
+// From slow to fast.
+inline std::vector<PackedKernels> PackedKernels::available()
+{
+    std::vector<PackedKernels> kernels{{"scalar", packed_detail::scalar_decode}};
+#if PACKEDKERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        kernels.push_back({"avx2", packed_detail::avx2_decode});
+#endif
+    return kernels;
+}
+
+#endif //packedkernels_hh_defd
@@ -0,0 +1,172 @@
+#include "prefetch.hh"
+#include "../benchmark/benchmark.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Lookups of random keys in hash tables much larger than the caches: a
+// plain loop against pipelined_lookup at several prefetch distances.
+// With open addressing a lookup is one miss, which out-of-order execution
+// already overlaps with the next lookups'. With chaining it is a miss on
+// the bucket and then a dependent one on the node, which prefetching can
+// start earlier. How much that gains depends on the machine.
+
+using namespace std;
+
+namespace
+{
+    constexpr size_t Keys = size_t(1) << 22;
+    constexpr size_t Lookups = size_t(1) << 22;
+
+    uint64_t home(uint64_t key, size_t size)
+    {
+        return (key * 0x9e3779b97f4a7c15) >> 32 & (size - 1);
+    }
+
+    // Open addressing, key 0 marks a free slot. Half full.
+    class OpenTable: protected IndexProxifier<OpenTable>
+    {
+        struct Slot
+        {
+            uint64_t key;
+            uint64_t value;
+        };
+
+        vector<Slot> d_slots;
+
+    public:
+        explicit OpenTable(vector<uint64_t> const &keys);
+
+        using IndexProxifier<OpenTable>::operator[];
+
+    private:
+        friend IndexProxifier<OpenTable>;
+
+        uint64_t proxy_return_action(uint64_t key) const;
+        void proxy_prefetch_action(uint64_t key) const;
+
+        size_t find(uint64_t key) const;
+    };
+
+    OpenTable::OpenTable(vector<uint64_t> const &keys)
+        : d_slots(2 * keys.size())
+    {
+        for (uint64_t key: keys)
+            d_slots[find(key)] = Slot{key, key / 2};
+    }
+
+    uint64_t OpenTable::proxy_return_action(uint64_t key) const
+    {
+        return d_slots[find(key)].value;
+    }
+
+    void OpenTable::proxy_prefetch_action(uint64_t key) const
+    {
+        __builtin_prefetch(&d_slots[home(key, d_slots.size())]);
+    }
+
+    size_t OpenTable::find(uint64_t key) const
+    {
+        size_t ix = home(key, d_slots.size());
+        while (d_slots[ix].key != 0 && d_slots[ix].key != key)
+            ix = (ix + 1) & (d_slots.size() - 1);
+        return ix;
+    }
+
+    // A bucket per key, each a list of nodes scattered over memory.
+    class ChainedTable: protected IndexProxifier<ChainedTable>
+    {
+        struct Node
+        {
+            uint64_t key;
+            uint64_t value;
+            Node *next;
+        };
+
+        vector<Node *> d_buckets;
+        unique_ptr<Node[]> d_nodes;
+
+    public:
+        explicit ChainedTable(vector<uint64_t> const &keys);
+
+        using IndexProxifier<ChainedTable>::operator[];
+
+    private:
+        friend IndexProxifier<ChainedTable>;
+
+        uint64_t proxy_return_action(uint64_t key) const;
+        void proxy_prefetch_action(uint64_t key) const;
+    };
+
+    ChainedTable::ChainedTable(vector<uint64_t> const &keys)
+        : d_buckets(keys.size()),
+          d_nodes(new Node[keys.size()])
+    {
+        vector<size_t> places(keys.size());
+        for (size_t ix = 0; ix != places.size(); ++ix)
+            places[ix] = ix;
+        shuffle(places.begin(), places.end(), mt19937_64(7));
+
+        for (size_t ix = 0; ix != keys.size(); ++ix)
+        {
+            Node *&bucket = d_buckets[home(keys[ix], d_buckets.size())];
+            d_nodes[places[ix]] = Node{keys[ix], keys[ix] / 2, bucket};
+            bucket = &d_nodes[places[ix]];
+        }
+    }
+
+    uint64_t ChainedTable::proxy_return_action(uint64_t key) const
+    {
+        for (Node const *node = d_buckets[home(key, d_buckets.size())]; node != nullptr; node = node->next)
+            if (node->key == key)
+                return node->value;
+        return 0;
+    }
+
+    // Only the first node: the bucket itself has to arrive first.
+    void ChainedTable::proxy_prefetch_action(uint64_t key) const
+    {
+        if (Node const *node = d_buckets[home(key, d_buckets.size())])
+            __builtin_prefetch(node);
+    }
+
+    template <typename Table>
+    void run(char const *name, Table const &table, vector<uint64_t> const &keys)
+    {
+        vector<uint64_t> values(keys.size());
+        report((string(name) + ", plain loop").c_str(),
+               best_seconds([&]()
+                            {
+                                for (size_t ix = 0; ix != keys.size(); ++ix)
+                                    values[ix] = table[keys[ix]];
+                                keep(values.back());
+                            }, 3), keys.size());
+        for (size_t distance: {4, 8, 16, 32})
+            report((string(name) + ", pipelined, distance " + to_string(distance)).c_str(),
+                   best_seconds([&]()
+                                {
+                                    ip::pipelined_lookup(table, keys, values.begin(), distance);
+                                    keep(values.back());
+                                }, 3), keys.size());
+    }
+}
+
+int main()
+{
+    mt19937_64 random(42);
+    vector<uint64_t> keys(Keys);
+    for (uint64_t &key: keys)
+        key = random() | 1;
+
+    vector<uint64_t> lookups(keys.begin(), keys.begin() + Lookups);
+    shuffle(lookups.begin(), lookups.end(), random);
+
+    printf("%zu lookups among %zu keys\n", Lookups, Keys);
+    run("open addressing", OpenTable(keys), lookups);
+    run("chaining", ChainedTable(keys), lookups);
+}
@@ -0,0 +1,72 @@
+#ifndef prefetch_hh_defd
+#define prefetch_hh_defd
+
+#include "../indexproxifier.hh"
+
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+
+/**
+   Prefetching for owners deriving from IndexProxifier whose elements are
+   far apart in memory, like large hash tables or trees, where every read
+   is a cache miss the next one depends on.
+
+       mc[k].prefetch();                      // One element.
+       ip::prefetch_keys(mc, keys);           // All of them.
+       ip::pipelined_lookup(mc, keys, out);   // *out++ = mc[key] for all keys.
+
+   These forward to the owner's (private, like the other proxy_ actions)
+
+       void proxy_prefetch_action(Key key) const;
+
+   which typically does a __builtin_prefetch on the bucket or node holding
+   key. Without it, they do nothing and pipelined_lookup is a plain loop.
+
+   pipelined_lookup prefetches distance keys ahead of the one it reads, so
+   that many misses are outstanding at once instead of one after the other.
+   The best distance depends on the cost of the read and on memory latency;
+   the default suits reads that cost little besides the miss.
+*/
+
+namespace ip
+{
+    enum : std::size_t
+    {
+        PrefetchDistance = 8
+    };
+
+    template <typename Owner, std::ranges::input_range Keys>
+        requires ProxyIndexed<Owner &, std::ranges::range_value_t<Keys>>
+    void prefetch_keys(Owner &owner, Keys const &keys)
+    {
+        for (auto const &key: keys)
+            owner[key].prefetch();
+    }
+
+    template <typename Owner, std::ranges::forward_range Keys, typename OutputIterator>
+        requires ProxyIndexed<Owner &, std::ranges::range_value_t<Keys>>
+    OutputIterator pipelined_lookup(Owner &owner, Keys const &keys, OutputIterator out,
+                                    std::size_t distance = PrefetchDistance)
+    {
+        auto ahead = std::ranges::begin(keys);
+        auto const end = std::ranges::end(keys);
+
+        // Fill the pipeline.
+        for (std::size_t count = 0; count != distance && ahead != end; ++count, ++ahead)
+            owner[*ahead].prefetch();
+
+        for (auto current = std::ranges::begin(keys); current != end; ++current, ++out)
+        {
+            if (ahead != end)
+            {
+                owner[*ahead].prefetch();
+                ++ahead;
+            }
+            *out = owner[*current];
+        }
+        return out;
+    }
+}
+
+#endif //prefetch_hh_defd
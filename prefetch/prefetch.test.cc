@@ -0,0 +1,150 @@
+#include "prefetch.hh"
+#include "../lrproxy/unit_test/nibbles/nibbles.hh"
+#include "../../unittest/unittest.hh"
+
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Open addressing hash table from key to value, which logs prefetches
+    // and reads so the tests can check the order they came in.
+    class HashTable: protected IndexProxifier<HashTable>
+    {
+        struct Slot
+        {
+            uint64_t key;
+            uint64_t value;
+            bool used;
+        };
+
+        vector<Slot> d_slots;
+        mutable vector<pair<char, uint64_t>> d_log;
+
+    public:
+        explicit HashTable(size_t capacity);
+
+        void insert(uint64_t key, uint64_t value);
+        vector<pair<char, uint64_t>> const &log() const;
+
+        using IndexProxifier<HashTable>::operator[];
+
+    private:
+        friend IndexProxifier<HashTable>;
+
+        uint64_t proxy_return_action(uint64_t key) const;
+        void proxy_prefetch_action(uint64_t key) const;
+
+        size_t find(uint64_t key) const;
+    };
+
+    HashTable::HashTable(size_t capacity)
+        : d_slots(capacity)
+    {}
+
+    void HashTable::insert(uint64_t key, uint64_t value)
+    {
+        Slot &slot = d_slots[find(key)];
+        slot = Slot{key, value, true};
+    }
+
+    vector<pair<char, uint64_t>> const &HashTable::log() const
+    {
+        return d_log;
+    }
+
+    uint64_t HashTable::proxy_return_action(uint64_t key) const
+    {
+        d_log.emplace_back('r', key);
+        Slot const &slot = d_slots[find(key)];
+        return slot.used ? slot.value : 0;
+    }
+
+    void HashTable::proxy_prefetch_action(uint64_t key) const
+    {
+        d_log.emplace_back('p', key);
+        __builtin_prefetch(&d_slots[(key * 0x9e3779b97f4a7c15) % d_slots.size()]);
+    }
+
+    size_t HashTable::find(uint64_t key) const
+    {
+        size_t ix = (key * 0x9e3779b97f4a7c15) % d_slots.size();
+        while (d_slots[ix].used && d_slots[ix].key != key)
+            ix = (ix + 1) % d_slots.size();
+        return ix;
+    }
+}
+
+int main()
+{
+    test("prefetch() calls proxy_prefetch_action, and doesn't read.",
+         []()
+         {
+             HashTable table(16);
+             table[uint64_t{3}].prefetch();
+             return table.log() == vector<pair<char, uint64_t>>{{'p', 3}};
+         });
+
+    test("prefetch() does nothing for owners without proxy_prefetch_action.",
+         []()
+         {
+             Nibbles nibbles{1, 2};
+             nibbles[size_t{1}].prefetch();
+             ip::prefetch_keys(nibbles, vector<size_t>{0, 1});
+             vector<unsigned> values;
+             ip::pipelined_lookup(nibbles, vector<size_t>{1, 0}, back_inserter(values));
+             return values == vector<unsigned>{2, 1};
+         });
+
+    test("prefetch_keys prefetches every key, in order.",
+         []()
+         {
+             HashTable table(16);
+             ip::prefetch_keys(table, list<uint64_t>{5, 1, 4});
+             return table.log() == vector<pair<char, uint64_t>>{{'p', 5}, {'p', 1}, {'p', 4}};
+         });
+
+    test("pipelined_lookup reads all keys, each after its prefetch.",
+         []()
+         {
+             HashTable table(1024);
+             vector<uint64_t> keys;
+             for (uint64_t key = 0; key != 500; ++key)
+             {
+                 table.insert(key * 7919, key);
+                 keys.push_back(((key * 37) % 500) * 7919);
+             }
+             vector<uint64_t> values(keys.size());
+             auto end = ip::pipelined_lookup(table, keys, values.begin(), 4);
+
+             for (size_t ix = 0; ix != keys.size(); ++ix)
+                 if (values[ix] != keys[ix] / 7919)
+                     return false;
+             // Key ix is prefetched before key ix - 4 is read.
+             auto const &log = table.log();
+             return end == values.end()
+                 && log.size() == 2 * keys.size()
+                 && log[4] == make_pair('p', keys[4])
+                 && log[5] == make_pair('r', keys[0])
+                 && log[6] == make_pair('p', keys[5])
+                 && log.back() == make_pair('r', keys.back());
+         });
+
+    test("pipelined_lookup copes with fewer keys than the distance.",
+         []()
+         {
+             HashTable table(16);
+             table.insert(2, 20);
+             uint64_t value = 0;
+             ip::pipelined_lookup(table, vector<uint64_t>{2}, &value);
+             return value == 20
+                 && table.log() == vector<pair<char, uint64_t>>{{'p', 2}, {'r', 2}};
+         });
+
+    return TestCount::result();
+}
@@ -0,0 +1,172 @@
+#ifndef proxyiterator_hh_defd
+#define proxyiterator_hh_defd
+
+#ifndef def_h_include_indexproxifier_hh
+#error "Don't include proxyiterator.hh. Include indexproxifier.hh instead."
+#endif
+
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+/**
+   Random access iterator over the integral keys [0, size) of an owner that
+   derives from IndexProxifier. Dereferencing yields owner[index], i.e. an
+   LRProxy, so algorithms like std::sort and std::partition work on the owner
+   in place.
+
+   An owner provides e.g.:
+
+       ProxyIterator<MyClass> begin() { return {*this, 0}; }
+       ProxyIterator<MyClass> end()   { return {*this, size()}; }
+
+   Moving elements goes through the LRProxy's conversion and assignment.
+   Swapping goes through LRProxy's swap, hence through the owner's
+   proxy_swap_action(key1, key2) if it has one.
+*/
+template <typename Owner, typename Index = std::size_t>
+class ProxyIterator
+{
+    Owner *d_owner = nullptr;
+    Index d_index = 0;
+
+    typedef decltype(std::declval<Owner &>()[std::declval<Index>()]) proxy_t;
+    typedef typename proxy_t::indexproxifier_conversion_type conversion_t;
+
+public: // types
+
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef std::random_access_iterator_tag iterator_concept;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::remove_cvref_t<conversion_t> value_type;
+    typedef proxy_t reference; // A prvalue LRProxy.
+    typedef void pointer;
+
+public: // member functions
+
+    constexpr ProxyIterator() = default;
+    constexpr ProxyIterator(Owner &owner, Index index);
+
+    constexpr reference operator*() const;
+    constexpr reference operator[](difference_type offset) const;
+
+    constexpr ProxyIterator &operator++();
+    constexpr ProxyIterator operator++(int);
+    constexpr ProxyIterator &operator--();
+    constexpr ProxyIterator operator--(int);
+    constexpr ProxyIterator &operator+=(difference_type offset);
+    constexpr ProxyIterator &operator-=(difference_type offset);
+
+    friend constexpr ProxyIterator operator+(ProxyIterator it, difference_type offset)
+    {
+        return it += offset;
+    }
+
+    friend constexpr ProxyIterator operator+(difference_type offset, ProxyIterator it)
+    {
+        return it += offset;
+    }
+
+    friend constexpr ProxyIterator operator-(ProxyIterator it, difference_type offset)
+    {
+        return it -= offset;
+    }
+
+    friend constexpr difference_type operator-(ProxyIterator const &lhs, ProxyIterator const &rhs)
+    {
+        return static_cast<difference_type>(lhs.d_index) - static_cast<difference_type>(rhs.d_index);
+    }
+
+    // Iterators into different owners don't compare meaningfully.
+    friend constexpr bool operator==(ProxyIterator const &lhs, ProxyIterator const &rhs)
+    {
+        return lhs.d_index == rhs.d_index;
+    }
+
+    friend constexpr auto operator<=>(ProxyIterator const &lhs, ProxyIterator const &rhs)
+    {
+        return lhs.d_index <=> rhs.d_index;
+    }
+
+    // Moving out of an element yields its value. Owners that return a
+    // reference have it moved from, others return by value anyway.
+    friend constexpr decltype(auto) iter_move(ProxyIterator const &it)
+    {
+        if constexpr (std::is_lvalue_reference<conversion_t>::value)
+            return std::move(static_cast<conversion_t>(*it));
+        else
+            return static_cast<value_type>(*it);
+    }
+
+    friend constexpr void iter_swap(ProxyIterator const &lhs, ProxyIterator const &rhs)
+    {
+        swap(*lhs, *rhs); // LRProxy's swap, by ADL.
+    }
+};
+
+template <typename Owner, typename Index>
+constexpr ProxyIterator<Owner, Index>::ProxyIterator(Owner &owner, Index index)
+    : d_owner(&owner),
+      d_index(index)
+{}
+
+template <typename Owner, typename Index>
+constexpr typename ProxyIterator<Owner, Index>::reference ProxyIterator<Owner, Index>::operator*() const
+{
+    return (*d_owner)[Index(d_index)]; // By value: the proxy mustn't refer to us.
+}
+
+template <typename Owner, typename Index>
+constexpr typename ProxyIterator<Owner, Index>::reference
+ProxyIterator<Owner, Index>::operator[](difference_type offset) const
+{
+    return (*d_owner)[static_cast<Index>(d_index + offset)];
+}
+
+template <typename Owner, typename Index>
+constexpr ProxyIterator<Owner, Index> &ProxyIterator<Owner, Index>::operator++()
+{
+    ++d_index;
+    return *this;
+}
+
+template <typename Owner, typename Index>
+constexpr ProxyIterator<Owner, Index> ProxyIterator<Owner, Index>::operator++(int)
+{
+    ProxyIterator retval(*this);
+    ++d_index;
+    return retval;
+}
+
+template <typename Owner, typename Index>
+constexpr ProxyIterator<Owner, Index> &ProxyIterator<Owner, Index>::operator--()
+{
+    --d_index;
+    return *this;
+}
+
+template <typename Owner, typename Index>
+constexpr ProxyIterator<Owner, Index> ProxyIterator<Owner, Index>::operator--(int)
+{
+    ProxyIterator retval(*this);
+    --d_index;
+    return retval;
+}
+
+template <typename Owner, typename Index>
+constexpr ProxyIterator<Owner, Index> &ProxyIterator<Owner, Index>::operator+=(difference_type offset)
+{
+    d_index = static_cast<Index>(d_index + offset);
+    return *this;
+}
+
+template <typename Owner, typename Index>
+constexpr ProxyIterator<Owner, Index> &ProxyIterator<Owner, Index>::operator-=(difference_type offset)
+{
+    d_index = static_cast<Index>(d_index - offset);
+    return *this;
+}
+
+#endif //proxyiterator_hh_defd
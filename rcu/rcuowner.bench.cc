@@ -0,0 +1,147 @@
+#include "rcuowner.hh"
+#include "../benchmark/benchmark.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Read scaling, from one thread up to all cores, of RcuOwner against a
+// table behind a std::shared_mutex. A writer changes an element and
+// publishes every millisecond meanwhile. Reported is the time per read of
+// all threads together, which drops as long as reads scale.
+
+using namespace std;
+
+namespace
+{
+    constexpr size_t Size = 4096;
+    constexpr size_t ReadsPerThread = size_t(1) << 22;
+
+    // The usual alternative: readers share a lock, writers take it alone.
+    class LockedTable: protected IndexProxifier<LockedTable>
+    {
+        mutable shared_mutex d_mutex;
+        vector<uint64_t> d_values;
+
+    public:
+        LockedTable();
+
+        using IndexProxifier<LockedTable>::operator[];
+
+    private:
+        friend IndexProxifier<LockedTable>;
+
+        uint64_t proxy_return_action(size_t key) const;
+        uint64_t proxy_accept_action(size_t key, uint64_t value);
+    };
+
+    LockedTable::LockedTable()
+        : d_values(Size)
+    {}
+
+    uint64_t LockedTable::proxy_return_action(size_t key) const
+    {
+        shared_lock<shared_mutex> lock(d_mutex);
+        return d_values[key];
+    }
+
+    uint64_t LockedTable::proxy_accept_action(size_t key, uint64_t value)
+    {
+        lock_guard<shared_mutex> lock(d_mutex);
+        return d_values[key] = value;
+    }
+
+    // Runs threads readers, each doing read(key, sum) ReadsPerThread times,
+    // while write(round) runs every millisecond. Returns the seconds taken.
+    template <typename Read, typename Write>
+    double run(size_t threads, Read &&read, Write &&write)
+    {
+        atomic<bool> done{false};
+        thread writer(
+            [&]()
+            {
+                for (uint64_t round = 0; not done; ++round)
+                {
+                    write(round);
+                    this_thread::sleep_for(chrono::milliseconds(1));
+                }
+            });
+
+        auto const start = chrono::steady_clock::now();
+        vector<thread> readers;
+        for (size_t id = 0; id != threads; ++id)
+            readers.emplace_back(
+                [&, id]()
+                {
+                    read(id);
+                });
+        for (thread &reader: readers)
+            reader.join();
+        chrono::duration<double> const took = chrono::steady_clock::now() - start;
+
+        done = true;
+        writer.join();
+        return took.count();
+    }
+}
+
+int main()
+{
+    size_t const cores = max(1u, thread::hardware_concurrency());
+    printf("%zu reads per thread, up to %zu threads\n", ReadsPerThread, cores);
+
+    RcuOwner<vector<uint64_t>> rcu{vector<uint64_t>(Size)};
+    LockedTable locked;
+
+    vector<size_t> counts;  // 1, 2, 4, ... and all cores.
+    for (size_t threads = 1; threads < cores; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(cores);
+
+    for (size_t threads: counts)
+    {
+        double const reads = double(threads) * ReadsPerThread;
+        double const rcuseconds = run(
+            threads,
+            [&](size_t id)
+            {
+                auto reader = rcu.reader();
+                uint64_t sum = 0;
+                for (size_t ix = 0; ix != ReadsPerThread; ++ix)
+                {
+                    sum += rcu[(ix * 7 + id) % Size];
+                    if (ix % 1024 == 0)
+                        reader.quiescent();
+                }
+                keep(sum);
+            },
+            [&](uint64_t round)
+            {
+                rcu[round % Size] = round;
+                rcu.publish();
+            });
+        report(("RcuOwner, threads " + to_string(threads)).c_str(), rcuseconds, reads);
+
+        double const lockedseconds = run(
+            threads,
+            [&](size_t id)
+            {
+                uint64_t sum = 0;
+                for (size_t ix = 0; ix != ReadsPerThread; ++ix)
+                    sum += locked[(ix * 7 + id) % Size];
+                keep(sum);
+            },
+            [&](uint64_t round)
+            {
+                locked[round % Size] = round;
+            });
+        report(("shared_mutex, threads " + to_string(threads)).c_str(), lockedseconds, reads);
+    }
+}
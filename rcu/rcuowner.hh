@@ -0,0 +1,259 @@
+#ifndef rcuowner_hh_defd
+#define rcuowner_hh_defd
+
+#include "../indexproxifier.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+   Read-copy-update owner for tables that are read all the time and written
+   rarely, like routing tables. Table is a copyable container such as a
+   std::vector or std::array, or a map providing at().
+
+       RcuOwner<std::vector<Route>> routes(std::vector<Route>(1024));
+
+       // Reader threads:
+       auto reader = routes.reader();
+       Route route = routes[key];           // One acquire load, no locks.
+       reader.quiescent();                  // Now and then, between reads.
+
+       // Writer:
+       routes[key] = route;                 // Staged in a new version ...
+       routes.publish();                    // ... which replaces the old one.
+
+   Reads always see the published table: writes are staged in a private
+   copy until publish() installs it with a single atomic store. Readers
+   wanting several elements from one version use Reader::snapshot().
+
+   Old versions are reclaimed quiescent-state based: a thread that reads
+   while another publishes must hold a Reader, and call its quiescent()
+   regularly, at points where it holds no references into a snapshot. A
+   version retired by publish() is deleted once every Reader has passed a
+   quiescent state since, or has gone. A Reader that never calls quiescent()
+   keeps old versions alive, but doesn't block anything.
+
+   Writes and publish() are serialized by a mutex; they may come from any
+   thread.
+*/
+template <typename Table, typename Key = std::size_t>
+class RcuOwner: protected IndexProxifier<RcuOwner<Table, Key>>
+{
+    // Grace period counter per Reader, on its own cache line.
+    struct alignas(64) ReaderState
+    {
+        std::atomic<uint64_t> seen;
+    };
+
+    struct Retired
+    {
+        Table const *table;
+        uint64_t epoch; // Free when all Readers have seen this epoch.
+    };
+
+    std::atomic<Table const *> d_current;
+    std::atomic<uint64_t> d_epoch{1};
+
+    std::mutex d_writemutex;              // Guards d_staged and d_retired.
+    std::unique_ptr<Table> d_staged;
+    std::vector<Retired> d_retired;
+
+    std::mutex d_readersmutex;            // Guards d_readers.
+    std::list<ReaderState> d_readers;     // Stable addresses.
+
+public:
+    class Reader;
+
+    static decltype(auto) lookup(Table const &table, Key const &key);
+
+    typedef typename std::remove_cvref<decltype(lookup(std::declval<Table const &>(), std::declval<Key const &>()))>::type value_type;
+
+    explicit RcuOwner(Table table = Table{});
+    RcuOwner(RcuOwner const &other) = delete;
+    ~RcuOwner();
+
+    // Registers the calling thread as a reader, until the Reader is destroyed.
+    Reader reader();
+
+    // Installs the staged writes, if any, as the new version.
+    void publish();
+
+    // Deletes the retired versions no Reader can still see. Returns the
+    // number of retired versions left. publish() calls this too.
+    std::size_t reclaim();
+
+    using IndexProxifier<RcuOwner>::operator[];
+
+private:
+    friend IndexProxifier<RcuOwner>;
+
+    value_type proxy_return_action(Key const &key) const;
+    value_type proxy_accept_action(Key const &key, value_type const &value);
+
+    std::size_t reclaim_retired(); // With d_writemutex locked.
+    void unregister(ReaderState &state);
+};
+
+template <typename Table, typename Key>
+class RcuOwner<Table, Key>::Reader
+{
+    RcuOwner *d_owner;
+    ReaderState *d_state;
+
+    friend RcuOwner;
+
+    Reader(RcuOwner &owner, ReaderState &state);
+
+public:
+    Reader(Reader &&tmp) noexcept;
+    Reader(Reader const &other) = delete;
+    ~Reader();
+
+    // The current version, valid until the next quiescent().
+    Table const &snapshot() const;
+
+    // Declares that this thread holds no references into snapshots.
+    void quiescent();
+};
+
+template <typename Table, typename Key>
+RcuOwner<Table, Key>::Reader::Reader(RcuOwner &owner, ReaderState &state)
+    : d_owner(&owner),
+      d_state(&state)
+{}
+
+template <typename Table, typename Key>
+RcuOwner<Table, Key>::Reader::Reader(Reader &&tmp) noexcept
+    : d_owner(std::exchange(tmp.d_owner, nullptr)),
+      d_state(tmp.d_state)
+{}
+
+template <typename Table, typename Key>
+RcuOwner<Table, Key>::Reader::~Reader()
+{
+    if (d_owner)
+        d_owner->unregister(*d_state);
+}
+
+template <typename Table, typename Key>
+Table const &RcuOwner<Table, Key>::Reader::snapshot() const
+{
+    return *d_owner->d_current.load(std::memory_order_acquire);
+}
+
+template <typename Table, typename Key>
+void RcuOwner<Table, Key>::Reader::quiescent()
+{
+    d_state->seen.store(d_owner->d_epoch.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+// operator[] const for sequences, at() for maps (which lack operator[] const).
+template <typename Table, typename Key>
+decltype(auto) RcuOwner<Table, Key>::lookup(Table const &table, Key const &key)
+{
+    if constexpr (requires { table[key]; })
+                     return table[key];
+    else
+        return table.at(key);
+}
+
+template <typename Table, typename Key>
+RcuOwner<Table, Key>::RcuOwner(Table table)
+    : d_current(new Table(std::move(table)))
+{}
+
+template <typename Table, typename Key>
+RcuOwner<Table, Key>::~RcuOwner()
+{
+    delete d_current.load();
+    for (Retired const &retired: d_retired)
+        delete retired.table;
+}
+
+template <typename Table, typename Key>
+typename RcuOwner<Table, Key>::Reader RcuOwner<Table, Key>::reader()
+{
+    std::lock_guard<std::mutex> lock(d_readersmutex);
+    ReaderState &state = d_readers.emplace_back();
+    state.seen.store(d_epoch.load(std::memory_order_acquire), std::memory_order_release);
+    return Reader(*this, state);
+}
+
+template <typename Table, typename Key>
+void RcuOwner<Table, Key>::unregister(ReaderState &state)
+{
+    std::lock_guard<std::mutex> lock(d_readersmutex);
+    d_readers.remove_if(
+        [&](ReaderState const &candidate)
+        {
+            return &candidate == &state;
+        });
+}
+
+template <typename Table, typename Key>
+void RcuOwner<Table, Key>::publish()
+{
+    std::lock_guard<std::mutex> lock(d_writemutex);
+    if (not d_staged)
+        return;
+    Table const *old = d_current.exchange(d_staged.release(), std::memory_order_acq_rel);
+    // Readers that see the new epoch also see the new version.
+    uint64_t const epoch = d_epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+    d_retired.push_back(Retired{old, epoch});
+
+    reclaim_retired();
+}
+
+template <typename Table, typename Key>
+std::size_t RcuOwner<Table, Key>::reclaim()
+{
+    std::lock_guard<std::mutex> lock(d_writemutex);
+    return reclaim_retired();
+}
+
+// A retired version can go once all Readers have seen its epoch.
+template <typename Table, typename Key>
+std::size_t RcuOwner<Table, Key>::reclaim_retired()
+{
+    std::lock_guard<std::mutex> lock(d_readersmutex);
+    uint64_t oldest = d_epoch.load(std::memory_order_acquire);
+    for (ReaderState const &state: d_readers)
+        oldest = std::min(oldest, state.seen.load(std::memory_order_acquire));
+    std::erase_if(d_retired,
+        [&](Retired const &retired)
+        {
+            if (retired.epoch > oldest)
+                return false;
+            delete retired.table;
+            return true;
+        });
+    return d_retired.size();
+}
+
+// The hot path: a single acquire load, then a plain read.
+template <typename Table, typename Key>
+typename RcuOwner<Table, Key>::value_type RcuOwner<Table, Key>::proxy_return_action(Key const &key) const
+{
+    return lookup(*d_current.load(std::memory_order_acquire), key);
+}
+
+template <typename Table, typename Key>
+typename RcuOwner<Table, Key>::value_type
+RcuOwner<Table, Key>::proxy_accept_action(Key const &key, value_type const &value)
+{
+    std::lock_guard<std::mutex> lock(d_writemutex);
+    if (not d_staged)
+        d_staged = std::make_unique<Table>(*d_current.load(std::memory_order_acquire));
+    (*d_staged)[key] = value;
+    return value;
+}
+
+#endif //rcuowner_hh_defd
@@ -0,0 +1,109 @@
+#include "rcuowner.hh"
+#include "../../unittest/unittest.hh"
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+    test("Writes are invisible until published.",
+         []()
+         {
+             RcuOwner<vector<int>> table(vector<int>{1, 2, 3});
+             table[1] = 20;
+             int before = table[1];
+             table.publish();
+             int after = table[1];
+             return before == 2 && after == 20 && table[2] == 3;
+         });
+
+    test("Maps are read through at().",
+         []()
+         {
+             RcuOwner<map<string, int>, string> routes(map<string, int>{{"a", 1}});
+             routes[string("b")] = 2;
+             routes.publish();
+             RcuOwner<map<string, int>, string> const &reading = routes;
+             return reading[string("a")] == 1 && reading[string("b")] == 2;
+         });
+
+    test("Retired versions wait for every reader's quiescent state.",
+         []()
+         {
+             RcuOwner<vector<int>> table(vector<int>(4));
+             auto reader = table.reader();
+             vector<int> const &old = reader.snapshot();
+             table[0] = 1;
+             table.publish();
+             size_t pending = table.reclaim();
+             bool stillthere = old[0] == 0; // Old version not deleted yet.
+             reader.quiescent();
+             return pending == 1
+                 && stillthere
+                 && reader.snapshot()[0] == 1
+                 && table.reclaim() == 0;
+         });
+
+    test("A destroyed reader doesn't hold back reclamation.",
+         []()
+         {
+             RcuOwner<vector<int>> table(vector<int>(4));
+             {
+                 auto reader = table.reader();
+                 table[0] = 1;
+                 table.publish();
+             }
+             return table.reclaim() == 0;
+         });
+
+    test("Readers see whole versions while a writer publishes.",
+         []()
+         {
+             enum { Size = 64, Versions = 200, Readers = 3 };
+             RcuOwner<vector<int>> table{vector<int>(Size)};
+             atomic<bool> done{false};
+             atomic<bool> consistent{true};
+
+             vector<thread> readers;
+             for (int id = 0; id != Readers; ++id)
+                 readers.emplace_back(
+                     [&]()
+                     {
+                         auto reader = table.reader();
+                         int last = 0;
+                         while (not done)
+                         {
+                             vector<int> const &snapshot = reader.snapshot();
+                             for (int value: snapshot)
+                                 if (value != snapshot[0])
+                                     consistent = false;
+                             int single = table[Size - 1];
+                             if (snapshot[0] < last || single < snapshot[0])
+                                 consistent = false; // Versions only go forward.
+                             last = snapshot[0];
+                             reader.quiescent();
+                         }
+                     });
+
+             for (int version = 1; version <= Versions; ++version)
+             {
+                 for (size_t key = 0; key != Size; ++key)
+                     table[key] = version;
+                 table.publish();
+             }
+             done = true;
+             for (thread &reader: readers)
+                 reader.join();
+
+             return consistent
+                 && table[0] == Versions
+                 && table.reclaim() == 0;
+         });
+
+    return TestCount::result();
+}
@@ -0,0 +1,278 @@
+#ifndef registerblock_hh_defd
+#define registerblock_hh_defd
+
+#include "../indexproxifier.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+/**
+   Bit field of a register block: bits offset up to offset + width of word
+   number word.
+*/
+struct RegisterField
+{
+    std::size_t word;
+    unsigned offset;
+    unsigned width;
+};
+
+/**
+   Overlay for a block of memory-mapped registers, whose fields are indexed
+   by an enum:
+
+       struct Uart
+       {
+           typedef uint32_t Word;
+           enum class Field { Enable, Parity, Baud };
+           static constexpr RegisterField fields[] = {{0, 0, 1}, {0, 1, 2}, {1, 0, 20}};
+       };
+
+       auto &uart = RegisterBlock<Uart>::at(0x40001000);
+       uart[Uart::Field::Baud] = 9600;
+       uart.modify([](auto &&edit)
+                   {
+                       edit[Uart::Field::Enable] = 1;
+                       edit[Uart::Field::Parity] = 2;
+                   });
+
+   The block is volatile, so its proxies come from IndexProxifier's volatile
+   operator[]s. Reading a field is one volatile load; writing one is one
+   volatile load and one volatile store of its word. modify() coalesces all
+   field writes into one load and one store per word touched. Compile-time
+   keys (uart[ip::key<Uart::Field::Baud>]) have their masks computed at
+   compile time.
+
+   Layout must provide the unsigned Word type and the fields array, in the
+   order of the enum Field. Cell is the type of the words in memory; unit
+   tests use one that counts loads and stores.
+*/
+template <typename Layout, typename Cell = typename Layout::Word>
+class RegisterBlock: protected IndexProxifier<RegisterBlock<Layout, Cell>>
+{
+public:
+    typedef typename Layout::Word Word;
+    typedef typename Layout::Field Field;
+
+private:
+    static_assert(std::is_unsigned<Word>::value, "Register words must be unsigned.");
+
+    enum : std::size_t
+    {
+        WordBits = std::numeric_limits<Word>::digits,
+    };
+
+    static constexpr std::size_t word_count();
+    static constexpr bool valid();
+
+    static_assert(valid(), "Register fields must lie within their words.");
+
+    enum : std::size_t
+    {
+        Words = word_count(),
+    };
+
+    class Edit;
+
+    Cell d_words[Words] = {};
+
+public:
+    RegisterBlock() = default;
+    RegisterBlock(RegisterBlock const &other) = delete;
+
+    static RegisterBlock volatile &at(std::uintptr_t address);
+
+    // Calls function(edit), where edit[field] reads and writes a copy of the
+    // words, then stores each word written to.
+    template <typename Function>
+    void modify(Function &&function) volatile;
+
+    using IndexProxifier<RegisterBlock>::operator[];
+
+private:
+    friend IndexProxifier<RegisterBlock>;
+
+    Word proxy_return_action(Field field) const volatile;
+    Word proxy_accept_action(Field field, Word value) volatile;
+
+    template <Field Key>
+    Word proxy_return_action() const volatile;
+
+    template <Field Key>
+    Word proxy_accept_action(Word value) volatile;
+
+    static constexpr RegisterField layout(Field field);
+    static constexpr Word mask(RegisterField field);
+    static constexpr Word extract(Word word, RegisterField field);
+    static constexpr Word insert(Word word, RegisterField field, Word value);
+};
+
+// Copy of the words of a block during modify(). Loads each word on first
+// use, and remembers which to store.
+template <typename Layout, typename Cell>
+class RegisterBlock<Layout, Cell>::Edit: protected IndexProxifier<Edit>
+{
+    RegisterBlock volatile &d_block;
+    Word d_words[Words] = {};
+    bool d_loaded[Words] = {};
+    bool d_written[Words] = {};
+
+public:
+    explicit Edit(RegisterBlock volatile &block);
+
+    void store() const;
+
+    using IndexProxifier<Edit>::operator[];
+
+private:
+    friend IndexProxifier<Edit>;
+
+    Word proxy_return_action(Field field);
+    Word proxy_accept_action(Field field, Word value);
+
+    Word &word(std::size_t index);
+};
+
+template <typename Layout, typename Cell>
+constexpr std::size_t RegisterBlock<Layout, Cell>::word_count()
+{
+    std::size_t count = 0;
+    for (RegisterField const &field: Layout::fields)
+        if (field.word >= count)
+            count = field.word + 1;
+    return count;
+}
+
+template <typename Layout, typename Cell>
+constexpr bool RegisterBlock<Layout, Cell>::valid()
+{
+    for (RegisterField const &field: Layout::fields)
+        if (field.width == 0 || field.width > WordBits || field.offset > WordBits - field.width)
+            return false;
+    return sizeof(Cell) == sizeof(Word);
+}
+
+template <typename Layout, typename Cell>
+RegisterBlock<Layout, Cell> volatile &RegisterBlock<Layout, Cell>::at(std::uintptr_t address)
+{
+    static_assert(std::is_standard_layout<RegisterBlock>::value && sizeof(RegisterBlock) == Words * sizeof(Word),
+                  "A RegisterBlock must consist of just its words.");
+    return *reinterpret_cast<RegisterBlock volatile *>(address);
+}
+
+template <typename Layout, typename Cell>
+template <typename Function>
+void RegisterBlock<Layout, Cell>::modify(Function &&function) volatile
+{
+    Edit edit(*this);
+    std::forward<Function>(function)(edit);
+    edit.store();
+}
+
+template <typename Layout, typename Cell>
+typename RegisterBlock<Layout, Cell>::Word RegisterBlock<Layout, Cell>::proxy_return_action(Field field) const volatile
+{
+    RegisterField const where = layout(field);
+    Word const word = d_words[where.word];
+    return extract(word, where);
+}
+
+template <typename Layout, typename Cell>
+typename RegisterBlock<Layout, Cell>::Word RegisterBlock<Layout, Cell>::proxy_accept_action(Field field, Word value) volatile
+{
+    RegisterField const where = layout(field);
+    Word const word = insert(d_words[where.word], where, value);
+    d_words[where.word] = word;
+    return extract(word, where);
+}
+
+template <typename Layout, typename Cell>
+template <typename RegisterBlock<Layout, Cell>::Field Key>
+typename RegisterBlock<Layout, Cell>::Word RegisterBlock<Layout, Cell>::proxy_return_action() const volatile
+{
+    constexpr RegisterField where = layout(Key);
+    Word const word = d_words[where.word];
+    return extract(word, where);
+}
+
+template <typename Layout, typename Cell>
+template <typename RegisterBlock<Layout, Cell>::Field Key>
+typename RegisterBlock<Layout, Cell>::Word RegisterBlock<Layout, Cell>::proxy_accept_action(Word value) volatile
+{
+    constexpr RegisterField where = layout(Key);
+    Word const word = insert(d_words[where.word], where, value);
+    d_words[where.word] = word;
+    return extract(word, where);
+}
+
+template <typename Layout, typename Cell>
+constexpr RegisterField RegisterBlock<Layout, Cell>::layout(Field field)
+{
+    return Layout::fields[static_cast<std::size_t>(field)];
+}
+
+template <typename Layout, typename Cell>
+constexpr typename RegisterBlock<Layout, Cell>::Word RegisterBlock<Layout, Cell>::mask(RegisterField field)
+{
+    Word const ones = field.width == WordBits ? ~Word(0) : Word((Word(1) << field.width) - 1);
+    return Word(ones << field.offset);
+}
+
+template <typename Layout, typename Cell>
+constexpr typename RegisterBlock<Layout, Cell>::Word RegisterBlock<Layout, Cell>::extract(Word word, RegisterField field)
+{
+    return Word((word & mask(field)) >> field.offset);
+}
+
+// Bits of value beyond the field's width are dropped.
+template <typename Layout, typename Cell>
+constexpr typename RegisterBlock<Layout, Cell>::Word RegisterBlock<Layout, Cell>::insert(Word word, RegisterField field, Word value)
+{
+    return Word((word & ~mask(field)) | (Word(value << field.offset) & mask(field)));
+}
+
+template <typename Layout, typename Cell>
+RegisterBlock<Layout, Cell>::Edit::Edit(RegisterBlock volatile &block)
+    : d_block(block)
+{}
+
+template <typename Layout, typename Cell>
+void RegisterBlock<Layout, Cell>::Edit::store() const
+{
+    for (std::size_t index = 0; index != Words; ++index)
+        if (d_written[index])
+            d_block.d_words[index] = d_words[index];
+}
+
+template <typename Layout, typename Cell>
+typename RegisterBlock<Layout, Cell>::Word RegisterBlock<Layout, Cell>::Edit::proxy_return_action(Field field)
+{
+    RegisterField const where = layout(field);
+    return extract(word(where.word), where);
+}
+
+template <typename Layout, typename Cell>
+typename RegisterBlock<Layout, Cell>::Word RegisterBlock<Layout, Cell>::Edit::proxy_accept_action(Field field, Word value)
+{
+    RegisterField const where = layout(field);
+    Word &target = word(where.word);
+    target = insert(target, where, value);
+    d_written[where.word] = true;
+    return extract(target, where);
+}
+
+template <typename Layout, typename Cell>
+typename RegisterBlock<Layout, Cell>::Word &RegisterBlock<Layout, Cell>::Edit::word(std::size_t index)
+{
+    if (not d_loaded[index])
+    {
+        d_words[index] = d_block.d_words[index];
+        d_loaded[index] = true;
+    }
+    return d_words[index];
+}
+
+#endif //registerblock_hh_defd
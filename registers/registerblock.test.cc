@@ -0,0 +1,135 @@
+#include "registerblock.hh"
+#include "../../unittest/unittest.hh"
+
+#include <cstdint>
+
+using namespace std;
+
+namespace
+{
+    struct Uart
+    {
+        typedef uint32_t Word;
+        enum class Field
+        {
+            Enable,
+            Parity,
+            Speed,
+            Status,
+        };
+        static constexpr RegisterField fields[] = {{0, 0, 1}, {0, 1, 2}, {0, 8, 16}, {1, 0, 32}};
+    };
+
+    // Register word that counts volatile loads and stores.
+    struct Traced
+    {
+        uint32_t raw;
+
+        static inline int loads = 0;
+        static inline int stores = 0;
+
+        operator uint32_t() const volatile
+        {
+            ++loads;
+            return raw;
+        }
+
+        void operator=(uint32_t value) volatile
+        {
+            ++stores;
+            raw = value;
+        }
+
+        static void reset()
+        {
+            loads = 0;
+            stores = 0;
+        }
+    };
+
+    typedef RegisterBlock<Uart, Traced> TracedUart;
+}
+
+int main()
+{
+    test("Writing a field is one load and one store, and keeps the other fields.",
+         []()
+         {
+             TracedUart volatile uart;
+             uart[Uart::Field::Speed] = 0xffffu;
+             uart[Uart::Field::Parity] = 2u;
+             Traced::reset();
+             uart[Uart::Field::Enable] = 1u;
+             int loads = Traced::loads;
+             int stores = Traced::stores;
+             return loads == 1 && stores == 1
+                 && uart[Uart::Field::Enable] == 1u
+                 && uart[Uart::Field::Parity] == 2u
+                 && uart[Uart::Field::Speed] == 0xffffu;
+         });
+
+    test("Reading a field is one load.",
+         []()
+         {
+             TracedUart volatile uart;
+             uart[Uart::Field::Status] = 0xdeadbeefu;
+             TracedUart const volatile &reading = uart;
+             Traced::reset();
+             uint32_t status = reading[Uart::Field::Status];
+             return status == 0xdeadbeefu
+                 && Traced::loads == 1
+                 && Traced::stores == 0;
+         });
+
+    test("modify() loads and stores each word it writes to once.",
+         []()
+         {
+             TracedUart volatile uart;
+             uart[Uart::Field::Status] = 7u;
+             Traced::reset();
+             uint32_t parity = 0;
+             uart.modify(
+                 [&](auto &&edit)
+                 {
+                     edit[Uart::Field::Enable] = 1u;
+                     edit[Uart::Field::Parity] = 3u;
+                     edit[Uart::Field::Speed] = 115200u; // Keeps 16 bits.
+                     parity = edit[Uart::Field::Parity]; // What will be stored.
+                 });
+             int loads = Traced::loads;
+             int stores = Traced::stores;
+             return loads == 1 && stores == 1
+                 && parity == 3u
+                 && uart[Uart::Field::Enable] == 1u
+                 && uart[Uart::Field::Parity] == 3u
+                 && uart[Uart::Field::Speed] == (115200u & 0xffffu)
+                 && uart[Uart::Field::Status] == 7u;
+         });
+
+    test("Compile-time keys access the same fields.",
+         []()
+         {
+             TracedUart volatile uart;
+             Traced::reset();
+             uart[ip::key<Uart::Field::Parity>] = 5u; // Keeps 2 bits.
+             int loads = Traced::loads;
+             int stores = Traced::stores;
+             return loads == 1 && stores == 1
+                 && uart[Uart::Field::Parity] == 1u
+                 && uart[ip::key<Uart::Field::Parity>] == 1u
+                 && uart[Uart::Field::Enable] == 0u;
+         });
+
+    test("at() overlays a block on memory.",
+         []()
+         {
+             static uint32_t volatile memory[2] = {0x00ab0000u, 42u};
+             auto &uart = RegisterBlock<Uart>::at(reinterpret_cast<uintptr_t>(memory));
+             uart[Uart::Field::Enable] = 1u;
+             return uart[Uart::Field::Speed] == 0xab00u
+                 && uart[Uart::Field::Status] == 42u
+                 && memory[0] == 0x00ab0001u;
+         });
+
+    return TestCount::result();
+}
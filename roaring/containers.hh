@@ -0,0 +1,355 @@
+#ifndef containers_hh_defd
+#define containers_hh_defd
+
+#include "../bitset/bitsetkernels.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <variant>
+#include <vector>
+
+/**
+   The three kinds of container of RoaringBitmap, each holding the low 16
+   bits of the values in one chunk of 65536:
+   - ArrayContainer: sorted values, for at most 4096 of them,
+   - BitmapContainer: 65536 bits, for more,
+   - RunContainer: sorted runs of consecutive values, for long runs.
+   Writes switch between arrays and bitmaps by cardinality; optimize()
+   turns a container into runs if those take less memory.
+*/
+namespace roaring_detail
+{
+    enum : std::size_t
+    {
+        ChunkSize = 65536,
+        ArrayMax = 4096,            // More values take less room as a bitmap.
+        BitmapWords = ChunkSize / 64,
+        RunMax = 2048,              // More runs take more room than a bitmap.
+    };
+
+    struct ArrayContainer
+    {
+        std::vector<uint16_t> values;
+    };
+
+    struct BitmapContainer
+    {
+        std::vector<uint64_t> words = std::vector<uint64_t>(BitmapWords);
+        std::size_t cardinality = 0;
+
+        bool contains(uint16_t value) const
+        {
+            return words[value / 64] >> value % 64 & 1;
+        }
+
+        void set(uint16_t value)
+        {
+            uint64_t &word = words[value / 64];
+            cardinality += (~word >> value % 64) & 1;
+            word |= uint64_t(1) << value % 64;
+        }
+    };
+
+    // Values start up to and including start + length.
+    struct Run
+    {
+        uint16_t start;
+        uint16_t length;
+
+        unsigned end() const
+        {
+            return unsigned(start) + length;
+        }
+    };
+
+    struct RunContainer
+    {
+        std::vector<Run> runs;
+    };
+
+    typedef std::variant<ArrayContainer, BitmapContainer, RunContainer> Container;
+
+    inline std::size_t cardinality(Container const &container)
+    {
+        if (auto array = std::get_if<ArrayContainer>(&container))
+            return array->values.size();
+        if (auto bitmap = std::get_if<BitmapContainer>(&container))
+            return bitmap->cardinality;
+        std::size_t total = 0;
+        for (Run const &run: std::get<RunContainer>(container).runs)
+            total += run.length + 1u;
+        return total;
+    }
+
+    inline std::size_t bytes(Container const &container)
+    {
+        if (auto array = std::get_if<ArrayContainer>(&container))
+            return array->values.size() * sizeof(uint16_t);
+        if (std::holds_alternative<BitmapContainer>(container))
+            return BitmapWords * sizeof(uint64_t);
+        return std::get<RunContainer>(container).runs.size() * sizeof(Run);
+    }
+
+    // The run holding value, or the one before it, or runs.end().
+    inline std::vector<Run>::const_iterator find_run(std::vector<Run> const &runs, uint16_t value)
+    {
+        auto after = std::upper_bound(runs.begin(), runs.end(), value,
+                                      [](uint16_t value, Run const &run) { return value < run.start; });
+        return after == runs.begin() ? runs.end() : after - 1;
+    }
+
+    inline bool contains(Container const &container, uint16_t value)
+    {
+        if (auto array = std::get_if<ArrayContainer>(&container))
+            return std::binary_search(array->values.begin(), array->values.end(), value);
+        if (auto bitmap = std::get_if<BitmapContainer>(&container))
+            return bitmap->contains(value);
+        auto const &runs = std::get<RunContainer>(container).runs;
+        auto run = find_run(runs, value);
+        return run != runs.end() && value <= run->end();
+    }
+
+    template <typename Function>
+    void for_each(Container const &container, Function &&function)
+    {
+        if (auto array = std::get_if<ArrayContainer>(&container))
+        {
+            for (uint16_t value: array->values)
+                function(value);
+        }
+        else if (auto bitmap = std::get_if<BitmapContainer>(&container))
+        {
+            for (std::size_t word = 0; word != BitmapWords; ++word)
+                for (uint64_t bits = bitmap->words[word]; bits != 0; bits &= bits - 1)
+                    function(static_cast<uint16_t>(word * 64 + std::countr_zero(bits)));
+        }
+        else
+            for (Run const &run: std::get<RunContainer>(container).runs)
+                for (unsigned value = run.start; value <= run.end(); ++value)
+                    function(static_cast<uint16_t>(value));
+    }
+
+    inline BitmapContainer to_bitmap(Container const &container)
+    {
+        if (auto bitmap = std::get_if<BitmapContainer>(&container))
+            return *bitmap;
+        BitmapContainer result;
+        for_each(container, [&](uint16_t value) { result.set(value); });
+        return result;
+    }
+
+    inline ArrayContainer to_array(Container const &container)
+    {
+        ArrayContainer result;
+        result.values.reserve(cardinality(container));
+        for_each(container, [&](uint16_t value) { result.values.push_back(value); });
+        return result;
+    }
+
+    // Arrays of more than ArrayMax values become bitmaps, bitmaps of at
+    // most ArrayMax values arrays, and runs beyond RunMax either.
+    inline void normalize(Container &container)
+    {
+        if (auto array = std::get_if<ArrayContainer>(&container))
+        {
+            if (array->values.size() > ArrayMax)
+                container = to_bitmap(container);
+        }
+        else if (auto bitmap = std::get_if<BitmapContainer>(&container))
+        {
+            if (bitmap->cardinality <= ArrayMax)
+                container = to_array(container);
+        }
+        else if (std::get<RunContainer>(container).runs.size() > RunMax)
+        {
+            container = to_bitmap(container);
+            normalize(container);
+        }
+    }
+
+    // Whichever of array, bitmap and runs takes least room.
+    inline void optimize(Container &container)
+    {
+        RunContainer runs;
+        for_each(container,
+                 [&](uint16_t value)
+                 {
+                     if (not runs.runs.empty() && runs.runs.back().end() + 1 == value)
+                         ++runs.runs.back().length;
+                     else
+                         runs.runs.push_back(Run{value, 0});
+                 });
+        std::size_t const count = cardinality(container);
+        std::size_t const asruns = runs.runs.size() * sizeof(Run);
+        if (asruns < std::min(count * sizeof(uint16_t), BitmapWords * sizeof(uint64_t)))
+            container = std::move(runs);
+        else if (count <= ArrayMax)
+            container = to_array(container);
+        else
+            container = to_bitmap(container);
+    }
+
+    // Returns whether value was new.
+    inline bool add(Container &container, uint16_t value)
+    {
+        if (auto array = std::get_if<ArrayContainer>(&container))
+        {
+            auto at = std::lower_bound(array->values.begin(), array->values.end(), value);
+            if (at != array->values.end() && *at == value)
+                return false;
+            array->values.insert(at, value);
+        }
+        else if (auto bitmap = std::get_if<BitmapContainer>(&container))
+        {
+            if (bitmap->contains(value))
+                return false;
+            bitmap->set(value);
+        }
+        else
+        {
+            auto &runs = std::get<RunContainer>(container).runs;
+            auto before = find_run(runs, value);
+            if (before != runs.end() && value <= before->end())
+                return false;
+            auto after = before == runs.end() ? runs.begin() : before + 1;
+            bool const joinsbefore = before != runs.end() && before->end() + 1 == value;
+            bool const joinsafter = after != runs.end() && value + 1u == after->start;
+            std::size_t const ix = after - runs.begin();
+            if (joinsbefore && joinsafter)
+            {
+                runs[ix - 1].length += runs[ix].length + 2;
+                runs.erase(runs.begin() + ix);
+            }
+            else if (joinsbefore)
+                ++runs[ix - 1].length;
+            else if (joinsafter)
+            {
+                --runs[ix].start;
+                ++runs[ix].length;
+            }
+            else
+                runs.insert(runs.begin() + ix, Run{value, 0});
+        }
+        normalize(container);
+        return true;
+    }
+
+    // Returns whether value was there.
+    inline bool remove(Container &container, uint16_t value)
+    {
+        if (auto array = std::get_if<ArrayContainer>(&container))
+        {
+            auto at = std::lower_bound(array->values.begin(), array->values.end(), value);
+            if (at == array->values.end() || *at != value)
+                return false;
+            array->values.erase(at);
+        }
+        else if (auto bitmap = std::get_if<BitmapContainer>(&container))
+        {
+            if (not bitmap->contains(value))
+                return false;
+            bitmap->words[value / 64] &= ~(uint64_t(1) << value % 64);
+            --bitmap->cardinality;
+        }
+        else
+        {
+            auto &runs = std::get<RunContainer>(container).runs;
+            auto found = find_run(runs, value);
+            if (found == runs.end() || value > found->end())
+                return false;
+            std::size_t const ix = found - runs.begin();
+            Run &run = runs[ix];
+            if (run.length == 0)
+                runs.erase(runs.begin() + ix);
+            else if (value == run.start)
+            {
+                ++run.start;
+                --run.length;
+            }
+            else if (value == run.end())
+                --run.length;
+            else // Split.
+            {
+                Run const tail{static_cast<uint16_t>(value + 1), static_cast<uint16_t>(run.end() - value - 1)};
+                run.length = value - run.start - 1;
+                runs.insert(runs.begin() + ix + 1, tail);
+            }
+        }
+        normalize(container);
+        return true;
+    }
+
+    inline Container unite(Container const &lhs, Container const &rhs)
+    {
+        auto larray = std::get_if<ArrayContainer>(&lhs);
+        auto rarray = std::get_if<ArrayContainer>(&rhs);
+        Container result;
+        if (larray && rarray)
+        {
+            ArrayContainer merged;
+            std::set_union(larray->values.begin(), larray->values.end(),
+                           rarray->values.begin(), rarray->values.end(),
+                           std::back_inserter(merged.values));
+            result = std::move(merged);
+        }
+        else
+        {
+            // Into (a copy of) a bitmap operand, if there is one.
+            bool const intoright = std::holds_alternative<BitmapContainer>(rhs);
+            BitmapContainer bitmap = to_bitmap(intoright ? rhs : lhs);
+            Container const &other = intoright ? lhs : rhs;
+            if (auto otherbitmap = std::get_if<BitmapContainer>(&other))
+            {
+                BitsetKernels const &kernels = BitsetKernels::best();
+                kernels.or_words(bitmap.words.data(), otherbitmap->words.data(), BitmapWords);
+                bitmap.cardinality = kernels.popcount(bitmap.words.data(), BitmapWords);
+            }
+            else
+                for_each(other, [&](uint16_t value) { bitmap.set(value); });
+            result = std::move(bitmap);
+        }
+        normalize(result);
+        return result;
+    }
+
+    inline Container intersect(Container const &lhs, Container const &rhs)
+    {
+        auto larray = std::get_if<ArrayContainer>(&lhs);
+        auto rarray = std::get_if<ArrayContainer>(&rhs);
+        Container result;
+        if (larray && rarray)
+        {
+            ArrayContainer common;
+            std::set_intersection(larray->values.begin(), larray->values.end(),
+                                  rarray->values.begin(), rarray->values.end(),
+                                  std::back_inserter(common.values));
+            result = std::move(common);
+        }
+        else if (larray || rarray) // Keep the array's values found in the other.
+        {
+            ArrayContainer const &array = larray ? *larray : *rarray;
+            Container const &other = larray ? rhs : lhs;
+            ArrayContainer common;
+            for (uint16_t value: array.values)
+                if (contains(other, value))
+                    common.values.push_back(value);
+            result = std::move(common);
+        }
+        else
+        {
+            BitmapContainer bitmap = to_bitmap(lhs);
+            BitmapContainer const other = to_bitmap(rhs);
+            BitsetKernels const &kernels = BitsetKernels::best();
+            kernels.and_words(bitmap.words.data(), other.words.data(), BitmapWords);
+            bitmap.cardinality = kernels.popcount(bitmap.words.data(), BitmapWords);
+            result = std::move(bitmap);
+        }
+        normalize(result);
+        return result;
+    }
+}
+
+#endif //containers_hh_defd
@@ -0,0 +1,323 @@
+#ifndef roaringbitmap_hh_defd
+#define roaringbitmap_hh_defd
+
+#include "../indexproxifier.hh"
+#include "containers.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+/**
+   Compressed set of 32-bit values, as bitmap[v] = true and bool b =
+   bitmap[v], after Roaring: the values are split in chunks of 65536 by
+   their high 16 bits, and each chunk that holds any is kept in whichever
+   container suits it (see containers.hh):
+
+       RoaringBitmap lhs{1, 2, 70000}, rhs;
+       rhs.add_range(0, 1 << 20);  // 16 chunks of a single run each.
+       lhs &= rhs;
+       lhs.cardinality();          // 3, summed over the containers.
+
+   Chunks switch between arrays and bitmaps as writes cross 4096 values.
+   optimize() turns chunks into runs where that is smaller; add_range()
+   makes runs from the start. Union and intersection go chunk by chunk,
+   merging sorted arrays, probing an array against the other container, or
+   combining whole bitmaps with BitsetKernels::best().
+*/
+class RoaringBitmap: protected IndexProxifier<RoaringBitmap>
+{
+    typedef roaring_detail::Container Container;
+
+    std::vector<uint16_t> d_keys;           // Sorted high 16 bits, ...
+    std::vector<Container> d_containers;    // ... and their chunks.
+
+public:
+    enum class Kind
+    {
+        None,
+        Array,
+        Bitmap,
+        Runs,
+    };
+
+    RoaringBitmap() = default;
+    RoaringBitmap(std::initializer_list<uint32_t> values);
+
+    bool contains(uint32_t value) const;
+    bool add(uint32_t value);               // Whether value was new.
+    bool remove(uint32_t value);            // Whether value was there.
+    void add_range(uint64_t first, uint64_t last); // [first, last).
+    void clear();
+
+    std::size_t cardinality() const;
+    bool empty() const;
+    std::size_t bytes() const;              // Of the containers.
+    std::size_t chunks() const;
+    Kind kind(uint32_t value) const;        // Of value's chunk.
+
+    void optimize();
+
+    // Calls function(value) for every value, in order.
+    template <typename Function>
+    void for_each(Function &&function) const;
+
+    RoaringBitmap &operator|=(RoaringBitmap const &other);
+    RoaringBitmap &operator&=(RoaringBitmap const &other);
+
+    friend RoaringBitmap operator|(RoaringBitmap const &lhs, RoaringBitmap const &rhs);
+    friend RoaringBitmap operator&(RoaringBitmap const &lhs, RoaringBitmap const &rhs);
+    friend bool operator==(RoaringBitmap const &lhs, RoaringBitmap const &rhs);
+
+    using IndexProxifier<RoaringBitmap>::operator[];
+
+private:
+    friend IndexProxifier<RoaringBitmap>;
+
+    bool proxy_return_action(uint32_t value) const;
+    bool proxy_accept_action(uint32_t value, bool present);
+
+    // Index of the chunk with key high, or where it would go.
+    std::size_t find(uint16_t high) const;
+    bool has(std::size_t ix, uint16_t high) const;
+    void erase_if_empty(std::size_t ix);
+};
+
+inline RoaringBitmap::RoaringBitmap(std::initializer_list<uint32_t> values)
+{
+    for (uint32_t value: values)
+        add(value);
+}
+
+inline bool RoaringBitmap::contains(uint32_t value) const
+{
+    std::size_t const ix = find(value >> 16);
+    return has(ix, value >> 16)
+        && roaring_detail::contains(d_containers[ix], static_cast<uint16_t>(value));
+}
+
+inline bool RoaringBitmap::add(uint32_t value)
+{
+    uint16_t const high = value >> 16;
+    std::size_t const ix = find(high);
+    if (not has(ix, high))
+    {
+        d_keys.insert(d_keys.begin() + ix, high);
+        d_containers.insert(d_containers.begin() + ix, Container{});
+    }
+    return roaring_detail::add(d_containers[ix], static_cast<uint16_t>(value));
+}
+
+inline bool RoaringBitmap::remove(uint32_t value)
+{
+    uint16_t const high = value >> 16;
+    std::size_t const ix = find(high);
+    if (not has(ix, high)
+        || not roaring_detail::remove(d_containers[ix], static_cast<uint16_t>(value)))
+        return false;
+    erase_if_empty(ix);
+    return true;
+}
+
+inline void RoaringBitmap::add_range(uint64_t first, uint64_t last)
+{
+    using namespace roaring_detail;
+
+    last = std::min<uint64_t>(last, uint64_t(1) << 32);
+    while (first < last)
+    {
+        uint16_t const high = first >> 16;
+        uint64_t const end = std::min<uint64_t>(last, (uint64_t(high) + 1) << 16);
+        Container range = RunContainer{{Run{static_cast<uint16_t>(first),
+                                            static_cast<uint16_t>(end - 1 - first)}}};
+        std::size_t const ix = find(high);
+        if (has(ix, high))
+        {
+            d_containers[ix] = unite(d_containers[ix], range);
+            roaring_detail::optimize(d_containers[ix]);
+        }
+        else
+        {
+            d_keys.insert(d_keys.begin() + ix, high);
+            d_containers.insert(d_containers.begin() + ix, std::move(range));
+        }
+        first = end;
+    }
+}
+
+inline void RoaringBitmap::clear()
+{
+    d_keys.clear();
+    d_containers.clear();
+}
+
+inline std::size_t RoaringBitmap::cardinality() const
+{
+    std::size_t total = 0;
+    for (Container const &container: d_containers)
+        total += roaring_detail::cardinality(container);
+    return total;
+}
+
+inline bool RoaringBitmap::empty() const
+{
+    return d_keys.empty(); // Empty chunks are erased.
+}
+
+inline std::size_t RoaringBitmap::bytes() const
+{
+    std::size_t total = d_keys.size() * (sizeof(uint16_t) + sizeof(Container));
+    for (Container const &container: d_containers)
+        total += roaring_detail::bytes(container);
+    return total;
+}
+
+inline std::size_t RoaringBitmap::chunks() const
+{
+    return d_keys.size();
+}
+
+inline RoaringBitmap::Kind RoaringBitmap::kind(uint32_t value) const
+{
+    std::size_t const ix = find(value >> 16);
+    return has(ix, value >> 16) ? static_cast<Kind>(d_containers[ix].index() + 1) : Kind::None;
+}
+
+inline void RoaringBitmap::optimize()
+{
+    for (Container &container: d_containers)
+        roaring_detail::optimize(container);
+}
+
+template <typename Function>
+void RoaringBitmap::for_each(Function &&function) const
+{
+    for (std::size_t ix = 0; ix != d_keys.size(); ++ix)
+    {
+        uint32_t const high = uint32_t(d_keys[ix]) << 16;
+        roaring_detail::for_each(d_containers[ix],
+                                 [&](uint16_t low) { function(high | low); });
+    }
+}
+
+// Merges the sorted keys, uniting the chunks both have.
+inline RoaringBitmap &RoaringBitmap::operator|=(RoaringBitmap const &other)
+{
+    RoaringBitmap result;
+    result.d_keys.reserve(d_keys.size() + other.d_keys.size());
+    result.d_containers.reserve(d_keys.size() + other.d_keys.size());
+
+    std::size_t lhs = 0;
+    std::size_t rhs = 0;
+    while (lhs != d_keys.size() || rhs != other.d_keys.size())
+    {
+        if (rhs == other.d_keys.size()
+            || (lhs != d_keys.size() && d_keys[lhs] < other.d_keys[rhs]))
+        {
+            result.d_keys.push_back(d_keys[lhs]);
+            result.d_containers.push_back(std::move(d_containers[lhs++]));
+        }
+        else if (lhs == d_keys.size() || other.d_keys[rhs] < d_keys[lhs])
+        {
+            result.d_keys.push_back(other.d_keys[rhs]);
+            result.d_containers.push_back(other.d_containers[rhs++]);
+        }
+        else
+        {
+            result.d_keys.push_back(d_keys[lhs]);
+            result.d_containers.push_back(
+                roaring_detail::unite(d_containers[lhs++], other.d_containers[rhs++]));
+        }
+    }
+    d_keys.swap(result.d_keys);
+    d_containers.swap(result.d_containers);
+    return *this;
+}
+
+// Only chunks both have can have values in common.
+inline RoaringBitmap &RoaringBitmap::operator&=(RoaringBitmap const &other)
+{
+    std::size_t kept = 0;
+    std::size_t rhs = 0;
+    for (std::size_t lhs = 0; lhs != d_keys.size(); ++lhs)
+    {
+        while (rhs != other.d_keys.size() && other.d_keys[rhs] < d_keys[lhs])
+            ++rhs;
+        if (rhs == other.d_keys.size() || other.d_keys[rhs] != d_keys[lhs])
+            continue;
+        Container common = roaring_detail::intersect(d_containers[lhs], other.d_containers[rhs]);
+        if (roaring_detail::cardinality(common) != 0)
+        {
+            d_keys[kept] = d_keys[lhs];
+            d_containers[kept++] = std::move(common);
+        }
+    }
+    d_keys.resize(kept);
+    d_containers.resize(kept);
+    return *this;
+}
+
+inline RoaringBitmap operator|(RoaringBitmap const &lhs, RoaringBitmap const &rhs)
+{
+    RoaringBitmap result(lhs);
+    return result |= rhs;
+}
+
+inline RoaringBitmap operator&(RoaringBitmap const &lhs, RoaringBitmap const &rhs)
+{
+    RoaringBitmap result(lhs);
+    return result &= rhs;
+}
+
+// Equal values, whatever containers hold them.
+inline bool operator==(RoaringBitmap const &lhs, RoaringBitmap const &rhs)
+{
+    if (lhs.d_keys != rhs.d_keys)
+        return false;
+    for (std::size_t ix = 0; ix != lhs.d_keys.size(); ++ix)
+        if (roaring_detail::cardinality(lhs.d_containers[ix])
+                != roaring_detail::cardinality(rhs.d_containers[ix])
+            || roaring_detail::cardinality(roaring_detail::intersect(lhs.d_containers[ix],
+                                                                     rhs.d_containers[ix]))
+                != roaring_detail::cardinality(lhs.d_containers[ix]))
+            return false;
+    return true;
+}
+
+inline bool RoaringBitmap::proxy_return_action(uint32_t value) const
+{
+    return contains(value);
+}
+
+inline bool RoaringBitmap::proxy_accept_action(uint32_t value, bool present)
+{
+    if (present)
+        add(value);
+    else
+        remove(value);
+    return present;
+}
+
+inline std::size_t RoaringBitmap::find(uint16_t high) const
+{
+    return std::lower_bound(d_keys.begin(), d_keys.end(), high) - d_keys.begin();
+}
+
+inline bool RoaringBitmap::has(std::size_t ix, uint16_t high) const
+{
+    return ix != d_keys.size() && d_keys[ix] == high;
+}
+
+inline void RoaringBitmap::erase_if_empty(std::size_t ix)
+{
+    if (roaring_detail::cardinality(d_containers[ix]) == 0)
+    {
+        d_keys.erase(d_keys.begin() + ix);
+        d_containers.erase(d_containers.begin() + ix);
+    }
+}
+
+#endif //roaringbitmap_hh_defd
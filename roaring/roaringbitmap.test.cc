@@ -0,0 +1,166 @@
+#include "roaringbitmap.hh"
+#include "../../unittest/unittest.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    vector<uint32_t> values(RoaringBitmap const &bitmap)
+    {
+        vector<uint32_t> result;
+        bitmap.for_each([&](uint32_t value) { result.push_back(value); });
+        return result;
+    }
+
+    // Values spread over a few chunks, some sparse, some dense.
+    set<uint32_t> random_values(unsigned seed)
+    {
+        mt19937 random(seed);
+        set<uint32_t> result;
+        for (int count = 0; count != 3000; ++count)
+            result.insert(random() % (1u << 20));      // Sparse: arrays.
+        for (int count = 0; count != 20000; ++count)
+            result.insert((5u << 16) + random() % 30000); // Dense: a bitmap.
+        return result;
+    }
+}
+
+int main()
+{
+    test("Reads and writes go through the proxy.",
+         []()
+         {
+             RoaringBitmap bitmap;
+             bitmap[3] = true;
+             bitmap[70000] = true;
+             bitmap[uint32_t{0xffffffff}] = true;
+             bitmap[3] = false;
+             bitmap[4] = bitmap[70000];
+             bool const three = bitmap[3];
+             return not three
+                 && bitmap[4]
+                 && values(bitmap) == vector<uint32_t>{4, 70000, 0xffffffff}
+                 && bitmap.chunks() == 3;
+         });
+
+    test("A chunk turns into a bitmap past 4096 values, and back.",
+         []()
+         {
+             RoaringBitmap bitmap;
+             for (uint32_t value = 0; value != 4096; ++value)
+                 bitmap.add(value * 2);
+             auto before = bitmap.kind(0);
+             bitmap.add(1);
+             auto after = bitmap.kind(0);
+             bitmap.remove(2);
+             return before == RoaringBitmap::Kind::Array
+                 && after == RoaringBitmap::Kind::Bitmap
+                 && bitmap.kind(0) == RoaringBitmap::Kind::Array
+                 && bitmap.cardinality() == 4096
+                 && bitmap.contains(1) && not bitmap.contains(2)
+                 && bitmap.kind(1u << 16) == RoaringBitmap::Kind::None;
+         });
+
+    test("Runs take little room, and stay correct under writes.",
+         []()
+         {
+             RoaringBitmap bitmap;
+             for (uint32_t value = 100; value != 60000; ++value)
+                 bitmap.add(value);
+             size_t const asbitmap = bitmap.bytes();
+             bitmap.optimize();
+             bool const runs = bitmap.kind(0) == RoaringBitmap::Kind::Runs;
+             size_t const asruns = bitmap.bytes();
+
+             bitmap[500] = false;    // Splits the run.
+             bitmap[99] = true;      // Extends it.
+             bitmap[500] = true;     // Joins the halves again.
+             bitmap[70000] = true;
+             bitmap.add_range(1u << 20, (1u << 20) + 200000);
+             return runs
+                 && asruns * 100 < asbitmap
+                 && bitmap.kind(0) == RoaringBitmap::Kind::Runs
+                 && bitmap.cardinality() == 59901 + 1 + 200000
+                 && bitmap.contains(99) && bitmap.contains(500) && not bitmap.contains(60000)
+                 && bitmap.kind(1u << 20) == RoaringBitmap::Kind::Runs
+                 && bitmap.contains((1u << 20) + 199999) && not bitmap.contains((1u << 20) + 200000);
+         });
+
+    test("Random adds and removes agree with a std::set.",
+         []()
+         {
+             mt19937 random(7);
+             RoaringBitmap bitmap;
+             set<uint32_t> reference;
+             for (int step = 0; step != 100000; ++step)
+             {
+                 uint32_t const value = random() % 200000;
+                 bool const present = random() % 3 != 0;
+                 bitmap[value] = present;
+                 if (present)
+                     reference.insert(value);
+                 else
+                     reference.erase(value);
+                 if (step == 50000)
+                     bitmap.optimize();
+             }
+             return values(bitmap) == vector<uint32_t>(reference.begin(), reference.end())
+                 && bitmap.cardinality() == reference.size();
+         });
+
+    test("Union and intersection agree with std::set, for every mix of containers.",
+         []()
+         {
+             set<uint32_t> const lhsvalues = random_values(1);
+             set<uint32_t> const rhsvalues = random_values(2);
+             RoaringBitmap lhs, rhs, runs;
+             for (uint32_t value: lhsvalues)
+                 lhs.add(value);
+             for (uint32_t value: rhsvalues)
+                 rhs.add(value);
+             runs.add_range(3u << 16, 6u << 16);
+
+             vector<uint32_t> both, either;
+             set_intersection(lhsvalues.begin(), lhsvalues.end(), rhsvalues.begin(), rhsvalues.end(),
+                              back_inserter(both));
+             set_union(lhsvalues.begin(), lhsvalues.end(), rhsvalues.begin(), rhsvalues.end(),
+                       back_inserter(either));
+             vector<uint32_t> inruns;
+             copy_if(lhsvalues.begin(), lhsvalues.end(), back_inserter(inruns),
+                     [](uint32_t value) { return value >> 16 >= 3 && value >> 16 < 6; });
+
+             RoaringBitmap withruns = lhs & runs;
+             RoaringBitmap joined = lhs | runs;
+             return values(lhs & rhs) == both
+                 && (lhs & rhs).cardinality() == both.size()
+                 && values(lhs | rhs) == either
+                 && (lhs | rhs).cardinality() == either.size()
+                 && values(withruns) == inruns
+                 && joined.cardinality() == lhsvalues.size() - inruns.size() + 3 * 65536
+                 && (lhs & RoaringBitmap{}).empty();
+         });
+
+    test("Equality looks at values, not containers.",
+         []()
+         {
+             RoaringBitmap lhs, rhs;
+             lhs.add_range(10, 5000);
+             for (uint32_t value = 10; value != 5000; ++value)
+                 rhs[value] = true;
+             bool const equal = lhs == rhs;
+             rhs[4999] = false;
+             rhs[5000] = true;
+             return equal
+                 && lhs.kind(0) != rhs.kind(0)
+                 && not (lhs == rhs);
+         });
+
+    return TestCount::result();
+}
@@ -0,0 +1,97 @@
+#include "sharedtable.hh"
+#include "../benchmark/benchmark.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Operations on one SharedTable from 1, 2, 4, ... processes up to all
+// cores, every process doing 90% reads and 10% writes of random elements.
+// Reported is the time per operation of all processes together. The first
+// line is one process on a plain array, for scale.
+
+using namespace std;
+
+namespace
+{
+    constexpr size_t Size = 1 << 16;
+    constexpr size_t OpsPerProcess = size_t(1) << 22;
+
+    struct Quote
+    {
+        uint64_t price;
+        uint64_t volume;
+    };
+
+    // Returns a sum of what was read, so it can't be optimised away.
+    template <typename Table>
+    uint64_t work(Table &table, uint64_t seed)
+    {
+        uint64_t sum = 0;
+        uint64_t state = seed * 0x9e3779b97f4a7c15 + 1;
+        for (size_t op = 0; op != OpsPerProcess; ++op)
+        {
+            state ^= state << 13;  // xorshift
+            state ^= state >> 7;
+            state ^= state << 17;
+            size_t const key = state % Size;
+            if (state % 10 == 0)
+                table[key] = Quote{state, op};
+            else
+            {
+                Quote quote = table[key];
+                sum += quote.price;
+            }
+        }
+        return sum;
+    }
+}
+
+int main()
+{
+    size_t const cores = max(1u, thread::hardware_concurrency());
+    string const name = "/ipx-bench-" + to_string(getpid());
+    printf("%zu operations per process, up to %zu processes\n", OpsPerProcess, cores);
+
+    vector<Quote> local(Size);
+    report("plain array, 1 process",
+           best_seconds([&]() { keep(work(local, 1)); }, 3), OpsPerProcess);
+
+    SharedTable<Quote> table(name, Size);
+
+    vector<size_t> counts;  // 1, 2, 4, ... and all cores.
+    for (size_t processes = 1; processes < cores; processes *= 2)
+        counts.push_back(processes);
+    counts.push_back(cores);
+
+    for (size_t processes: counts)
+    {
+        auto const start = chrono::steady_clock::now();
+        vector<pid_t> children;
+        for (size_t id = 0; id != processes; ++id)
+        {
+            pid_t const child = fork();
+            if (child == 0)
+            {
+                SharedTable<Quote> mine(name, Size);    // As another program would.
+                keep(work(mine, id + 1));
+                _exit(0);
+            }
+            children.push_back(child);
+        }
+        for (pid_t child: children)
+            waitpid(child, nullptr, 0);
+        chrono::duration<double> const took = chrono::steady_clock::now() - start;
+
+        report(("SharedTable, processes " + to_string(processes)).c_str(),
+               took.count(), double(processes) * OpsPerProcess);
+    }
+
+    SharedTable<Quote>::unlink(name);
+}
@@ -0,0 +1,337 @@
+#ifndef sharedtable_hh_defd
+#define sharedtable_hh_defd
+
+#include "../indexproxifier.hh"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+   Table of count Ts in a POSIX shared memory segment, so that processes on
+   one host share it without copies or round trips:
+
+       // In every process:
+       SharedTable<Quote> quotes("/quotes", 4096);
+       quotes[k] = quote;
+       Quote latest = quotes[k];
+
+   The first process to construct a SharedTable of a name creates and
+   initializes the segment; the others open it, and check that it holds
+   count elements of sizeof(T) bytes. SharedTable::unlink(name) removes the
+   name; the segment lives on until the last process unmaps it.
+
+   The segment holds no pointers, only offsets from its start, so it may be
+   mapped at a different address in each process. Each element has a
+   sequence lock: writers (from any process) take it with a compare and
+   swap, readers don't write at all. A reader retries until it has read a
+   value no writer touched meanwhile, so reads are never torn.
+
+   A writer that dies holding an element's lock (between taking and
+   releasing it) leaves the element locked for good. Rather than waiting
+   forever, reads and writes of it throw std::system_error (EOWNERDEAD)
+   once it has been locked without progress for lockwait. break_lock(key)
+   then releases the lock; the element may hold half the dead writer's
+   value, so it should be written anew.
+
+   T must be trivially copyable. The table works only between processes of
+   the same architecture and compiled with the same layout of T.
+*/
+
+struct SharedTableHeader
+{
+    enum : uint32_t
+    {
+        Version = 1,
+    };
+
+    char magic[4] = {'I', 'P', 'X', 'S'};
+    uint32_t version = Version;
+    uint64_t elementsize = 0;
+    uint64_t count = 0;
+    uint64_t slotsoffset = 0;   // From the start of the segment.
+    uint64_t slotsize = 0;
+    std::atomic<uint32_t> ready{0};
+};
+
+template <typename T>
+class SharedTable: protected IndexProxifier<SharedTable<T>>
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SharedTable needs trivially copyable elements.");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "Sequence locks must be address free.");
+
+    // An element with its sequence lock. Odd while being written.
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence;
+        T value;
+    };
+
+    std::string d_name;
+    void *d_segment = nullptr;
+    std::size_t d_size = 0;     // Bytes mapped.
+    std::size_t d_count = 0;
+    char *d_slots = nullptr;    // Segment start + slotsoffset.
+    std::size_t d_slotsize = 0;
+    std::chrono::milliseconds d_lockwait;
+
+public:
+    SharedTable(std::string name, std::size_t count,
+                std::chrono::milliseconds lockwait = std::chrono::seconds(1));
+    SharedTable(SharedTable &&tmp) noexcept;
+    SharedTable(SharedTable const &other) = delete;
+    ~SharedTable();
+
+    std::size_t size() const;
+
+    static bool unlink(std::string const &name);
+
+    // Only if the writer holding key's lock is known to be dead.
+    void break_lock(std::size_t key);
+
+    using IndexProxifier<SharedTable>::operator[];
+
+private:
+    friend IndexProxifier<SharedTable>;
+
+    T proxy_return_action(std::size_t key) const;
+    T proxy_accept_action(std::size_t key, T const &value);
+
+    Slot &slot(std::size_t key) const;
+    uint32_t unlocked_sequence(std::size_t key) const;
+
+    static std::size_t segment_size(std::size_t count);
+    void map(int fd, std::size_t size);
+    void initialize(std::size_t count);
+    void attach(int fd, std::size_t count);
+};
+
+template <typename T>
+SharedTable<T>::SharedTable(std::string name, std::size_t count, std::chrono::milliseconds lockwait)
+    : d_name(std::move(name)),
+      d_lockwait(lockwait)
+{
+    int fd = ::shm_open(d_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    bool const creating = fd >= 0;
+    if (not creating && errno == EEXIST)
+        fd = ::shm_open(d_name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+        throw std::system_error(errno, std::system_category(), "Cannot open shared memory " + d_name);
+
+    try
+    {
+        if (creating)
+        {
+            if (::ftruncate(fd, segment_size(count)) < 0)
+                throw std::system_error(errno, std::system_category(), "Cannot size shared memory " + d_name);
+            map(fd, segment_size(count));
+            initialize(count);
+        }
+        else
+            attach(fd, count);
+    }
+    catch (...)
+    {
+        ::close(fd);
+        if (d_segment)
+            ::munmap(d_segment, d_size);
+        throw;
+    }
+    ::close(fd); // The mapping stays.
+}
+
+template <typename T>
+SharedTable<T>::SharedTable(SharedTable &&tmp) noexcept
+    : d_name(std::move(tmp.d_name)),
+      d_segment(std::exchange(tmp.d_segment, nullptr)),
+      d_size(tmp.d_size),
+      d_count(tmp.d_count),
+      d_slots(tmp.d_slots),
+      d_slotsize(tmp.d_slotsize),
+      d_lockwait(tmp.d_lockwait)
+{}
+
+template <typename T>
+SharedTable<T>::~SharedTable()
+{
+    if (d_segment)
+        ::munmap(d_segment, d_size);
+}
+
+template <typename T>
+std::size_t SharedTable<T>::size() const
+{
+    return d_count;
+}
+
+template <typename T>
+bool SharedTable<T>::unlink(std::string const &name)
+{
+    return ::shm_unlink(name.c_str()) == 0;
+}
+
+template <typename T>
+void SharedTable<T>::break_lock(std::size_t key)
+{
+    Slot &element = slot(key);
+    uint32_t sequence = element.sequence.load(std::memory_order_relaxed);
+    if (sequence & 1)
+        element.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_release);
+}
+
+// Retries while a writer is, or was, busy with the element.
+template <typename T>
+T SharedTable<T>::proxy_return_action(std::size_t key) const
+{
+    Slot &element = slot(key);
+    T value;
+    while (true)
+    {
+        uint32_t const before = unlocked_sequence(key);
+        std::memcpy(static_cast<void *>(&value), &element.value, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (element.sequence.load(std::memory_order_relaxed) == before)
+            return value;
+    }
+}
+
+template <typename T>
+T SharedTable<T>::proxy_accept_action(std::size_t key, T const &value)
+{
+    Slot &element = slot(key);
+    uint32_t sequence = unlocked_sequence(key);
+    while (not element.sequence.compare_exchange_weak(sequence, sequence + 1,
+                                                      std::memory_order_acquire, std::memory_order_relaxed))
+        if (sequence & 1)
+            sequence = unlocked_sequence(key);
+    std::memcpy(static_cast<void *>(&element.value), &value, sizeof(T));
+    element.sequence.store(sequence + 2, std::memory_order_release);
+    return value;
+}
+
+template <typename T>
+typename SharedTable<T>::Slot &SharedTable<T>::slot(std::size_t key) const
+{
+    return *std::launder(reinterpret_cast<Slot *>(d_slots + key * d_slotsize));
+}
+
+// Waits for the element's writer to finish, and returns the (even)
+// sequence. Other writes in between are progress, and restart the clock.
+template <typename T>
+uint32_t SharedTable<T>::unlocked_sequence(std::size_t key) const
+{
+    Slot &element = slot(key);
+    uint32_t sequence = element.sequence.load(std::memory_order_acquire);
+    if (not (sequence & 1))
+        return sequence;
+
+    auto deadline = std::chrono::steady_clock::now() + d_lockwait;
+    while (true)
+    {
+        std::this_thread::yield();
+        uint32_t const now = element.sequence.load(std::memory_order_acquire);
+        if (not (now & 1))
+            return now;
+        if (now != sequence)
+        {
+            sequence = now;
+            deadline = std::chrono::steady_clock::now() + d_lockwait;
+        }
+        else if (std::chrono::steady_clock::now() > deadline)
+            throw std::system_error(EOWNERDEAD, std::generic_category(),
+                                    "Element " + std::to_string(key) + " of shared memory " + d_name
+                                    + " stays locked: did its writer die?");
+    }
+}
+
+template <typename T>
+std::size_t SharedTable<T>::segment_size(std::size_t count)
+{
+    std::size_t const offset = (sizeof(SharedTableHeader) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+    return offset + count * sizeof(Slot);
+}
+
+template <typename T>
+void SharedTable<T>::map(int fd, std::size_t size)
+{
+    d_segment = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (d_segment == MAP_FAILED)
+    {
+        d_segment = nullptr;
+        throw std::system_error(errno, std::system_category(), "Cannot map shared memory " + d_name);
+    }
+    d_size = size;
+}
+
+// ready is set last: other processes wait for it before using the table.
+template <typename T>
+void SharedTable<T>::initialize(std::size_t count)
+{
+    SharedTableHeader *header = new (d_segment) SharedTableHeader;
+    header->elementsize = sizeof(T);
+    header->count = count;
+    header->slotsoffset = segment_size(0);
+    header->slotsize = sizeof(Slot);
+
+    d_count = count;
+    d_slotsize = sizeof(Slot);
+    d_slots = static_cast<char *>(d_segment) + header->slotsoffset;
+    for (std::size_t key = 0; key != count; ++key)
+        new (d_slots + key * d_slotsize) Slot{{0}, T{}};
+
+    header->ready.store(1, std::memory_order_release);
+}
+
+// The creator may still be sizing or initializing the segment.
+template <typename T>
+void SharedTable<T>::attach(int fd, std::size_t count)
+{
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    struct stat status;
+    while (true)
+    {
+        if (::fstat(fd, &status) < 0)
+            throw std::system_error(errno, std::system_category(), "Cannot stat shared memory " + d_name);
+        if (static_cast<std::size_t>(status.st_size) >= sizeof(SharedTableHeader))
+            break;
+        if (std::chrono::steady_clock::now() > deadline)
+            throw std::system_error(ETIMEDOUT, std::generic_category(), "Shared memory " + d_name + " never got initialized");
+        std::this_thread::yield();
+    }
+    map(fd, status.st_size);
+
+    SharedTableHeader *header = std::launder(static_cast<SharedTableHeader *>(d_segment));
+    while (header->ready.load(std::memory_order_acquire) == 0)
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            throw std::system_error(ETIMEDOUT, std::generic_category(), "Shared memory " + d_name + " never got initialized");
+        std::this_thread::yield();
+    }
+
+    if (std::memcmp(header->magic, SharedTableHeader{}.magic, sizeof header->magic) != 0
+        || header->version != SharedTableHeader::Version
+        || header->elementsize != sizeof(T)
+        || header->slotsize != sizeof(Slot)
+        || header->count != count
+        || header->slotsoffset + count * sizeof(Slot) > d_size)
+        throw std::system_error(EINVAL, std::generic_category(), "Shared memory " + d_name + " holds another table");
+
+    d_count = count;
+    d_slotsize = header->slotsize;
+    d_slots = static_cast<char *>(d_segment) + header->slotsoffset;
+}
+
+#endif //sharedtable_hh_defd
@@ -0,0 +1,222 @@
+#include "sharedtable.hh"
+#include "../../unittest/unittest.hh"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <string>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+    // Writers keep negative == -positive, so a torn read shows.
+    struct Pair
+    {
+        long positive;
+        long negative;
+    };
+
+    // Segment name unique to this process, removed when done.
+    struct SegmentName
+    {
+        string name = "/ipx-sharedtable-test-" + to_string(getpid());
+
+        SegmentName()
+        {
+            SharedTable<int>::unlink(name);
+        }
+
+        ~SegmentName()
+        {
+            SharedTable<int>::unlink(name);
+        }
+    };
+
+    // Runs child in a forked process; true if it exits with 0.
+    template <typename Child>
+    bool in_child(Child child)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+            _exit(child() ? 0 : 1);
+        int status = 0;
+        return pid > 0
+            && waitpid(pid, &status, 0) == pid
+            && WIFEXITED(status)
+            && WEXITSTATUS(status) == 0;
+    }
+}
+
+int main()
+{
+    test("A new table holds value-initialized elements.",
+         []()
+         {
+             SegmentName segment;
+             SharedTable<double> table(segment.name, 8);
+             table[size_t{3}] = 2.5;
+             double value = table[size_t{3}];
+             return table.size() == 8 && table[size_t{0}] == 0 && value == 2.5;
+         });
+
+    test("Writes in one process are read in another.",
+         []()
+         {
+             SegmentName segment;
+             SharedTable<int> table(segment.name, 100);
+             bool childok = in_child(
+                 [&]()
+                 {
+                     SharedTable<int> mine(segment.name, 100); // Maps elsewhere.
+                     for (size_t key = 0; key != 100; ++key)
+                         mine[key] = 3 * key;
+                     return true;
+                 });
+             for (size_t key = 0; key != 100; ++key)
+                 if (table[key] != 3 * int(key))
+                     return false;
+             return childok;
+         });
+
+    test("Opening with another element count fails.",
+         []()
+         {
+             SegmentName segment;
+             SharedTable<int> table(segment.name, 10);
+             try
+             {
+                 SharedTable<int> other(segment.name, 11);
+             }
+             catch (system_error const &)
+             {
+                 return true;
+             }
+             return false;
+         });
+
+    test("Reads never see half a write from another process.",
+         []()
+         {
+             enum { Keys = 4, Writes = 200000 };
+             SegmentName segment;
+             SharedTable<Pair> table(segment.name, Keys);
+             pid_t writer = fork();
+             if (writer == 0)
+             {
+                 SharedTable<Pair> mine(segment.name, Keys);
+                 for (long count = 1; count <= Writes; ++count)
+                     mine[size_t(count % Keys)] = Pair{count, -count};
+                 mine[size_t{0}] = Pair{-1, 1}; // Done.
+                 _exit(0);
+             }
+
+             bool consistent = true;
+             while (true)
+             {
+                 Pair last{};
+                 for (size_t key = 0; key != Keys; ++key)
+                 {
+                     Pair pair = table[key];
+                     if (pair.negative != -pair.positive)
+                         consistent = false;
+                     if (key == 0)
+                         last = pair;
+                 }
+                 if (last.positive == -1)
+                     break;
+             }
+             int status = 0;
+             waitpid(writer, &status, 0);
+             return consistent && WIFEXITED(status);
+         });
+
+    test("Writers in several processes take turns on an element.",
+         []()
+         {
+             enum { Keys = 2, Processes = 3, Writes = 50000 };
+             SegmentName segment;
+             SharedTable<Pair> table(segment.name, Keys);
+             for (long process = 0; process != Processes; ++process)
+                 if (fork() == 0)
+                 {
+                     SharedTable<Pair> mine(segment.name, Keys);
+                     for (long count = 0; count != Writes; ++count)
+                     {
+                         long value = process * Writes + count;
+                         mine[size_t(count % Keys)] = Pair{value, -value};
+                     }
+                     _exit(0);
+                 }
+
+             bool consistent = true;
+             int running = Processes;
+             while (running != 0)
+             {
+                 for (size_t key = 0; key != Keys; ++key)
+                 {
+                     Pair pair = table[key];
+                     if (pair.negative != -pair.positive)
+                         consistent = false;
+                 }
+                 while (waitpid(-1, nullptr, WNOHANG) > 0)
+                     --running;
+             }
+             return consistent;
+         });
+
+    test("An element locked by a dead writer times out, until the lock is broken.",
+         []()
+         {
+             SegmentName segment;
+             SharedTable<Pair> table(segment.name, 4, chrono::milliseconds(50));
+             table[size_t{2}] = Pair{1, -1};
+
+             // Takes element 2's lock like a writer, and dies holding it.
+             pid_t pid = fork();
+             if (pid == 0)
+             {
+                 int fd = shm_open(segment.name.c_str(), O_RDWR, 0600);
+                 struct stat status;
+                 fstat(fd, &status);
+                 char *base = static_cast<char *>(mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE,
+                                                       MAP_SHARED, fd, 0));
+                 auto *header = reinterpret_cast<SharedTableHeader *>(base);
+                 auto *sequence = reinterpret_cast<atomic<uint32_t> *>(
+                     base + header->slotsoffset + 2 * header->slotsize);
+                 sequence->fetch_add(1);
+                 kill(getpid(), SIGKILL);
+             }
+             waitpid(pid, nullptr, 0);
+
+             int timeouts = 0;
+             for (int attempt = 0; attempt != 2; ++attempt)
+                 try
+                 {
+                     if (attempt == 0)
+                         static_cast<Pair>(table[size_t{2}]);
+                     else
+                         table[size_t{2}] = Pair{2, -2};
+                 }
+                 catch (system_error const &error)
+                 {
+                     timeouts += error.code().value() == EOWNERDEAD;
+                 }
+             table.break_lock(2);
+             table[size_t{2}] = Pair{3, -3};
+             Pair pair = table[size_t{2}];
+             Pair other = table[size_t{1}];
+             return timeouts == 2
+                 && pair.positive == 3
+                 && other.positive == 0;
+         });
+
+    return TestCount::result();
+}
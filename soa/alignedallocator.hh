@@ -0,0 +1,63 @@
+#ifndef alignedallocator_hh_defd
+#define alignedallocator_hh_defd
+
+#include <cstddef>
+#include <new>
+
+/**
+   Allocator whose memory is aligned to Alignment bytes, e.g. for arrays
+   that vectorised loops read with aligned loads.
+*/
+template <typename T, std::size_t Alignment>
+class AlignedAllocator
+{
+    static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0,
+                  "Alignment must be a power of two, and suit T.");
+
+public:
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(AlignedAllocator<U, Alignment> const &other) noexcept;
+
+    T *allocate(std::size_t count);
+    void deallocate(T *pointer, std::size_t count) noexcept;
+
+    template <typename U>
+    bool operator==(AlignedAllocator<U, Alignment> const &other) const noexcept;
+};
+
+template <typename T, std::size_t Alignment>
+template <typename U>
+AlignedAllocator<T, Alignment>::AlignedAllocator(AlignedAllocator<U, Alignment> const &) noexcept
+{}
+
+template <typename T, std::size_t Alignment>
+T *AlignedAllocator<T, Alignment>::allocate(std::size_t count)
+{
+    return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+}
+
+template <typename T, std::size_t Alignment>
+void AlignedAllocator<T, Alignment>::deallocate(T *pointer, std::size_t) noexcept
+{
+    ::operator delete(pointer, std::align_val_t(Alignment));
+}
+
+// Stateless: any one can free what another allocated.
+template <typename T, std::size_t Alignment>
+template <typename U>
+bool AlignedAllocator<T, Alignment>::operator==(AlignedAllocator<U, Alignment> const &) const noexcept
+{
+    return true;
+}
+
+#endif //alignedallocator_hh_defd
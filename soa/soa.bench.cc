@@ -0,0 +1,97 @@
+#include "soa.hh"
+#include "../benchmark/benchmark.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Scans of one field of 32-byte rows (counting rows with x > 50), stored
+// as an array of structs and as a SoA: through a column span, through
+// get<Field> on row proxies, and through the whole-row Pin of soa[i]->x.
+// Then x += vx, which reads two fields and writes one.
+
+using namespace std;
+
+namespace
+{
+    constexpr size_t Rows = size_t(1) << 20;
+
+    struct Particle
+    {
+        float x;
+        float y;
+        float z;
+        float vx;
+        float vy;
+        float vz;
+        float mass;
+        int32_t id;
+    };
+
+    typedef SoA<Particle, &Particle::x, &Particle::y, &Particle::z, &Particle::vx,
+                &Particle::vy, &Particle::vz, &Particle::mass, &Particle::id> Particles;
+}
+
+int main()
+{
+    vector<Particle> aos(Rows);
+    Particles soa(Rows);
+    for (size_t ix = 0; ix != Rows; ++ix)
+    {
+        Particle const particle{float(ix % 100), 0, 0, 0.5f, 0, 0, 1, int32_t(ix)};
+        aos[ix] = particle;
+        soa[ix] = particle;
+    }
+    printf("%zu rows of %zu bytes\n", Rows, sizeof(Particle));
+
+    report("x > 50, AoS",
+           best_seconds([&]()
+                        {
+                            size_t count = 0;
+                            for (Particle const &particle: aos)
+                                count += particle.x > 50;
+                            keep(count);
+                        }), Rows);
+    report("x > 50, SoA column",
+           best_seconds([&]()
+                        {
+                            size_t count = 0;
+                            auto xs = soa.column<&Particle::x>();
+                            for (size_t ix = 0; ix != Rows; ++ix)
+                                count += xs[ix] > 50;
+                            keep(count);
+                        }), Rows);
+    report("x > 50, SoA get<&Particle::x>(soa[i])",
+           best_seconds([&]()
+                        {
+                            size_t count = 0;
+                            for (size_t ix = 0; ix != Rows; ++ix)
+                                count += get<&Particle::x>(soa[ix]) > 50;
+                            keep(count);
+                        }), Rows);
+    report("x > 50, SoA soa[i]->x (whole row)",
+           best_seconds([&]()
+                        {
+                            size_t count = 0;
+                            for (size_t ix = 0; ix != Rows; ++ix)
+                                count += soa[ix]->x > 50;
+                            keep(count);
+                        }), Rows);
+
+    report("x += vx, AoS",
+           best_seconds([&]()
+                        {
+                            for (Particle &particle: aos)
+                                particle.x += particle.vx;
+                            keep(aos.back().x);
+                        }), Rows);
+    report("x += vx, SoA columns",
+           best_seconds([&]()
+                        {
+                            auto xs = soa.column<&Particle::x>();
+                            auto vxs = soa.column<&Particle::vx>();
+                            for (size_t ix = 0; ix != Rows; ++ix)
+                                xs[ix] += vxs[ix];
+                            keep(xs.back());
+                        }), Rows);
+}
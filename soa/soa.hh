@@ -0,0 +1,255 @@
+#ifndef soa_hh_defd
+#define soa_hh_defd
+
+#include "../indexproxifier.hh"
+#include "alignedallocator.hh"
+
+#include <cstddef>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+   Struct of arrays: stores the members of Row listed in Members in one
+   array each, so a loop over one member reads only that member's array:
+
+       struct Particle { float x; float y; int id; };
+       SoA<Particle, &Particle::x, &Particle::y, &Particle::id> particles(1000);
+
+       particles[i] = Particle{1, 2, 3};        // Whole rows, as if an
+       Particle particle = particles[i];        // array of structs.
+       get<&Particle::x>(particles[i]) += 1;    // One field (or get<0>).
+       particles[i]->y = 5;                     // Same, via the whole row.
+       for (float &x: particles.column<&Particle::x>())
+           x *= 2;                              // Vectorisable.
+
+   particles[i]->y reads the whole row into a Pin, and writes it back after
+   the assignment (if that changed the row; a Pin compares it with a copy);
+   get touches one array only. Columns are aligned to
+   Alignment bytes. Row must be default constructible; members not listed
+   aren't stored.
+*/
+template <typename Row, auto ...Members>
+class SoA: protected IndexProxifier<SoA<Row, Members...>>
+{
+public:
+    enum : std::size_t
+    {
+        Alignment = 64, // A cache line, and a 512-bit vector.
+    };
+
+private:
+    template <auto Member>
+    using member_type = typename std::remove_cvref<decltype(std::declval<Row &>().*Member)>::type;
+
+    template <typename T>
+    using Column = std::vector<T, AlignedAllocator<T, Alignment>>;
+
+    typedef std::tuple<Column<member_type<Members>>...> Columns;
+
+    static_assert(sizeof...(Members) != 0, "A SoA needs members to store.");
+    static_assert((not std::is_same<member_type<Members>, bool>::value && ...),
+                  "vector<bool> doesn't store bools. Use e.g. uint8_t members.");
+
+    static constexpr auto s_members = std::make_tuple(Members...);
+
+    Columns d_columns;
+
+public:
+    // Index in Members of Field, which is a member pointer or an index.
+    template <auto Field>
+    static constexpr std::size_t index();
+
+    template <auto Field>
+    using field_type = typename std::tuple_element<index<Field>(), Columns>::type::value_type;
+
+    SoA() = default;
+    explicit SoA(std::size_t size);
+
+    std::size_t size() const;
+    void resize(std::size_t size);
+    void push_back(Row const &row);
+
+    template <auto Field>
+    std::span<field_type<Field>> column();
+
+    template <auto Field>
+    std::span<field_type<Field> const> column() const;
+
+    ProxyIterator<SoA> begin();
+    ProxyIterator<SoA> end();
+
+    using IndexProxifier<SoA>::operator[];
+
+private:
+    friend IndexProxifier<SoA>;
+
+    Row proxy_return_action(std::size_t key) const;
+    void proxy_accept_action(std::size_t key, Row const &row);
+    void proxy_commit_action(std::size_t key, Row const &row);
+    void proxy_swap_action(std::size_t key1, std::size_t key2);
+
+    template <auto Field>
+    field_type<Field> &proxy_field_action(std::size_t key);
+
+    template <auto Field>
+    field_type<Field> const &proxy_field_action(std::size_t key) const;
+
+    template <auto Lhs, auto Rhs>
+    static constexpr bool same_member();
+
+    // Calls function(std::integral_constant<size_t, Index>) for each member.
+    template <typename Function>
+    static void for_each_member(Function &&function);
+};
+
+template <typename Row, auto ...Members>
+template <auto Field>
+constexpr std::size_t SoA<Row, Members...>::index()
+{
+    if constexpr (std::is_integral<decltype(Field)>::value)
+    {
+        static_assert(Field >= 0 && static_cast<std::size_t>(Field) < sizeof...(Members), "No such field.");
+        return Field;
+    }
+    else
+    {
+        constexpr bool matches[] = {same_member<Members, Field>()...};
+        std::size_t index = 0;
+        while (index != sizeof...(Members) && not matches[index])
+            ++index;
+        return index; // Out of range, hence no field_type, if not a member.
+    }
+}
+
+template <typename Row, auto ...Members>
+SoA<Row, Members...>::SoA(std::size_t size)
+{
+    resize(size);
+}
+
+template <typename Row, auto ...Members>
+std::size_t SoA<Row, Members...>::size() const
+{
+    return std::get<0>(d_columns).size();
+}
+
+template <typename Row, auto ...Members>
+void SoA<Row, Members...>::resize(std::size_t size)
+{
+    std::apply([size](auto &...columns) { (columns.resize(size), ...); }, d_columns);
+}
+
+template <typename Row, auto ...Members>
+void SoA<Row, Members...>::push_back(Row const &row)
+{
+    for_each_member(
+        [&](auto index)
+        {
+            std::get<index>(d_columns).push_back(row.*std::get<index>(s_members));
+        });
+}
+
+template <typename Row, auto ...Members>
+template <auto Field>
+std::span<typename SoA<Row, Members...>::template field_type<Field>> SoA<Row, Members...>::column()
+{
+    return std::get<index<Field>()>(d_columns);
+}
+
+template <typename Row, auto ...Members>
+template <auto Field>
+std::span<typename SoA<Row, Members...>::template field_type<Field> const> SoA<Row, Members...>::column() const
+{
+    return std::get<index<Field>()>(d_columns);
+}
+
+template <typename Row, auto ...Members>
+ProxyIterator<SoA<Row, Members...>> SoA<Row, Members...>::begin()
+{
+    return {*this, 0};
+}
+
+template <typename Row, auto ...Members>
+ProxyIterator<SoA<Row, Members...>> SoA<Row, Members...>::end()
+{
+    return {*this, size()};
+}
+
+template <typename Row, auto ...Members>
+Row SoA<Row, Members...>::proxy_return_action(std::size_t key) const
+{
+    Row row{};
+    for_each_member(
+        [&](auto index)
+        {
+            row.*std::get<index>(s_members) = std::get<index>(d_columns)[key];
+        });
+    return row;
+}
+
+template <typename Row, auto ...Members>
+void SoA<Row, Members...>::proxy_accept_action(std::size_t key, Row const &row)
+{
+    for_each_member(
+        [&](auto index)
+        {
+            std::get<index>(d_columns)[key] = row.*std::get<index>(s_members);
+        });
+}
+
+template <typename Row, auto ...Members>
+void SoA<Row, Members...>::proxy_commit_action(std::size_t key, Row const &row)
+{
+    proxy_accept_action(key, row);
+}
+
+template <typename Row, auto ...Members>
+void SoA<Row, Members...>::proxy_swap_action(std::size_t key1, std::size_t key2)
+{
+    std::apply(
+        [&](auto &...columns)
+        {
+            using std::swap;
+            (swap(columns[key1], columns[key2]), ...);
+        },
+        d_columns);
+}
+
+template <typename Row, auto ...Members>
+template <auto Field>
+typename SoA<Row, Members...>::template field_type<Field> &SoA<Row, Members...>::proxy_field_action(std::size_t key)
+{
+    return std::get<index<Field>()>(d_columns)[key];
+}
+
+template <typename Row, auto ...Members>
+template <auto Field>
+typename SoA<Row, Members...>::template field_type<Field> const &SoA<Row, Members...>::proxy_field_action(std::size_t key) const
+{
+    return std::get<index<Field>()>(d_columns)[key];
+}
+
+template <typename Row, auto ...Members>
+template <auto Lhs, auto Rhs>
+constexpr bool SoA<Row, Members...>::same_member()
+{
+    if constexpr (std::is_same<decltype(Lhs), decltype(Rhs)>::value)
+                     return Lhs == Rhs;
+    else
+        return false;
+}
+
+template <typename Row, auto ...Members>
+template <typename Function>
+void SoA<Row, Members...>::for_each_member(Function &&function)
+{
+    [&]<std::size_t ...Index>(std::index_sequence<Index...>)
+    {
+        (function(std::integral_constant<std::size_t, Index>{}), ...);
+    }(std::make_index_sequence<sizeof...(Members)>{});
+}
+
+#endif //soa_hh_defd
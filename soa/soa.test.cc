@@ -0,0 +1,100 @@
+#include "soa.hh"
+#include "../../unittest/unittest.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+
+using namespace std;
+
+namespace
+{
+    struct Particle
+    {
+        float x;
+        float y;
+        int id;
+    };
+
+    typedef SoA<Particle, &Particle::x, &Particle::y, &Particle::id> Particles;
+
+    bool same(Particle const &lhs, Particle const &rhs)
+    {
+        return lhs.x == rhs.x && lhs.y == rhs.y && lhs.id == rhs.id;
+    }
+}
+
+int main()
+{
+    test("Whole rows go in and come out as structs.",
+         []()
+         {
+             Particles particles(3);
+             particles[1] = Particle{1.5f, 2.5f, 7};
+             Particle particle = particles[1];
+             particles.push_back(Particle{3, 4, 8});
+             Particle last = particles[3];
+             return particles.size() == 4
+                 && same(particle, Particle{1.5f, 2.5f, 7})
+                 && same(last, Particle{3, 4, 8})
+                 && same(particles[0], Particle{0, 0, 0});
+         });
+
+    test("get reads and writes a single field, by member or by index.",
+         []()
+         {
+             Particles particles(2);
+             get<&Particle::y>(particles[1]) = 6;
+             get<2>(particles[1]) = 9;
+             get<&Particle::y>(particles[1]) += 1;
+             Particles const &reading = particles;
+             float y = get<&Particle::y>(reading[1]);
+             return y == 7
+                 && particles.column<&Particle::id>()[1] == 9
+                 && particles.column<&Particle::x>()[1] == 0;
+         });
+
+    test("Member access writes back the row.",
+         []()
+         {
+             Particles particles(2);
+             particles[0] = Particle{1, 2, 3};
+             particles[0]->y = 20;
+             return same(particles[0], Particle{1, 20, 3});
+         });
+
+    test("Columns are aligned, contiguous spans.",
+         []()
+         {
+             Particles particles;
+             for (int id = 0; id != 100; ++id)
+                 particles.push_back(Particle{float(id), 0, id});
+             for (float &x: particles.column<&Particle::x>())
+                 x *= 2;
+             auto ids = particles.column<&Particle::id>();
+             auto xs = particles.column<0>();
+             return reinterpret_cast<uintptr_t>(xs.data()) % Particles::Alignment == 0
+                 && reinterpret_cast<uintptr_t>(ids.data()) % Particles::Alignment == 0
+                 && ids.size() == 100
+                 && accumulate(ids.begin(), ids.end(), 0) == 4950
+                 && accumulate(xs.begin(), xs.end(), 0.0f) == 9900;
+         });
+
+    test("Sorting swaps every column.",
+         []()
+         {
+             Particles particles;
+             for (int id: {3, 1, 2})
+                 particles.push_back(Particle{float(10 * id), float(-id), id});
+             sort(particles.begin(), particles.end(),
+                  [](Particle const &lhs, Particle const &rhs)
+                  {
+                      return lhs.id < rhs.id;
+                  });
+             return same(particles[0], Particle{10, -1, 1})
+                 && same(particles[1], Particle{20, -2, 2})
+                 && same(particles[2], Particle{30, -3, 3});
+         });
+
+    return TestCount::result();
+}
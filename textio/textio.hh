@@ -0,0 +1,86 @@
+#ifndef textio_hh_defd
+#define textio_hh_defd
+
+#include "../indexproxifier.hh"
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <system_error>
+
+/**
+   Bulk text formatting and parsing of owners deriving from IndexProxifier,
+   keyed by std::size_t 0 .. count. Uses LRProxy's to_chars and from_chars,
+   so there is no locale, no stream sentry and no per-element allocation.
+
+       std::string text;
+       ip::format_range(mc, count, text);          // Appends "1 2 3 ...".
+       auto result = ip::parse_range(mc, count, text.data(), text.data() + text.size());
+
+   format_range appends to text, growing it geometrically, and separates the
+   elements by separator.
+
+   parse_range skips whitespace and separator before each element. It stops
+   at the first element that doesn't parse; that element and the ones after
+   it keep their values. The result tells where and why it stopped, and how
+   many elements were parsed.
+*/
+
+namespace ip
+{
+    struct ParseRangeResult
+    {
+        char const *ptr;
+        std::errc ec;
+        std::size_t count; // Number of elements parsed.
+    };
+
+    // Owner may be const, but needn't be: not all owners have a const
+    // proxy_return_action.
+    template <typename Owner>
+        requires ProxyIndexed<Owner &, std::size_t>
+    void format_range(Owner &owner, std::size_t count, std::string &text, char separator = ' ')
+    {
+        std::size_t used = text.size();
+        text.resize(used + 16 * count + 32);
+        for (std::size_t key = 0; key != count; ++key)
+        {
+            while (true)
+            {
+                char *first = text.data() + used + (key != 0);
+                char *last = text.data() + text.size();
+                std::to_chars_result result = first < last
+                    ? to_chars(first, last, owner[key])
+                    : std::to_chars_result{last, std::errc::value_too_large};
+                if (result.ec == std::errc{})
+                {
+                    if (key != 0)
+                        text[used] = separator;
+                    used = result.ptr - text.data();
+                    break;
+                }
+                text.resize(2 * text.size());
+            }
+        }
+        text.resize(used);
+    }
+
+    template <typename Owner>
+        requires ProxyIndexed<Owner &, std::size_t>
+    ParseRangeResult parse_range(Owner &owner, std::size_t count, char const *first, char const *last, char separator = ' ')
+    {
+        for (std::size_t key = 0; key != count; ++key)
+        {
+            while (first != last &&
+                   (*first == separator || *first == ' ' || *first == '\t' || *first == '\n' || *first == '\r'))
+                ++first;
+            std::from_chars_result result = from_chars(first, last, owner[key]);
+            if (result.ec != std::errc{})
+                return {result.ptr, result.ec, key};
+            first = result.ptr;
+        }
+        return {first, std::errc{}, count};
+    }
+}
+
+#endif //textio_hh_defd
@@ -0,0 +1,94 @@
+
+#include "textio.hh"
+#include "../lrproxy/unit_test/eightbits/eightbits.hh"
+#include "../lrproxy/unit_test/nibbles/nibbles.hh"
+#include "../lrproxy/unit_test/retbyref/retbyvalue.hh"
+#include "../../unittest/unittest.hh"
+
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+    test("to_chars and from_chars work on a single LRProxy.",
+         []()
+         {
+             RetByValue<double> values{1.5, -2.25};
+             char buffer[32];
+             to_chars_result written = to_chars(buffer, buffer + sizeof buffer, values[1]);
+             *written.ptr = 0;
+             char const text[] = "3.125";
+             from_chars_result read = from_chars(text, text + sizeof text - 1, values[0]);
+             return std::strcmp(buffer, "-2.25") == 0
+                 && read.ec == std::errc{}
+                 && values[0] == 3.125;
+         });
+
+    test("A failed from_chars leaves the element alone.",
+         []()
+         {
+             Nibbles nibbles{3};
+             char const text[] = "x";
+             from_chars_result read = from_chars(text, text + 1, nibbles[0]);
+             return read.ec == std::errc::invalid_argument
+                 && nibbles[0] == 3u;
+         });
+
+    test("format_range and parse_range round trip.",
+         []()
+         {
+             Nibbles nibbles{1, 12, 0, 7, 15, 3, 9, 4};
+             string text("nibbles:");
+             ip::format_range(nibbles, Nibbles::Count, text);
+             Nibbles copy;
+             char const *first = text.data() + text.find(':') + 1;
+             ip::ParseRangeResult result = ip::parse_range(copy, Nibbles::Count, first, text.data() + text.size());
+             return text == "nibbles:1 12 0 7 15 3 9 4"
+                 && result.ec == std::errc{}
+                 && result.count == Nibbles::Count
+                 && copy.internal() == nibbles.internal();
+         });
+
+    test("Bools are formatted and parsed as 0 and 1.",
+         []()
+         {
+             EightBits bits(0b10100101);
+             string text;
+             ip::format_range(bits, 8, text, ',');
+             EightBits copy;
+             ip::ParseRangeResult result = ip::parse_range(copy, 8, text.data(), text.data() + text.size(), ',');
+             return text == "1,0,1,0,0,1,0,1"
+                 && result.count == 8
+                 && copy.internal() == bits.internal();
+         });
+
+    test("parse_range stops at the first element that doesn't parse.",
+         []()
+         {
+             RetByValue<int> numbers{0, 0, 0, 9};
+             char const text[] = " 5\t-6  seven 8";
+             ip::ParseRangeResult result = ip::parse_range(numbers, 4, text, text + sizeof text - 1);
+             return result.ec == std::errc::invalid_argument
+                 && result.count == 2
+                 && numbers[1] == -6
+                 && numbers[2] == 0
+                 && numbers[3] == 9;
+         });
+
+    test("format_range grows its buffer as needed.",
+         []()
+         {
+             RetByValue<double> values{1.0 / 3, 2.0 / 3, 1e300, -1e-300};
+             string text;
+             ip::format_range(values, 4, text);
+             RetByValue<double> copy;
+             ip::parse_range(copy, 4, text.data(), text.data() + text.size());
+             return copy[0] == 1.0 / 3
+                 && copy[3] == -1e-300
+                 && copy[2] == 1e300;
+         });
+
+    return TestCount::result();
+}